@@ -22,7 +22,9 @@
 #include <cmath>
 #include <climits>
 #include <cctype> // isdigit(c)
+#include <cerrno>
 #include <cstddef>
+#include <cstring>
 #ifdef DEBUG
 #include <iostream>
 #endif
@@ -33,11 +35,28 @@
 #include <istream>
 #include <algorithm>
 #include <memory>
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <set>
+#include <unordered_map>
+#endif
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include "tinydir/tinydir.h"
@@ -54,6 +73,21 @@
 ///the maximum number of non existing frame before Natron gives up trying to figure out a sequence layout.
 #define NATRON_DIALOG_MAX_SEQUENCES_HOLE 1000
 
+///the number of threads reading directories for the asynchronous functions
+#define SEQUENCEPARSING_IO_THREADS_COUNT 4
+
+///below this number of files per thread, matching them in parallel is not worth it
+#define SEQUENCEPARSING_MIN_FILES_PER_MATCHING_CHUNK 4096
+
+///the maximum number of renames of a sequence done one after the other, longer chains are split to run concurrently
+#define SEQUENCEPARSING_MAX_RENAME_CHAIN_LENGTH 256
+
+///the number of files sized by the refinement of a SequenceSizeEstimator between 2 calls of its callback
+#define SEQUENCEPARSING_SIZE_ESTIMATE_CALLBACK_INTERVAL 256
+
+///the maximum number of files deserializeSequence generates: a few bytes of frame ranges can describe billions of files
+#define SEQUENCEPARSING_WIRE_MAX_FILES_COUNT 16777216
+
 using std::size_t;
 using std::map;
 using std::string;
@@ -67,6 +101,113 @@ using namespace SequenceParsing;
 
 namespace  {
 
+///The I/O statistics, @see getIOStatistics
+#if __cplusplus >= 201103L
+typedef std::atomic<unsigned long long> IOCounter;
+#else
+typedef unsigned long long IOCounter;
+#endif
+IOCounter gDirectoriesOpened(0);
+IOCounter gDirectoryEntriesRead(0);
+IOCounter gFilesStatted(0);
+IOCounter gFilesOpened(0);
+IOCounter gFilesRenamed(0);
+IOCounter gFilesRemoved(0);
+IOCounter gFileTimesSet(0);
+IOCounter gReadCalls(0);
+IOCounter gWriteCalls(0);
+IOCounter gCopyCalls(0);
+
+///Lazily computed members of const objects are published through a LazyFlag: readers test it without
+///locking and only take the LazyInitMutex of the object to compute the member the first time.
+///A LazyPointer publishes an object that is immutable once published in the same way.
+#if __cplusplus >= 201103L
+typedef std::atomic<bool> LazyFlag;
+typedef std::mutex LazyInitMutex;
+typedef std::lock_guard<std::mutex> LazyInitLocker;
+
+static bool
+isLazyFlagSet(const LazyFlag& flag)
+{
+    return flag.load(std::memory_order_acquire);
+}
+
+static void
+setLazyFlag(LazyFlag& flag,
+            bool value)
+{
+    flag.store(value, std::memory_order_release);
+}
+
+template <typename T>
+struct LazyPointer
+{
+    typedef std::atomic<T*> type;
+};
+
+template <typename T>
+static T*
+loadLazyPointer(const std::atomic<T*>& pointer)
+{
+    return pointer.load(std::memory_order_acquire);
+}
+
+template <typename T>
+static void
+storeLazyPointer(std::atomic<T*>& pointer,
+                 T* value)
+{
+    pointer.store(value, std::memory_order_release);
+}
+
+#else
+typedef bool LazyFlag;
+struct LazyInitMutex
+{
+};
+struct LazyInitLocker
+{
+    explicit LazyInitLocker(LazyInitMutex& /*mutex*/)
+    {
+    }
+};
+
+static bool
+isLazyFlagSet(const LazyFlag& flag)
+{
+    return flag;
+}
+
+static void
+setLazyFlag(LazyFlag& flag,
+            bool value)
+{
+    flag = value;
+}
+
+template <typename T>
+struct LazyPointer
+{
+    typedef T* type;
+};
+
+template <typename T>
+static T*
+loadLazyPointer(T* const& pointer)
+{
+    return pointer;
+}
+
+template <typename T>
+static void
+storeLazyPointer(T*& pointer,
+                 T* value)
+{
+    pointer = value;
+}
+
+#endif
+
 #ifdef _WIN32
 static wstring
 utf8_to_utf16(const string& str)
@@ -82,13 +223,14 @@ utf8_to_utf16(const string& str)
 #endif
 
 
-static std::size_t
-getFileSize(const string& filename)
+/*
+   Reads the size and modification time of a file, returns false if it does not exist.
+ */
+static bool
+getFileInfo(const string& filename,
+            FileInfo* info)
 {
 #ifdef _WIN32
-    wstring wfilename = utf8_to_utf16(filename);
-    LARGE_INTEGER file_size = { 0 };
-
     /*
        On Windows there are 3 methods to get the size of a file, the most robust being the 1st one
        but it is also the most expensive.
@@ -122,17 +264,184 @@ getFileSize(const string& filename)
 
     //Method 3, read the file attributes, this is the fastest
     WIN32_FILE_ATTRIBUTE_DATA file_attr_data;
-    if ( GetFileAttributesExW(wfilename.c_str(), GetFileExInfoStandard, &file_attr_data) ) {
-        file_size.LowPart = file_attr_data.nFileSizeLow;
-        file_size.HighPart = file_attr_data.nFileSizeHigh;
+    ++gFilesStatted;
+    if ( !GetFileAttributesExW(utf8_to_utf16(filename).c_str(), GetFileExInfoStandard, &file_attr_data) ) {
+        return false;
     }
-
-    return (std::size_t)file_size.QuadPart;
+    info->size = ( (unsigned long long)file_attr_data.nFileSizeHigh << 32 ) | file_attr_data.nFileSizeLow;
+    ///FILETIME is a number of 100 nanoseconds since 1601
+    unsigned long long fileTime = ( (unsigned long long)file_attr_data.ftLastWriteTime.dwHighDateTime << 32 ) |
+                                  file_attr_data.ftLastWriteTime.dwLowDateTime;
+    info->modificationTime = ( (long long)fileTime - 116444736000000000LL ) * 100;
 #else // !_WIN32
-    std::ifstream in(filename.c_str(), std::ifstream::ate | std::ifstream::binary);
-
-    return in.tellg();
+    struct stat s;
+    ++gFilesStatted;
+    if (stat(filename.c_str(), &s) != 0) {
+        return false;
+    }
+    info->size = (unsigned long long)s.st_size;
+    info->modificationTime = (long long)s.st_mtime * 1000000000LL;
+#if defined(__APPLE__)
+    info->modificationTime += s.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    info->modificationTime += s.st_mtim.tv_nsec;
+#endif
 #endif // _WIN32
+
+    return true;
+}
+
+/*
+   Appends a frame greater than all the frames already in the ranges.
+ */
+static void
+appendFrameToRanges(int frame,
+                    FrameRanges* ranges)
+{
+    if ( !ranges->empty() && (ranges->back().second + 1 == frame) ) {
+        ranges->back().second = frame;
+    } else {
+        assert(ranges->empty() || ranges->back().second < frame);
+        ranges->push_back( make_pair(frame, frame) );
+    }
+}
+
+/*
+   Appends to ret the frames of 'a' which are not in 'b'.
+ */
+static void
+subtractFrameRanges(const FrameRanges& a,
+                    const FrameRanges& b,
+                    FrameRanges* ret)
+{
+    FrameRanges::const_iterator bIt = b.begin();
+
+    for (FrameRanges::const_iterator aIt = a.begin(); aIt != a.end(); ++aIt) {
+        ///use long long so that INT_MAX + 1 does not overflow
+        long long first = aIt->first;
+        const long long last = aIt->second;
+        while ( bIt != b.end() && bIt->second < first ) {
+            ++bIt;
+        }
+        FrameRanges::const_iterator it = bIt;
+        while ( first <= last && it != b.end() && it->first <= last ) {
+            if (it->first > first) {
+                ret->push_back( make_pair( (int)first, it->first - 1 ) );
+            }
+            first = (long long)it->second + 1;
+            if (it->second <= last) {
+                ++it;
+            } else {
+                break;
+            }
+        }
+        if (first <= last) {
+            ret->push_back( make_pair( (int)first, (int)last ) );
+        }
+    }
+}
+
+/*
+   Inserts a frame which is not yet in the ranges, stored as a map first frame -> last frame.
+ */
+static void
+insertFrameInRanges(int frame,
+                    map<int, int>* ranges)
+{
+    map<int, int>::iterator next = ranges->upper_bound(frame);
+    map<int, int>::iterator prev = next;
+
+    if ( prev != ranges->begin() ) {
+        --prev;
+        if (prev->second >= frame) {
+            ///already in the ranges
+            return;
+        }
+    } else {
+        prev = ranges->end();
+    }
+    const bool joinsPrev = ( prev != ranges->end() ) && (prev->second == frame - 1);
+    const bool joinsNext = ( next != ranges->end() ) && (next->first - 1 == frame);
+    if (joinsPrev && joinsNext) {
+        prev->second = next->second;
+        ranges->erase(next);
+    } else if (joinsPrev) {
+        prev->second = frame;
+    } else if (joinsNext) {
+        int last = next->second;
+        ranges->erase(next);
+        ranges->insert( make_pair(frame, last) );
+    } else {
+        ranges->insert( make_pair(frame, frame) );
+    }
+}
+
+/*
+   Hashing functions used by the sequence fingerprints. They must give the same results on all platforms.
+ */
+static const unsigned long long kFingerprintSeed = 0xcbf29ce484222325ULL;
+
+static unsigned long long
+mixHash(unsigned long long x)
+{
+    ///splitmix64 finalizer
+    x = (x ^ (x >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27) ) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+}
+
+static unsigned long long
+combineHash(unsigned long long seed,
+            long long value)
+{
+    return mixHash( seed ^ ( (unsigned long long)value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2) ) );
+}
+
+static unsigned long long
+hashString(unsigned long long seed,
+           const string& str)
+{
+    ///FNV-1a
+    for (size_t i = 0; i < str.size(); ++i) {
+        seed = (seed ^ (unsigned char)str[i]) * 0x100000001b3ULL;
+    }
+
+    return combineHash( seed, (long long)str.size() );
+}
+
+/*
+   The hash of the info of a file. They are summed so that they can be accumulated in any order.
+ */
+static unsigned long long
+hashFileInfo(int viewNumber,
+             int frameNumber,
+             const FileInfo& info)
+{
+    unsigned long long ret = combineHash(kFingerprintSeed, viewNumber);
+
+    ret = combineHash(ret, frameNumber);
+    ret = combineHash(ret, (long long)info.size);
+
+    return combineHash(ret, info.modificationTime);
+}
+
+template <typename RangesIterator>
+static unsigned long long
+hashFrameRanges(unsigned long long seed,
+                int viewNumber,
+                size_t rangesCount,
+                RangesIterator begin,
+                RangesIterator end)
+{
+    seed = combineHash(seed, viewNumber);
+    seed = combineHash(seed, (long long)rangesCount);
+    for (RangesIterator it = begin; it != end; ++it) {
+        seed = combineHash(seed, it->first);
+        seed = combineHash(seed, it->second);
+    }
+
+    return seed;
 }
 
 #if 0
@@ -191,9 +500,11 @@ typedef std::basic_string<char, ci_char_traits> ci_string;
  * 2 variables: "%04d", "###"
  * The variables by order vector's second member is an int indicating how many non-variable (chars belonging to common parts) characters
  * were found before this variable.
+ * The pattern is given by its characters so that it does not have to be copied to a string.
  **/
 static bool
-extractCommonPartsAndVariablesFromPattern(const string& patternUnPathedWithoutExt,
+extractCommonPartsAndVariablesFromPattern(const char* patternUnPathedWithoutExt,
+                                          size_t patternSize,
                                           const string& patternExtension,
                                           StringList* commonParts,
                                           vector<pair<string, int> >* variablesByOrder)
@@ -205,7 +516,7 @@ extractCommonPartsAndVariablesFromPattern(const string& patternUnPathedWithoutEx
     string variable;
     int commonCharactersFound = 0;
     bool previousCharIsSharp = false;
-    for (int i = 0; i < (int)patternUnPathedWithoutExt.size(); ++i) {
+    for (int i = 0; i < (int)patternSize; ++i) {
         const char& c = patternUnPathedWithoutExt[i];
         if (c == '#') {
             if ( !commonPart.empty() ) {
@@ -221,7 +532,7 @@ extractCommonPartsAndVariablesFromPattern(const string& patternUnPathedWithoutEx
             previousCharIsSharp = true;
         } else if (c == '%') {
             char next = '\0';
-            if (i < (int)patternUnPathedWithoutExt.size() - 1) {
+            if (i < (int)patternSize - 1) {
                 next = patternUnPathedWithoutExt[i + 1];
             }
             char prev = '\0';
@@ -298,11 +609,14 @@ extractCommonPartsAndVariablesFromPattern(const string& patternUnPathedWithoutEx
 } // extractCommonPartsAndVariablesFromPattern
 
 static size_t
-findStr(const string& from,
+findStr(const char* from,
+        size_t fromSize,
         const string& toSearch,
-        int pos)
+        size_t pos)
 {
-    return from.find(toSearch, pos);
+    const char* found = std::search( from + pos, from + fromSize, toSearch.begin(), toSearch.end() );
+
+    return found == from + fromSize ? string::npos : (size_t)(found - from);
     // case insensitive version:
     //return ci_string(from.c_str()).find(toSearch.c_str(), pos);
 }
@@ -324,19 +638,6 @@ endsWith(const string& str,
              (str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0) );
 }
 
-static void
-removeAllOccurences(string& str,
-                    const string& toRemove)
-{
-    if ( str.size() ) {
-        for ( size_t i = findStr(str, toRemove, 0);
-              i != string::npos;
-              i = findStr(str, toRemove, i) ) {
-            str.erase( i, toRemove.size() );
-        }
-    }
-}
-
 static int
 stringToInt(const string& str)
 {
@@ -361,6 +662,28 @@ stringFromInt(int nb)
     return ss.str();
 }
 
+/*
+   Returns the position of the name in the file name: after the last '/', or the last '\' if there is none.
+   0 if there is no path.
+ */
+static size_t
+findFileNameStart(const char* filename,
+                  size_t size)
+{
+    for (size_t i = size; i > 0; --i) {
+        if (filename[i - 1] == '/') {
+            return i;
+        }
+    }
+    for (size_t i = size; i > 0; --i) {
+        if (filename[i - 1] == '\\') {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
 static string
 removeFileExtension(string& filename)
 {
@@ -375,24 +698,153 @@ removeFileExtension(string& filename)
     return extension;
 }
 
+/*
+   Wrappers of the directory and file-system calls, counting them in the I/O statistics.
+ */
+static bool
+openDirectory(tinydir_dir* dir,
+              const string& path)
+{
+    ++gDirectoriesOpened;
+
+    return tinydir_open( dir, path.c_str() ) != -1;
+}
+
+static void
+nextDirectoryEntry(tinydir_dir* dir)
+{
+    ++gDirectoryEntriesRead;
+    tinydir_next(dir);
+}
+
+#ifndef _WIN32
+static int
+statDirectoryEntry(int dirFd,
+                   const char* name,
+                   struct stat* s)
+{
+    ++gFilesStatted;
+
+    return fstatat(dirFd, name, s, 0);
+}
+
+#if __cplusplus >= 201103L
+static ssize_t
+readFileData(int fd,
+             void* buffer,
+             size_t size)
+{
+    ++gReadCalls;
+
+    return ::read(fd, buffer, size);
+}
+
+static ssize_t
+writeFileData(int fd,
+              const void* buffer,
+              size_t size)
+{
+    ++gWriteCalls;
+
+    return ::write(fd, buffer, size);
+}
+#endif // __cplusplus >= 201103L
+#endif
+
+#ifdef _WIN32
+///On Windows the type of the entry comes with it, tinydir does not stat it
+static int
+readDirectoryEntry(tinydir_dir* dir,
+                   tinydir_file* file)
+{
+    return tinydir_readfile(dir, file);
+}
+
+/*
+   Reads the current entry of the directory, returns false if it is not a file.
+ */
+static bool
+readDirectoryFile(tinydir_dir& dir,
+                  string* filename)
+{
+    tinydir_file file;
+    int status = readDirectoryEntry(&dir, &file);
+
+    if ( ( status != 0) || file.is_dir ) {
+        return false;
+    }
+    *filename = file.name;
+
+    return ( *filename != ".") && ( *filename != "..");
+}
+#endif
+
+/*
+   Returns true if the current entry of the directory is a file accepted by the filter, and points name to its name,
+   which is valid until the next entry is read. On POSIX systems the name is read straight from the directory entry
+   and only the entries of unknown type (symbolic links, file-systems not filling d_type) are stat'ed.
+   file is where the entry is read on Windows.
+ */
+static bool
+readDirectoryFileName(tinydir_dir& dir,
+                      const DirectoryListingFilter& filter,
+                      tinydir_file* file,
+                      const char** name,
+                      size_t* size)
+{
+#ifndef _WIN32
+    (void)file;
+    const struct dirent* entry = dir._e;
+    if (!entry) {
+        return false;
+    }
+    *name = entry->d_name;
+#else
+    if ( (readDirectoryEntry(&dir, file) != 0) || file->is_dir ) {
+        return false;
+    }
+    *name = file->name;
+#endif
+    *size = std::strlen(*name);
+    if ( ( (*size == 1) && ( (*name)[0] == '.' ) ) ||
+         ( (*size == 2) && ( (*name)[0] == '.' ) && ( (*name)[1] == '.' ) ) ||
+         !filter.accepts(*name, *size) ) {
+        return false;
+    }
+#ifndef _WIN32
+#if defined(DT_DIR)
+    if (entry->d_type == DT_DIR) {
+        return false;
+    }
+    if (entry->d_type == DT_REG) {
+        return true;
+    }
+#endif
+    struct stat s;
+
+    return statDirectoryEntry(dirfd(dir._d), entry->d_name, &s) == 0 && !S_ISDIR(s.st_mode);
+#else
+
+    return true;
+#endif
+}
+
+#ifdef _WIN32
 static void
 getFilesFromDir(tinydir_dir& dir,
                 StringList* ret)
 {
     ///iterate through all the files in the directory
     while (dir.has_next) {
-        tinydir_file file;
-        int status = tinydir_readfile(&dir, &file);
-        if ( ( status == 0) && !file.is_dir ) {
-            string filename(file.name);
-            if ( ( filename != ".") && ( filename != "..") ) {
-                ret->push_back(filename);
-            }
+        string filename;
+        if ( readDirectoryFile(dir, &filename) ) {
+            ret->push_back(filename);
         }
 
-        tinydir_next(&dir);
+        nextDirectoryEntry(&dir);
     }
 }
+#endif
 
 /*
    The following rules applying for matching frame numbers:
@@ -401,22 +853,27 @@ getFilesFromDir(tinydir_dir& dir,
  */
 static bool
 numberMatchDigits(int digitsCount,
-                  const string& number,
+                  const char* number,
+                  size_t numberSize,
                   int *frameNumber)
 {
-    assert(digitsCount > 0);
+    assert(digitsCount >= 0); // 0 for %d
 
-    *frameNumber = stringToInt(number);
+    ///number only contains digits, no need for atoi which expects a null-terminated string
+    *frameNumber = 0;
+    for (size_t i = 0; i < numberSize; ++i) {
+        *frameNumber = *frameNumber * 10 + (number[i] - '0');
+    }
 
-    if ( (int)number.size() == digitsCount ) {
+    if ( (int)numberSize == digitsCount ) {
         return true;
     }
 
-    if ( (int)number.size() < digitsCount ) {
+    if ( (int)numberSize < digitsCount ) {
         return false;
     }
 
-    assert( (int)number.size() > digitsCount );
+    assert( (int)numberSize > digitsCount );
 
     if (number[0] == '0') {
         return false;
@@ -427,114 +884,165 @@ numberMatchDigits(int digitsCount,
 
 static bool
 matchesHashTag(int sharpCount,
-               const string& filename,
+               const char* filename,
+               size_t filenameSize,
                size_t startingPos,
                size_t *endPos,
                int* frameNumber)
 {
-    string variable;
-    size_t variableIt = startingPos;
+    size_t variableIt;
     for (variableIt = startingPos;
-         variableIt < filename.size() && std::isdigit(filename[variableIt]);
+         variableIt < filenameSize && std::isdigit(filename[variableIt]);
          ++variableIt) {
-        variable.push_back(filename[variableIt]);
     }
     *endPos = variableIt;
 
-    return numberMatchDigits(sharpCount, variable, frameNumber);
+    return numberMatchDigits(sharpCount, filename + startingPos, variableIt - startingPos, frameNumber);
 }
 
 static bool
 matchesPrintfLikeSyntax(int digitsCount,
-                        const string& filename,
+                        const char* filename,
+                        size_t filenameSize,
                         size_t startingPos,
                         size_t *endPos,
                         int* frameNumber)
 {
-    string variable;
     size_t variableIt;
     for (variableIt = startingPos;
-         variableIt < filename.size() && std::isdigit(filename[variableIt]);
+         variableIt < filenameSize && std::isdigit(filename[variableIt]);
          ++variableIt) {
-        variable.push_back(filename[variableIt]);
     }
     *endPos = variableIt;
 
-    return numberMatchDigits(digitsCount, variable, frameNumber);
+    return numberMatchDigits(digitsCount, filename + startingPos, variableIt - startingPos, frameNumber);
+}
+
+/*
+   Returns true if the given range starts with the null-terminated prefix.
+ */
+static bool
+rangeStartsWith(const char* str,
+                size_t size,
+                const char* prefix)
+{
+    size_t prefixSize = std::strlen(prefix);
+
+    return prefixSize <= size && std::memcmp(str, prefix, prefixSize) == 0;
 }
 
 static bool
 matchesView(bool longView,
-            const string& filename,
+            const char* filename,
+            size_t filenameSize,
             size_t startingPos,
             size_t *endPos,
             int* viewNumber)
 {
-    string mid = filename.substr(startingPos);
-    if (!longView) {
-        if ( startsWith(mid, "r") ) {
-            *viewNumber = 1;
-            *endPos = startingPos + 1;
+    const char* mid = filename + startingPos;
+    const size_t midSize = filenameSize - startingPos;
 
-            return true;
-        } else if ( startsWith(mid, "l") ) {
-            *viewNumber = 0;
-            *endPos = startingPos + 1;
+    if ( rangeStartsWith(mid, midSize, longView ? "right" : "r") ) {
+        *viewNumber = 1;
+        *endPos = startingPos + (longView ? 5 : 1);
 
-            return true;
-        } else if ( startsWith(mid, "view") ) {
-            string viewNoStr;
-            for (size_t it = 4; it < mid.size() && std::isdigit(mid[it]); ++it) {
-                viewNoStr.push_back(mid[it]);
-            }
-            if ( !viewNoStr.empty() ) {
-                *viewNumber = stringToInt(viewNoStr);
-                *endPos = startingPos + 4 + viewNoStr.size();
-            } else {
-                return false;
-            }
+        return true;
+    } else if ( rangeStartsWith(mid, midSize, longView ? "left" : "l") ) {
+        *viewNumber = 0;
+        *endPos = startingPos + (longView ? 4 : 1);
 
-            return true;
+        return true;
+    } else if ( rangeStartsWith(mid, midSize, "view") ) {
+        size_t it = 4;
+        int number = 0;
+        for (; it < midSize && std::isdigit(mid[it]); ++it) {
+            number = number * 10 + (mid[it] - '0');
         }
-
-        return false;
-    } else {
-        if ( startsWith(mid, "right") ) {
-            *viewNumber = 1;
-            *endPos = startingPos + 5;
-
-            return true;
-        } else if ( startsWith(mid, "left") ) {
-            *viewNumber = 0;
-            *endPos = startingPos + 4;
-
-            return true;
-        } else if ( startsWith(mid, "view") ) {
-            string viewNoStr;
-            for (size_t it = 4; it < mid.size() && std::isdigit(mid[it]); ++it) {
-                viewNoStr.push_back(mid[it]);
-            }
-
-            if ( !viewNoStr.empty() ) {
-                *viewNumber = stringToInt(viewNoStr);
-                *endPos = startingPos + 4 + viewNoStr.size();
-            } else {
-                return false;
-            }
-
-            return true;
+        if (it == 4) {
+            return false;
         }
+        *viewNumber = number;
+        *endPos = startingPos + it;
 
-        return false;
+        return true;
     }
+
+    return false;
 } // matchesView
 
+/*
+   Finds the last alpha-numeric token of str that is a view name recognized by matchesView,
+   i.e: 'l', 'r' (short views), 'left', 'right' (long views) or 'viewN' (both).
+   Tokens are delimited by any non alpha-numeric character, e.g: shot_l.####.exr or shot.####.left.exr
+ */
 static bool
-matchesPattern_v2(const string& filename,
+findViewToken(const string& str,
+              size_t* tokenPos,
+              size_t* tokenSize,
+              bool* isShortView,
+              bool* isLongView,
+              int* viewNumber)
+{
+    bool found = false;
+    size_t i = 0;
+
+    while ( i < str.size() ) {
+        if ( !std::isalnum( (unsigned char)str[i] ) ) {
+            ++i;
+            continue;
+        }
+        size_t end = i;
+        while ( end < str.size() && std::isalnum( (unsigned char)str[end] ) ) {
+            ++end;
+        }
+        const size_t size = end - i;
+        int view = -1;
+        bool shortView = false;
+        bool longView = false;
+        if ( (size == 1) && ( (str[i] == 'l') || (str[i] == 'r') ) ) {
+            shortView = true;
+            view = str[i] == 'l' ? 0 : 1;
+        } else if ( ( (size == 4) && (str.compare(i, 4, "left") == 0) ) ||
+                    ( (size == 5) && (str.compare(i, 5, "right") == 0) ) ) {
+            longView = true;
+            view = size == 4 ? 0 : 1;
+        } else if ( (size > 4) && (str.compare(i, 4, "view") == 0) ) {
+            size_t digitIt = i + 4;
+            while ( digitIt < end && std::isdigit(str[digitIt]) ) {
+                ++digitIt;
+            }
+            if (digitIt == end) {
+                shortView = true;
+                longView = true;
+                view = stringToInt( str.substr(i + 4, size - 4) );
+            }
+        }
+        if (view != -1) {
+            found = true;
+            *tokenPos = i;
+            *tokenSize = size;
+            *isShortView = shortView;
+            *isLongView = longView;
+            *viewNumber = view;
+        }
+        i = end;
+    }
+
+    return found;
+} // findViewToken
+
+/*
+   If splitExtension is false, the name is matched whole against the pattern, e.g: a directory name such as
+   shot.0001 against shot.####, and patternExtension must be empty.
+ */
+static bool
+matchesPattern_v2(const char* filename,
+                  size_t filenameSize,
                   const string& pattern,
                   const string& patternExtension,
                   int* frameNumber,
-                  int* viewNumber)
+                  int* viewNumber,
+                  bool splitExtension = true)
 {
     ///If the frame number is found twice or more, this is to verify if they are identical
     bool wasFrameNumberSet = false;
@@ -551,17 +1059,28 @@ matchesPattern_v2(const string& filename,
     size_t filenameIt = 0;
     size_t patternIt = 0;
 
-    ///make a copy of the filename from which we remove the file extension
-    string filenameCpy = filename;
-    string fileExt = removeFileExtension(filenameCpy);
-
-    ///Extensions not matching, exit.
-    if (fileExt != patternExtension) {     //
-        return false;
+    ///the filename without its extension is the range [filename, filename + nameSize)
+    size_t nameSize = splitExtension ? filenameSize : 0;
+    while ( nameSize > 0 && filename[nameSize - 1] != '.' ) {
+        --nameSize;
+    }
+    if (nameSize == 0) {
+        ///no extension
+        if ( !patternExtension.empty() ) {
+            return false;
+        }
+        nameSize = filenameSize;
+    } else {
+        --nameSize;
+        ///Extensions not matching, exit.
+        if ( ( patternExtension.size() != filenameSize - nameSize - 1 ) ||
+             ( patternExtension.compare(0, string::npos, filename + nameSize + 1, patternExtension.size()) != 0 ) ) {
+            return false;
+        }
     }
 
     ///Iterating while not at end of either the pattern or the filename
-    while ( filenameIt < filenameCpy.size() && patternIt < pattern.size() ) {
+    while ( filenameIt < nameSize && patternIt < pattern.size() ) {
         ///the count of '#' characters found
         int sharpCount = 0;
 
@@ -620,7 +1139,7 @@ matchesPattern_v2(const string& filename,
             int fNumber = -1;
 
             ///check if the filename matches the number of hashes
-            if ( !matchesHashTag(sharpCount, filenameCpy, filenameIt, &endHashTag, &fNumber) ) {
+            if ( !matchesHashTag(sharpCount, filename, nameSize, filenameIt, &endHashTag, &fNumber) ) {
                 return false;
             }
 
@@ -643,7 +1162,7 @@ matchesPattern_v2(const string& filename,
             size_t endPrintfLike = 0;
             int fNumber = -1;
             ///check if the filename matches the %d syntax
-            if ( !matchesPrintfLikeSyntax(printfDigitCount, filenameCpy, filenameIt, &endPrintfLike, &fNumber) ) {
+            if ( !matchesPrintfLikeSyntax(printfDigitCount, filename, nameSize, filenameIt, &endPrintfLike, &fNumber) ) {
                 return false;
             }
 
@@ -666,7 +1185,7 @@ matchesPattern_v2(const string& filename,
             size_t endVar;
             int vNumber;
             ///check if the filename matches the %V syntax
-            if ( !matchesView(true, filenameCpy, filenameIt, &endVar, &vNumber) ) {
+            if ( !matchesView(true, filename, nameSize, filenameIt, &endVar, &vNumber) ) {
                 return false;
             }
 
@@ -689,7 +1208,7 @@ matchesPattern_v2(const string& filename,
             size_t endVar;
             int vNumber;
             ///check if the filename matches the %v syntax
-            if ( !matchesView(false, filenameCpy, filenameIt, &endVar, &vNumber) ) {
+            if ( !matchesView(false, filename, nameSize, filenameIt, &endVar, &vNumber) ) {
                 return false;
             }
 
@@ -707,7 +1226,7 @@ matchesPattern_v2(const string& filename,
             patternIt += 2;
         } else {
             ///we found nothing, just compare the characters
-            if (pattern[patternIt] != filenameCpy[filenameIt]) {
+            if (pattern[patternIt] != filename[filenameIt]) {
                 return false;
             }
             ++patternIt;
@@ -715,7 +1234,7 @@ matchesPattern_v2(const string& filename,
         }
     }
 
-    bool fileNameAtEnd =  filenameIt >= filenameCpy.size();
+    bool fileNameAtEnd =  filenameIt >= nameSize;
     bool patternAtEnd =  patternIt >= pattern.size();
     if (!fileNameAtEnd || !patternAtEnd) {
         return false;
@@ -724,6 +1243,119 @@ matchesPattern_v2(const string& filename,
     return true;
 } // matchesPattern_v2
 
+static bool
+matchesPattern_v2(const string& filename,
+                  const string& pattern,
+                  const string& patternExtension,
+                  int* frameNumber,
+                  int* viewNumber,
+                  bool splitExtension = true)
+{
+    return matchesPattern_v2(filename.data(), filename.size(), pattern, patternExtension, frameNumber, viewNumber, splitExtension);
+}
+
+/*
+   Conditions a file name must meet to match a pattern, which are much cheaper to check than running matchesPattern_v2.
+ */
+struct PatternPrefilter
+{
+    size_t minSize; //< the size of the shortest name that can match
+    bool hasVariables; //< if false, the name must be exactly minSize long
+    bool hasFrameVariable; //< if false, matchesPattern_v2 returns -1 as frame number
+    bool hasViewVariable; //< if false, matchesPattern_v2 returns 0 as view number
+    string prefix; //< the literal text before the first variable
+    string suffix; //< the literal text after the last variable, followed by the extension
+    bool hasExtension; //< if false, a name ending with '.' is matched without it
+    bool wholeName; //< if true, the extension of the name is not split off: a name ending with '.' keeps it
+    int minDigitsCount; //< the number of digits of the longest frame number variable
+};
+
+/*
+   Splits the pattern in literal text and variables the same way matchesPattern_v2 does.
+ */
+static void
+makePatternPrefilter(const string& pattern,
+                     const string& patternExtension,
+                     PatternPrefilter* filter)
+{
+    filter->minSize = 0;
+    filter->wholeName = false;
+    filter->hasVariables = false;
+    filter->hasFrameVariable = false;
+    filter->hasViewVariable = false;
+    filter->minDigitsCount = 0;
+    size_t prefixEnd = pattern.size();
+    size_t suffixStart = 0;
+    size_t i = 0;
+
+    while ( i < pattern.size() ) {
+        size_t variableEnd = string::npos;
+        size_t variableMinSize = 0;
+        if (pattern[i] == '#') {
+            variableEnd = i;
+            while ( variableEnd < pattern.size() && pattern[variableEnd] == '#' ) {
+                ++variableEnd;
+            }
+            variableMinSize = variableEnd - i;
+            filter->hasFrameVariable = true;
+            filter->minDigitsCount = std::max(filter->minDigitsCount, (int)variableMinSize);
+        } else if (pattern[i] == '%') {
+            size_t j = i + 1;
+            while ( j < pattern.size() && std::isdigit(pattern[j]) ) {
+                ++j;
+            }
+            if ( ( j < pattern.size() ) && (std::tolower(pattern[j]) == 'd') ) {
+                variableEnd = j + 1;
+                variableMinSize = stringToInt( pattern.substr(i + 1, j - i - 1) );
+                filter->hasFrameVariable = true;
+                filter->minDigitsCount = std::max(filter->minDigitsCount, (int)variableMinSize);
+            } else if ( ( j < pattern.size() ) && ( (pattern[j] == 'V') || (pattern[j] == 'v') ) ) {
+                ///like matchesPattern_v2, only the first 2 characters are part of the variable
+                variableEnd = i + 2;
+                variableMinSize = pattern[j] == 'V' ? 4 : 1; // "left" or "l"
+                filter->hasViewVariable = true;
+            }
+        }
+        if (variableEnd == string::npos) {
+            ///a literal character
+            ++filter->minSize;
+            ++i;
+        } else {
+            if (!filter->hasVariables) {
+                prefixEnd = i;
+                filter->hasVariables = true;
+            }
+            filter->minSize += variableMinSize;
+            suffixStart = variableEnd;
+            i = variableEnd;
+        }
+    }
+
+    filter->prefix = pattern.substr(0, prefixEnd);
+    filter->suffix = filter->hasVariables ? pattern.substr(suffixStart) : string();
+    filter->hasExtension = !patternExtension.empty();
+    if (filter->hasExtension) {
+        filter->suffix += '.';
+        filter->suffix += patternExtension;
+        filter->minSize += patternExtension.size() + 1;
+    }
+}
+
+static bool
+passesPatternPrefilter(const PatternPrefilter& filter,
+                       const char* filename,
+                       size_t filenameSize)
+{
+    ///an empty extension, as matchesPattern_v2 sees it
+    if ( !filter.hasExtension && !filter.wholeName && (filenameSize > 0) && (filename[filenameSize - 1] == '.') ) {
+        --filenameSize;
+    }
+
+    return ( filter.hasVariables ? filenameSize >= filter.minSize : filenameSize == filter.minSize ) &&
+           ( std::memcmp( filename, filter.prefix.data(), filter.prefix.size() ) == 0 ) &&
+           ( std::memcmp( filename + filenameSize - filter.suffix.size(), filter.suffix.data(), filter.suffix.size() ) == 0 );
+}
+
 static int countLeadingZeroes(const string& str)
 {
     int ret = 0;
@@ -741,6 +1373,289 @@ static int countLeadingZeroes(const string& str)
     return ret;
 }
 
+/*
+   Inserts the file in the sequence, returns false if there was already a file for this frame and view.
+ */
+static bool
+insertFileInSequence(int frameNumber,
+                     int viewNumber,
+                     const string& absoluteFileName,
+                     SequenceFromPattern* sequence)
+{
+    SequenceFromPattern::iterator it = sequence->find(frameNumber);
+
+    if ( it != sequence->end() ) {
+        pair<map<int, string>::iterator, bool> ret =
+            it->second.insert( make_pair(viewNumber, absoluteFileName) );
+        if (!ret.second) {
+#         ifdef DEBUG
+            std::cerr << "There was an issue populating the file sequence. Several files with the same frame number"
+                " have the same view index." << std::endl;
+#         endif
+
+            return false;
+        }
+    } else {
+        map<int, string> viewsMap;
+        viewsMap.insert( make_pair(viewNumber, absoluteFileName) );
+        sequence->insert( make_pair(frameNumber, viewsMap) );
+    }
+
+    return true;
+}
+
+/*
+   Inserts the file in the sequence if it matches the pattern split by filesListFromPattern_fast.
+ */
+static void
+insertFileIfMatching(const string& filename,
+                     const string& patternUnPathed,
+                     const string& patternExtension,
+                     const string& patternPath,
+                     SequenceFromPattern* sequence)
+{
+    int frameNumber;
+    int viewNumber;
+
+    if ( matchesPattern_v2(filename, patternUnPathed, patternExtension, &frameNumber, &viewNumber) ) {
+        insertFileInSequence(frameNumber, viewNumber, patternPath + filename, sequence);
+    }
+}
+
+/*
+   Reads the directory and inserts the matching files with their info.
+ */
+static void
+getMatchingFilesWithMetadataFromDir(tinydir_dir& dir,
+                                    const string& patternUnPathed,
+                                    const string& patternExtension,
+                                    const string& patternPath,
+                                    SequenceFromPattern* sequence,
+                                    SequenceFilesMetadata* metadata)
+{
+#ifndef _WIN32
+    ///Instead of letting tinydir stat every entry, read the names directly and only stat the matching files
+    ///relatively to the directory file descriptor.
+    const int dirFd = dirfd(dir._d);
+    while (dir.has_next) {
+        const struct dirent* entry = dir._e;
+#if defined(DT_DIR)
+        const bool isDir = entry && entry->d_type == DT_DIR;
+#else
+        const bool isDir = false;
+#endif
+        if (entry && !isDir) {
+            string filename(entry->d_name);
+            int frameNumber;
+            int viewNumber;
+            struct stat s;
+            if ( ( filename != ".") && ( filename != "..") &&
+                 matchesPattern_v2(filename, patternUnPathed, patternExtension, &frameNumber, &viewNumber) &&
+                 ( statDirectoryEntry(dirFd, entry->d_name, &s) == 0 ) && !S_ISDIR(s.st_mode) &&
+                 insertFileInSequence(frameNumber, viewNumber, patternPath + filename, sequence) ) {
+                FileInfo info;
+                info.size = (unsigned long long)s.st_size;
+                info.modificationTime = (long long)s.st_mtime * 1000000000LL;
+#if defined(__APPLE__)
+                info.modificationTime += s.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+                info.modificationTime += s.st_mtim.tv_nsec;
+#endif
+                metadata->frames.push_back(frameNumber);
+                metadata->views.push_back(viewNumber);
+                metadata->sizes.push_back(info.size);
+                metadata->modificationTimes.push_back(info.modificationTime);
+                metadata->inodes.push_back( (unsigned long long)s.st_ino );
+            }
+        }
+        nextDirectoryEntry(&dir);
+    }
+#else // _WIN32
+    StringList files;
+    getFilesFromDir(dir, &files);
+    for (size_t i = 0; i < files.size(); ++i) {
+        int frameNumber;
+        int viewNumber;
+        FileInfo info;
+        if ( matchesPattern_v2(files[i], patternUnPathed, patternExtension, &frameNumber, &viewNumber) &&
+             getFileInfo(patternPath + files[i], &info) &&
+             insertFileInSequence(frameNumber, viewNumber, patternPath + files[i], sequence) ) {
+            metadata->frames.push_back(frameNumber);
+            metadata->views.push_back(viewNumber);
+            metadata->sizes.push_back(info.size);
+            metadata->modificationTimes.push_back(info.modificationTime);
+            metadata->inodes.push_back(0);
+        }
+    }
+#endif // _WIN32
+} // getMatchingFilesWithMetadataFromDir
+
+#if __cplusplus >= 201103L
+/*
+   A minimal pool of threads running the posted tasks in order.
+ */
+class ThreadPool
+{
+public:
+
+    explicit ThreadPool(int threadsCount)
+        : _quit(false)
+    {
+        for (int i = 0; i < threadsCount; ++i) {
+            _threads.push_back( std::thread(&ThreadPool::run, this) );
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _cond.notify_all();
+        for (size_t i = 0; i < _threads.size(); ++i) {
+            _threads[i].join();
+        }
+    }
+
+    void post(const std::function<void ()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(task);
+        }
+        _cond.notify_one();
+    }
+
+private:
+
+    void run()
+    {
+        for (;;) {
+            std::function<void ()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [this] { return _quit || !_tasks.empty(); });
+                if ( _tasks.empty() ) {
+                    return;
+                }
+                task = std::move( _tasks.front() );
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<std::function<void ()> > _tasks;
+    std::vector<std::thread> _threads;
+    bool _quit;
+};
+
+/*
+   The pool reading directories for the asynchronous functions.
+   It is never destroyed because its threads may be blocked by a stalled file-system when the application exits.
+ */
+static ThreadPool&
+getIOThreadPool()
+{
+    static ThreadPool* pool = new ThreadPool(SEQUENCEPARSING_IO_THREADS_COUNT);
+
+    return *pool;
+}
+
+/*
+   The pool running the scans of filesListFromPattern_async. It is separate from the I/O pool so that scans
+   stalled by a file-system never hold the threads the synchronous functions wait for: at most
+   SEQUENCEPARSING_IO_THREADS_COUNT scans are read at once, the others are queued.
+   It is never destroyed for the same reason as the I/O pool.
+ */
+static ThreadPool&
+getScanThreadPool()
+{
+    static ThreadPool* pool = new ThreadPool(SEQUENCEPARSING_IO_THREADS_COUNT);
+
+    return *pool;
+}
+
+/*
+   Runs tasks on a single thread at their deadline, even if the thread that posted them is blocked.
+   It is never destroyed, like the pools.
+ */
+class DeadlineTimer
+{
+public:
+
+    DeadlineTimer()
+        : _mutex()
+        , _cond()
+        , _tasks()
+        , _thread(&DeadlineTimer::run, this)
+    {
+    }
+
+    void post(std::chrono::steady_clock::time_point deadline,
+              const std::function<void ()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.insert( make_pair(deadline, task) );
+        }
+        _cond.notify_one();
+    }
+
+private:
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            if ( _tasks.empty() ) {
+                _cond.wait(lock);
+                continue;
+            }
+            std::multimap<std::chrono::steady_clock::time_point, std::function<void ()> >::iterator first = _tasks.begin();
+            if (std::chrono::steady_clock::now() < first->first) {
+                _cond.wait_until(lock, first->first);
+                continue;
+            }
+            std::function<void ()> task = std::move(first->second);
+            _tasks.erase(first);
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void ()> > _tasks;
+    std::thread _thread; //< last, so that the other members are initialized when it starts
+};
+
+static DeadlineTimer&
+getDeadlineTimer()
+{
+    static DeadlineTimer* timer = new DeadlineTimer();
+
+    return *timer;
+}
+
+/*
+   The pool running CPU bound tasks, with one thread per core. It is separate from the I/O pool so that
+   these tasks are never queued behind a stalled directory read.
+ */
+static ThreadPool&
+getCPUThreadPool()
+{
+    static ThreadPool* pool = new ThreadPool( std::max(1, (int)std::thread::hardware_concurrency()) );
+
+    return *pool;
+}
+
+#endif // __cplusplus >= 201103L
+
 } // namespace {
 
 
@@ -765,6 +1680,23 @@ struct FileNameElement
 
 
 ////////////////////FileNameContent//////////////////////////
+///A pattern generated by FileNameContent::getFilePattern, immutable once published
+struct GeneratedPattern
+{
+    int numHashes;
+    string pattern;
+    const GeneratedPattern* next; //!< the pattern generated before this one
+
+    GeneratedPattern(int numHashes,
+                     const string& pattern,
+                     const GeneratedPattern* next)
+        : numHashes(numHashes)
+        , pattern(pattern)
+        , next(next)
+    {
+    }
+};
+
 struct FileNameContentPrivate
 {
     ///Ordered from left to right, these are the elements composing the filename without its path
@@ -773,8 +1705,12 @@ struct FileNameContentPrivate
     string filePath;     //!< the filepath
     string filename;     //!< the filename without path
     string extension;     //!< the file extension
-    string generatedPattern;
+    ///the results of getFilePattern, most recent first: they are read without locking and never modified, nodes
+    ///are only added at the head, under patternsMutex
+    LazyPointer<const GeneratedPattern>::type generatedPatterns;
     int leadingZeroes; //!< leading zeroes for the last number seen in the file path??? why store this?
+    unsigned long long signature; //!< hash of the text parts and of the numbers count
+    LazyInitMutex patternsMutex; //!< serializes the additions to generatedPatterns
 
     FileNameContentPrivate()
         : orderedElements()
@@ -782,10 +1718,102 @@ struct FileNameContentPrivate
         , filePath()
         , filename()
         , extension()
-        , generatedPattern()
+        , generatedPatterns(0)
         , leadingZeroes(0)
+        , signature(0)
+        , patternsMutex()
     {
     }
+
+    ~FileNameContentPrivate()
+    {
+        clearGeneratedPatterns();
+    }
+
+    ///Not thread-safe: the object must not be read meanwhile
+    void clearGeneratedPatterns()
+    {
+        const GeneratedPattern* generated = loadLazyPointer(generatedPatterns);
+
+        while (generated) {
+            const GeneratedPattern* next = generated->next;
+            delete generated;
+            generated = next;
+        }
+        storeLazyPointer<const GeneratedPattern>(generatedPatterns, 0);
+    }
+
+    const GeneratedPattern* findGeneratedPattern(int numHashes) const
+    {
+        for (const GeneratedPattern* generated = loadLazyPointer(generatedPatterns); generated; generated = generated->next) {
+            if (generated->numHashes == numHashes) {
+                return generated;
+            }
+        }
+
+        return 0;
+    }
+
+    ///Sets the extension, splits the filename in text parts and numbers and computes the signature.
+    ///filePath, filename and absoluteFileName must be set.
+    void tokenize()
+    {
+        // extension is everything after the last '.'
+        size_t lastDotPos = filename.find_last_of('.');
+        if (lastDotPos == string::npos) {
+            extension.clear();
+        } else {
+            extension = filename.substr(lastDotPos + 1);
+        }
+
+        std::locale loc;
+        string lastNumberStr;
+        string lastTextPart;
+        for (size_t i = 0; i < filename.size(); ++i) {
+            const char& c = filename[i];
+            if ( std::isdigit(c, loc) ) {
+                lastNumberStr += c;
+                if ( !lastTextPart.empty() ) {
+                    orderedElements.push_back( FileNameElement(lastTextPart, FileNameElement::TEXT) );
+                    lastTextPart.clear();
+                }
+            } else {
+                if ( !lastNumberStr.empty() ) {
+                    orderedElements.push_back( FileNameElement(lastNumberStr, FileNameElement::FRAME_NUMBER) );
+                    leadingZeroes = countLeadingZeroes(lastNumberStr);     //< take into account only the last FRAME_NUMBER
+                    lastNumberStr.clear();
+                }
+
+                lastTextPart.push_back(c);
+            }
+        }
+
+        if ( !lastNumberStr.empty() ) {
+            orderedElements.push_back( FileNameElement(lastNumberStr, FileNameElement::FRAME_NUMBER) );
+            leadingZeroes = countLeadingZeroes(lastNumberStr);     //< take into account only the last FRAME_NUMBER
+            lastNumberStr.clear();
+        }
+        if ( !lastTextPart.empty() ) {
+            orderedElements.push_back( FileNameElement(lastTextPart, FileNameElement::TEXT) );
+            lastTextPart.clear();
+        }
+
+        ///Files of the same sequence only differ by their numbers
+        int numbersCount = 0;
+        signature = kFingerprintSeed;
+        for (size_t i = 0; i < orderedElements.size(); ++i) {
+            const FileNameElement& e = orderedElements[i];
+            signature = combineHash(signature, e.type);
+            if (e.type == FileNameElement::TEXT) {
+                signature = hashString(signature, e.data);
+            } else {
+                ++numbersCount;
+            }
+        }
+        ///The extension is not hashed: if it is text it is already in the text parts, and if it is a number
+        ///(e.g: log.1, log.2) it may be the frame number
+        signature = combineHash(signature, numbersCount);
+    } // tokenize
 };
 
 
@@ -796,45 +1824,17 @@ FileNameContent::FileNameContent(const string& absoluteFilename)
     _imp->absoluteFileName = absoluteFilename;
     _imp->filename = absoluteFilename;
     _imp->filePath = removePath(_imp->filename);
-    std::locale loc;
-    string lastNumberStr;
-    string lastTextPart;
-    for (size_t i = 0; i < _imp->filename.size(); ++i) {
-        const char& c = _imp->filename[i];
-        if ( std::isdigit(c, loc) ) {
-            lastNumberStr += c;
-            if ( !lastTextPart.empty() ) {
-                _imp->orderedElements.push_back( FileNameElement(lastTextPart, FileNameElement::TEXT) );
-                lastTextPart.clear();
-            }
-        } else {
-            if ( !lastNumberStr.empty() ) {
-                _imp->orderedElements.push_back( FileNameElement(lastNumberStr, FileNameElement::FRAME_NUMBER) );
-                _imp->leadingZeroes = countLeadingZeroes(lastNumberStr);     //< take into account only the last FRAME_NUMBER
-                lastNumberStr.clear();
-            }
-
-            lastTextPart.push_back(c);
-        }
-    }
-
-    if ( !lastNumberStr.empty() ) {
-        _imp->orderedElements.push_back( FileNameElement(lastNumberStr, FileNameElement::FRAME_NUMBER) );
-        _imp->leadingZeroes = countLeadingZeroes(lastNumberStr);     //< take into account only the last FRAME_NUMBER
-        lastNumberStr.clear();
-    }
-    if ( !lastTextPart.empty() ) {
-        _imp->orderedElements.push_back( FileNameElement(lastTextPart, FileNameElement::TEXT) );
-        lastTextPart.clear();
-    }
+    _imp->tokenize();
+}
 
-    // extension is everything after the last '.'
-    size_t lastDotPos = _imp->filename.find_last_of('.');
-    if (lastDotPos == string::npos) {
-        _imp->extension.clear();
-    } else {
-        _imp->extension = _imp->filename.substr(lastDotPos + 1);
-    }
+FileNameContent::FileNameContent(const string& path,
+                                 const string& filename)
+    : _imp( new FileNameContentPrivate() )
+{
+    _imp->filePath = path;
+    _imp->filename = filename;
+    _imp->absoluteFileName = path + filename;
+    _imp->tokenize();
 }
 
 FileNameContent::FileNameContent(const FileNameContent& other)
@@ -850,12 +1850,24 @@ FileNameContent::~FileNameContent()
 void
 FileNameContent::operator=(const FileNameContent& other)
 {
+    if (&other == this) {
+        return;
+    }
     _imp->orderedElements = other._imp->orderedElements;
     _imp->absoluteFileName = other._imp->absoluteFileName;
     _imp->filename = other._imp->filename;
     _imp->filePath = other._imp->filePath;
     _imp->extension = other._imp->extension;
-    _imp->generatedPattern = other._imp->generatedPattern;
+    ///other may be read concurrently by other threads, which could be adding patterns at the head of its list:
+    ///the nodes read from its head are complete and never change
+    _imp->clearGeneratedPatterns();
+    const GeneratedPattern* copied = 0;
+    for (const GeneratedPattern* generated = loadLazyPointer(other._imp->generatedPatterns); generated; generated = generated->next) {
+        copied = new GeneratedPattern(generated->numHashes, generated->pattern, copied);
+        storeLazyPointer(_imp->generatedPatterns, copied);
+    }
+    _imp->leadingZeroes = other._imp->leadingZeroes;
+    _imp->signature = other._imp->signature;
 }
 
 int
@@ -864,6 +1876,12 @@ FileNameContent::getLeadingZeroes() const
     return _imp->leadingZeroes;
 }
 
+unsigned long long
+FileNameContent::getSignature() const
+{
+    return _imp->signature;
+}
+
 /**
  * @brief Returns the file path, e.g: /Users/Lala/Pictures/ with the trailing separator.
  **/
@@ -903,31 +1921,42 @@ FileNameContent::getExtension() const
 const string&
 FileNameContent::getFilePattern(int numHashes) const
 {
-    if ( _imp->generatedPattern.empty() ) {
-        ///now build the generated pattern with the ordered elements.
-        int numberIndex = 0;
-        for (size_t j = 0; j < _imp->orderedElements.size(); ++j) {
-            const FileNameElement& e = _imp->orderedElements[j];
-            switch (e.type) {
-            case FileNameElement::TEXT:
-                _imp->generatedPattern.append(e.data);
-                break;
-            case FileNameElement::FRAME_NUMBER: {
-                string hashStr;
-                for (int c = 0; c < numHashes; ++c) {
-                    hashStr.push_back('#');
-                }
-                _imp->generatedPattern.append( hashStr + stringFromInt(numberIndex) );
-                ++numberIndex;
-            }
+    numHashes = std::max(numHashes, 0);
+    const GeneratedPattern* found = _imp->findGeneratedPattern(numHashes);
+    if (found) {
+        return found->pattern;
+    }
+
+    LazyInitLocker locker(_imp->patternsMutex);
+    ///another thread may have generated it while we were waiting for the lock
+    found = _imp->findGeneratedPattern(numHashes);
+    if (found) {
+        return found->pattern;
+    }
+
+    ///now build the generated pattern with the ordered elements.
+    string generatedPattern;
+    int numberIndex = 0;
+    for (size_t j = 0; j < _imp->orderedElements.size(); ++j) {
+        const FileNameElement& e = _imp->orderedElements[j];
+        switch (e.type) {
+        case FileNameElement::TEXT:
+            generatedPattern.append(e.data);
+            break;
+        case FileNameElement::FRAME_NUMBER: {
+            generatedPattern.append(numHashes, '#');
+            generatedPattern.append( stringFromInt(numberIndex) );
+            ++numberIndex;
+        }
+        break;
+        default:
             break;
-            default:
-                break;
-            }
         }
     }
+    const GeneratedPattern* generated = new GeneratedPattern( numHashes, generatedPattern, loadLazyPointer(_imp->generatedPatterns) );
+    storeLazyPointer(_imp->generatedPatterns, generated);
 
-    return _imp->generatedPattern;
+    return generated->pattern;
 }
 
 /**
@@ -985,14 +2014,15 @@ FileNameContent::matchesPattern(const FileNameContent& other,
 {
     const vector<FileNameElement>& otherElements = other._imp->orderedElements;
 
-    if ( otherElements.size() != _imp->orderedElements.size() ) {
-        return false;
-    }
-
     ///We only consider the last potential frame number
     ///
     *numberIndexToVary = -1;
 
+    ///Files with a different structure cannot match
+    if ( ( other._imp->signature != _imp->signature ) || ( otherElements.size() != _imp->orderedElements.size() ) ) {
+        return false;
+    }
+
     int numbersCount = 0;
     for (size_t i = 0; i < _imp->orderedElements.size(); ++i) {
         if (_imp->orderedElements[i].type != otherElements[i].type) {
@@ -1015,7 +2045,7 @@ FileNameContent::matchesPattern(const FileNameContent& other,
                     ( otherElements[i].data.size() > 0) && ( otherElements[i].data[0] != '0') ) {
                     isOK = true;
                 } else {
-                    isOK = numberMatchDigits(hashesCount, otherElements[i].data, &number);
+                    isOK = numberMatchDigits(hashesCount, otherElements[i].data.data(), otherElements[i].data.size(), &number);
                 }
             }
 
@@ -1078,513 +2108,4293 @@ FileNameContent::generatePatternWithFrameNumberAtIndex(int index,
                                                        string* pattern) const
 {
     int numbersCount = 0;
-    size_t lastNumberPos = 0;
 
-    string indexedPattern = getFilePattern(numHashes);
+    ///This is getFilePattern(numHashes) with the tag indexes removed and the other tags expanded, built
+    ///straight from the elements so that it does not need to lock the patterns cache
+    *pattern = getPath();
+    pattern->reserve( pattern->size() + _imp->filename.size() + std::max(numHashes, 0) );
     for (size_t i = 0; i < _imp->orderedElements.size(); ++i) {
-        if (_imp->orderedElements[i].type == FileNameElement::FRAME_NUMBER) {
-            lastNumberPos = findStr(indexedPattern, "#", 0);
-            assert(lastNumberPos != string::npos);
-
-            size_t endTagPos = lastNumberPos;
-            while (endTagPos < indexedPattern.size() && indexedPattern[endTagPos] == '#') {
-                ++endTagPos;
-            }
-
-            ///assert that the end of the tag is composed of  a digit
-
-            if ( endTagPos < indexedPattern.size() ) {
-                assert( std::isdigit(indexedPattern[endTagPos]) );
-            }
-
+        const FileNameElement& e = _imp->orderedElements[i];
+        if (e.type == FileNameElement::TEXT) {
+            pattern->append(e.data);
+        } else if (e.type == FileNameElement::FRAME_NUMBER) {
             if (index == numbersCount) {
-                ///remove the index of the tag and keep the tag.
-                if ( endTagPos < indexedPattern.size() ) {
-                    indexedPattern.erase(endTagPos, 1);
-                }
+                pattern->append(std::max(numHashes, 0), '#');
             } else {
                 ///if this is not the number we're interested in to keep the ###, just expand the variable
-                ///replace the whole tag with the original data
-                indexedPattern.replace(lastNumberPos, endTagPos - lastNumberPos + 1, _imp->orderedElements[i].data);
+                pattern->append(e.data);
             }
-
             ++numbersCount;
         }
     }
-
-    *pattern = getPath() + indexedPattern;
 }
 
 string
 removePath(string& filename)
 {
-    ///find the last separator
-    size_t pos = filename.find_last_of('/');
+    ///the path includes the trailing separator
+    const size_t nameStart = findFileNameStart( filename.data(), filename.size() );
+    string path = filename.substr(0, nameStart);
 
-    if (pos == string::npos) {
-        //try out \\ char
-        pos = filename.find_last_of('\\');
-    }
-    if (pos == string::npos) {
-        ///couldn't find a path
-        return "";
-    }
-    string path = filename.substr(0, pos + 1);  // + 1 to include the trailing separator
-    removeAllOccurences(filename, path);
+    filename.erase(0, nameStart);
 
     return path;
 }
 
-bool
-filesListFromPattern_fast(const string& pattern,
-                          const StringList &files,
-                          SequenceParsing::SequenceFromPattern* sequence)
+#if __cplusplus >= 201703L
+std::pair<std::string_view, std::string_view>
+splitPath(std::string_view filename)
 {
-    if ( pattern.empty() ) {
+    const size_t nameStart = findFileNameStart( filename.data(), filename.size() );
+
+    return std::make_pair( filename.substr(0, nameStart), filename.substr(nameStart) );
+}
+#endif
+
+namespace {
+/*
+   The functions taking a pattern are implemented on its characters, so that the overloads taking a std::string,
+   a view or a null-terminated string do not copy it more than needed.
+ */
+static bool
+filesListFromPattern_fastInternal(const char* pattern,
+                                  size_t patternSize,
+                                  const StringList &files,
+                                  SequenceParsing::SequenceFromPattern* sequence)
+{
+    if (patternSize == 0) {
         return false;
     }
-    string patternUnPathed = pattern;
-    string patternPath = removePath(patternUnPathed);
+    const size_t nameStart = findFileNameStart(pattern, patternSize);
+    string patternPath(pattern, nameStart);
+    string patternUnPathed(pattern + nameStart, patternSize - nameStart);
     string patternExtension = removeFileExtension(patternUnPathed);
 
     for (size_t i = 0; i < files.size(); ++i) {
-        int frameNumber;
-        int viewNumber;
-        if ( matchesPattern_v2(files[i], patternUnPathed, patternExtension, &frameNumber, &viewNumber) ) {
-            SequenceFromPattern::iterator it = sequence->find(frameNumber);
-            string absoluteFileName = patternPath + files[i];
-            if ( it != sequence->end() ) {
-                pair<map<int, string>::iterator, bool> ret =
-                    it->second.insert( make_pair(viewNumber, absoluteFileName) );
-                if (!ret.second) {
-#                 ifdef DEBUG
-                    std::cerr << "There was an issue populating the file sequence. Several files with the same frame number"
-                        " have the same view index." << std::endl;
-#                 endif
-                }
-            } else {
-                map<int, string> viewsMap;
-                viewsMap.insert( make_pair(viewNumber, absoluteFileName) );
-                sequence->insert( make_pair(frameNumber, viewsMap) );
-            }
-        }
+        insertFileIfMatching(files[i], patternUnPathed, patternExtension, patternPath, sequence);
     }
 
     return true;
 }
+} // namespace {
 
 bool
-filesListFromPattern_slow(const string& pattern,
+filesListFromPattern_fast(const string& pattern,
+                          const StringList &files,
                           SequenceParsing::SequenceFromPattern* sequence)
 {
-    if ( pattern.empty() ) {
-        return false;
-    }
+    return filesListFromPattern_fastInternal(pattern.data(), pattern.size(), files, sequence);
+}
 
-    string patternUnPathed = pattern;
-    string patternPath = removePath(patternUnPathed);
+#if __cplusplus >= 201703L
+bool
+filesListFromPattern_fast(std::string_view pattern,
+                          const StringList &files,
+                          SequenceParsing::SequenceFromPattern* sequence)
+{
+    return filesListFromPattern_fastInternal(pattern.data(), pattern.size(), files, sequence);
+}
 
-    tinydir_dir patternDir;
-    if (tinydir_open( &patternDir, patternPath.c_str() ) == -1) {
-        return false;
-    }
+bool
+filesListFromPattern_fast(const char* pattern,
+                          const StringList &files,
+                          SequenceParsing::SequenceFromPattern* sequence)
+{
+    return filesListFromPattern_fastInternal(pattern, std::strlen(pattern), files, sequence);
+}
+#endif
 
-    ///all the interesting files of the pattern directory
-    StringList files;
-    getFilesFromDir(patternDir, &files);
-    tinydir_close(&patternDir);
+FileTable::FileTable()
+    : _buffer()
+    , _offsets()
+    , _sizes()
+{
+}
 
-    return filesListFromPattern_fast(pattern, files, sequence);
+void
+FileTable::clear()
+{
+    _buffer.clear();
+    _offsets.clear();
+    _sizes.clear();
 }
 
-StringList
-sequenceFromPatternToFilesList(const SequenceParsing::SequenceFromPattern& sequence,
-                               int onlyViewIndex)
+void
+FileTable::reserve(size_t namesCount,
+                   size_t charactersCount)
+{
+    _buffer.reserve(charactersCount);
+    _offsets.reserve(namesCount);
+    _sizes.reserve(namesCount);
+}
+
+void
+FileTable::append(const char* name,
+                  size_t size)
 {
-    StringList ret;
+    _offsets.push_back( _buffer.size() );
+    _sizes.push_back(size);
+    _buffer.append(name, size);
+}
+
+void
+FileTable::append(const string& name)
+{
+    append( name.data(), name.size() );
+}
 
-    for (SequenceParsing::SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
-        const map<int, string>& views = it->second;
+DirectoryListingFilter::DirectoryListingFilter()
+    : extensions()
+    , prefix()
+    , excludeHidden(false)
+    , minDigitsCount(0)
+{
+}
 
-        for (map<int, string>::const_iterator it2 = views.begin(); it2 != views.end(); ++it2) {
-            if ( ( onlyViewIndex != -1) && ( it2->first != onlyViewIndex) && ( it2->first != -1) ) {
-                continue;
+bool
+DirectoryListingFilter::accepts(const char* name,
+                                size_t size) const
+{
+    if ( excludeHidden && (size > 0) && (name[0] == '.') ) {
+        return false;
+    }
+    if ( ( size < prefix.size() ) || ( std::memcmp( name, prefix.data(), prefix.size() ) != 0 ) ) {
+        return false;
+    }
+    if ( !extensions.empty() ) {
+        size_t dot = size;
+        while (dot > 0 && name[dot - 1] != '.') {
+            --dot;
+        }
+        if (dot == 0) {
+            return false;
+        }
+        const char* extension = name + dot;
+        const size_t extensionSize = size - dot;
+        bool found = false;
+        for (size_t i = 0; i < extensions.size() && !found; ++i) {
+            found = extensions[i].size() == extensionSize;
+            for (size_t j = 0; j < extensionSize && found; ++j) {
+                found = std::tolower( (unsigned char)extension[j] ) == std::tolower( (unsigned char)extensions[i][j] );
             }
-            ret.push_back(it2->second);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    if (minDigitsCount > 0) {
+        int digitsCount = 0;
+        for (size_t i = 0; i < size && digitsCount < minDigitsCount; ++i) {
+            digitsCount = std::isdigit( (unsigned char)name[i] ) ? digitsCount + 1 : 0;
+        }
+        if (digitsCount < minDigitsCount) {
+            return false;
         }
     }
 
-    return ret;
-}
+    return true;
+} // DirectoryListingFilter::accepts
 
-string
-generateFileNameFromPattern(const string& pattern,
-                            const vector<string>& viewNames,
-                            int frameNumber,
-                            int viewNumber)
+void
+getDirectoryListingFilterFromPattern(const string& pattern,
+                                     DirectoryListingFilter* filter)
 {
     string patternUnPathed = pattern;
-    string patternPath = removePath(patternUnPathed);
+
+    removePath(patternUnPathed);
     string patternExtension = removeFileExtension(patternUnPathed);
+    PatternPrefilter prefilter;
+    makePatternPrefilter(patternUnPathed, patternExtension, &prefilter);
 
-    ///the pattern has no extension, switch the extension and the unpathed part
-    if ( patternUnPathed.empty() ) {
-        patternUnPathed = patternExtension;
-        patternExtension.clear();
+    *filter = DirectoryListingFilter();
+    filter->prefix = prefilter.prefix;
+    if ( prefilter.hasExtension && (patternExtension.find_first_of("#%") == string::npos) ) {
+        filter->extensions.push_back(patternExtension);
     }
-    ///this list represents the common parts of the filename to find in a file in order for it to match the pattern.
-    StringList commonPartsToFind;
-    ///this list represents the variables ( ###  %04d %v etc...) found in the pattern ordered from left to right in the
-    ///original string.
-    vector<pair<string, int> > variablesByOrder;
-    extractCommonPartsAndVariablesFromPattern(pattern, patternExtension, &commonPartsToFind, &variablesByOrder);
-
-    string output = pattern;
-    size_t lastVariablePos = string::npos;
-    for (size_t i = 0; i < variablesByOrder.size(); ++i) {
-        const string& variable = variablesByOrder[i].first;
-        lastVariablePos = findStr(output, variable, lastVariablePos != string::npos ? lastVariablePos : 0);
-
-        ///if we can't find the variable that means extractCommonPartsAndVariablesFromPattern is bugged.
-        assert(lastVariablePos != string::npos);
+    filter->minDigitsCount = prefilter.minDigitsCount;
+}
 
-        if (variable.find_first_of('#') != string::npos) {
-            string frameNoStr = stringFromInt(frameNumber);
-            ///prepend with extra 0's
-            while ( frameNoStr.size() < variable.size() ) {
-                frameNoStr.insert(0, 1, '0');
-            }
-            output.replace(lastVariablePos, variable.size(), frameNoStr);
-        } else if (variable.find("%v") != string::npos) {
-            string viewNumberStr;
-            if ( ( viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
-                viewNumberStr.push_back( std::toupper(viewNames[viewNumber][0]) );
-            }
+bool
+FileTable::appendDirectory(const string& path)
+{
+    return appendDirectory( path, DirectoryListingFilter() );
+}
 
+bool
+FileTable::appendDirectory(const string& path,
+                           const DirectoryListingFilter& filter)
+{
+    tinydir_dir dir;
 
-            output.replace(lastVariablePos, variable.size(), viewNumberStr);
-        } else if (variable.find("%V") != string::npos) {
-            if ( ( viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
-                const string& viewNumberStr = viewNames[viewNumber];
-                output.replace(lastVariablePos, variable.size(), viewNumberStr);
-            }
-        } else if ( startsWith(variable, "%0") && endsWith(variable, "d") ) {
-            string digitsCountStr = variable;
-            removeAllOccurences(digitsCountStr, "%0");
-            removeAllOccurences(digitsCountStr, "d");
-            int digitsCount = stringToInt(digitsCountStr);
-            string frameNoStr = stringFromInt(frameNumber);
-            //prepend with extra 0's
-            while ( (int)frameNoStr.size() < digitsCount ) {
-                frameNoStr.insert(0, 1, '0');
-            }
-            output.replace(lastVariablePos, variable.size(), frameNoStr);
-        } else if (variable == "%d") {
-            output.replace( lastVariablePos, variable.size(), stringFromInt(frameNumber) );
-        } else {
-            throw std::invalid_argument("Unrecognized pattern: " + pattern);
+    if ( !openDirectory(&dir, path) ) {
+        return false;
+    }
+    while (dir.has_next) {
+        tinydir_file file;
+        const char* name;
+        size_t size;
+        if ( readDirectoryFileName(dir, filter, &file, &name, &size) ) {
+            append(name, size);
         }
+        nextDirectoryEntry(&dir);
     }
+    tinydir_close(&dir);
 
-    return output;
-} // generateFileNameFromPattern
+    return true;
+} // FileTable::appendDirectory
 
-struct SequenceFromFilesPrivate
+size_t
+FileTable::size() const
 {
-    ///all the files mapped to their index
-    map<int, FileNameContent> filesMap;
-
-    /// The index of the frame number string in case there're several numbers in a filename.
-    int frameNumberStringIndex;
-    unsigned long long totalSize;
-    bool sizeEstimationEnabled;
-    int minNumHashes;     //< the minimum number of hash tags # for the pattern
+    return _sizes.size();
+}
 
-    SequenceFromFilesPrivate(bool enableSizeEstimation)
+bool
+FileTable::empty() const
+{
+    return _sizes.empty();
+}
 
-        : filesMap()
-        , frameNumberStringIndex(-1)
-        , totalSize(0)
-        , sizeEstimationEnabled(enableSizeEstimation)
-        , minNumHashes(0)
-    {
-    }
+const char*
+FileTable::getName(size_t index) const
+{
+    assert( index < _offsets.size() );
 
-    bool isInSequence(int index) const
-    {
-        return filesMap.find(index) != filesMap.end();
-    }
-};
+    return _buffer.data() + _offsets[index];
+}
 
-SequenceFromFiles::SequenceFromFiles(bool enableSizeEstimation)
-    : _imp( new SequenceFromFilesPrivate(enableSizeEstimation) )
+size_t
+FileTable::getNameSize(size_t index) const
 {
+    assert( index < _sizes.size() );
+
+    return _sizes[index];
 }
 
-SequenceFromFiles::SequenceFromFiles(const FileNameContent& firstFile,
-                                     bool enableSizeEstimation)
-    : _imp( new SequenceFromFilesPrivate(enableSizeEstimation) )
+string
+FileTable::getNameString(size_t index) const
 {
-    tryInsertFile(firstFile);
+    return string( getName(index), getNameSize(index) );
 }
 
-SequenceFromFiles::~SequenceFromFiles()
+namespace {
+static bool
+filesListFromPattern_fastInternal(const char* pattern,
+                                  size_t patternSize,
+                                  const FileTable& files,
+                                  SequenceParsing::SequenceFromPattern* sequence)
 {
+    if (patternSize == 0) {
+        return false;
+    }
+    const size_t nameStart = findFileNameStart(pattern, patternSize);
+    string patternPath(pattern, nameStart);
+    string patternUnPathed(pattern + nameStart, patternSize - nameStart);
+    string patternExtension = removeFileExtension(patternUnPathed);
+
+    PatternPrefilter filter;
+    makePatternPrefilter(patternUnPathed, patternExtension, &filter);
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        const char* filename = files.getName(i);
+        const size_t filenameSize = files.getNameSize(i);
+        int frameNumber;
+        int viewNumber;
+        if ( passesPatternPrefilter(filter, filename, filenameSize) &&
+             matchesPattern_v2(filename, filenameSize, patternUnPathed, patternExtension, &frameNumber, &viewNumber) ) {
+            insertFileInSequence( frameNumber, viewNumber, patternPath + string(filename, filenameSize), sequence );
+        }
+    }
+
+    return true;
 }
+} // namespace {
 
-SequenceFromFiles::SequenceFromFiles(const SequenceFromFiles& other)
-    : _imp( new SequenceFromFilesPrivate(false) )
+bool
+filesListFromPattern_fast(const string& pattern,
+                          const FileTable& files,
+                          SequenceParsing::SequenceFromPattern* sequence)
 {
-    *this = other;
+    return filesListFromPattern_fastInternal(pattern.data(), pattern.size(), files, sequence);
 }
 
-void
-SequenceFromFiles::operator=(const SequenceFromFiles& other) const
+#if __cplusplus >= 201703L
+bool
+filesListFromPattern_fast(std::string_view pattern,
+                          const FileTable& files,
+                          SequenceParsing::SequenceFromPattern* sequence)
 {
-    _imp->filesMap = other._imp->filesMap;
-    _imp->frameNumberStringIndex = other._imp->frameNumberStringIndex;
-    _imp->totalSize = other._imp->totalSize;
-    _imp->sizeEstimationEnabled = other._imp->sizeEstimationEnabled;
+    return filesListFromPattern_fastInternal(pattern.data(), pattern.size(), files, sequence);
 }
 
 bool
-SequenceFromFiles::tryInsertFile(const FileNameContent& file,
-                                 bool checkPath)
+filesListFromPattern_fast(const char* pattern,
+                          const FileTable& files,
+                          SequenceParsing::SequenceFromPattern* sequence)
 {
-    if ( _imp->filesMap.empty() ) {
-        ///Special case when the sequence is empty, we don't have anything to match against.
-        string frameNumberStr;
-        _imp->frameNumberStringIndex = file.getPotentialFrameNumbersCount() - 1;
-        int frameNumber = -1;
-        bool ok = file.getNumberByIndex(_imp->frameNumberStringIndex, &frameNumberStr);
-        if (ok) {
-            frameNumber = stringToInt(frameNumberStr);
-        }
-        _imp->filesMap.insert( make_pair(frameNumber, file) );
+    return filesListFromPattern_fastInternal(pattern, std::strlen(pattern), files, sequence);
+}
+#endif
 
-        _imp->minNumHashes = (int)frameNumberStr.size();
+#if __cplusplus >= 201103L
+namespace {
+///A file matched by a chunk of filesListFromPattern_fast
+struct ChunkMatch
+{
+    int frame;
+    int view;
+    size_t index; //< in the files list
 
-        if (_imp->sizeEstimationEnabled) {
-            _imp->totalSize += getFileSize( file.absoluteFileName() );
+    bool operator<(const ChunkMatch& other) const
+    {
+        if (frame != other.frame) {
+            return frame < other.frame;
+        }
+        if (view != other.view) {
+            return view < other.view;
         }
 
-        return true;
+        return index < other.index;
     }
+};
+} // namespace {
+#endif
 
-    assert( !_imp->filesMap.empty() );
+bool
+filesListFromPattern_fast(const string& pattern,
+                          const StringList& files,
+                          SequenceParsing::SequenceFromPattern* sequence,
+                          int threadsCount)
+{
+#if __cplusplus >= 201103L
+    if (threadsCount <= 0) {
+        threadsCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    const size_t chunksCount = std::min( (size_t)threadsCount, files.size() / SEQUENCEPARSING_MIN_FILES_PER_MATCHING_CHUNK );
+    if ( (chunksCount <= 1) || pattern.empty() ) {
+        return filesListFromPattern_fast(pattern, files, sequence);
+    }
+    string patternUnPathed = pattern;
+    string patternPath = removePath(patternUnPathed);
+    string patternExtension = removeFileExtension(patternUnPathed);
 
-    const FileNameContent& firstFileContent = _imp->filesMap.begin()->second;
+    ///Each chunk matches a contiguous range of the files in its own flat vector
+    vector<vector<ChunkMatch> > chunksMatches(chunksCount);
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t chunksLeft = chunksCount;
+    const size_t chunkSize = (files.size() + chunksCount - 1) / chunksCount;
+    for (size_t c = 0; c < chunksCount; ++c) {
+        getCPUThreadPool().post([&, c] {
+            vector<ChunkMatch>& matches = chunksMatches[c];
+            const size_t end = std::min( files.size(), (c + 1) * chunkSize );
+            for (size_t i = c * chunkSize; i < end; ++i) {
+                ChunkMatch match;
+                if ( matchesPattern_v2(files[i], patternUnPathed, patternExtension, &match.frame, &match.view) ) {
+                    match.index = i;
+                    matches.push_back(match);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--chunksLeft == 0) {
+                cond.notify_one();
+            }
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return chunksLeft == 0; });
+    }
+
+    vector<ChunkMatch> matches;
+    size_t matchesCount = 0;
+    for (size_t c = 0; c < chunksCount; ++c) {
+        matchesCount += chunksMatches[c].size();
+    }
+    matches.reserve(matchesCount);
+    for (size_t c = 0; c < chunksCount; ++c) {
+        matches.insert( matches.end(), chunksMatches[c].begin(), chunksMatches[c].end() );
+        vector<ChunkMatch>().swap(chunksMatches[c]);
+    }
+    std::sort( matches.begin(), matches.end() );
+
+    ///Sorted by frame and view, so each file is inserted at the end of the maps. For a given frame and view
+    ///the file with the lowest index comes first and is the one kept, as in the serial version.
+    SequenceFromPattern::iterator frameIt = sequence->end();
+    for (size_t i = 0; i < matches.size(); ++i) {
+        const ChunkMatch& match = matches[i];
+        if ( (frameIt == sequence->end()) || (frameIt->first != match.frame) ) {
+            frameIt = sequence->insert( sequence->end(), make_pair( match.frame, map<int, string>() ) );
+        }
+        if ( (i > 0) && (matches[i - 1].frame == match.frame) && (matches[i - 1].view == match.view) ) {
+            continue;
+        }
+        frameIt->second.insert( frameIt->second.end(), make_pair(match.view, patternPath + files[match.index]) );
+    }
 
+    return true;
+#else
+    (void)threadsCount;
 
-    if ( checkPath && ( file.getPath() != firstFileContent.getPath() ) ) {
+    return filesListFromPattern_fast(pattern, files, sequence);
+#endif // if __cplusplus >= 201103L
+} // filesListFromPattern_fast
+
+namespace {
+static bool
+filesListFromPattern_slowInternal(const char* pattern,
+                                  size_t patternSize,
+                                  SequenceParsing::SequenceFromPattern* sequence)
+{
+    if (patternSize == 0) {
         return false;
     }
+    const size_t nameStart = findFileNameStart(pattern, patternSize);
 
-    ///If the filename has several numbers, such as toto11_titi22.jpg
-    ///This corresponds to the index of the number in which the frame number is expected to be.
-    ///e.g in this example if 22 would be the frame number, frameNumberIndex would be 1.
-    int frameNumberIndex;
-    bool insert = false;
+    ///all the interesting files of the pattern directory, the files which cannot match are skipped while reading it
+    DirectoryListingFilter filter;
+    getDirectoryListingFilterFromPattern(string(pattern + nameStart, patternSize - nameStart), &filter);
+    FileTable files;
+    if ( !files.appendDirectory(string(pattern, nameStart), filter) ) {
+        return false;
+    }
+
+    return filesListFromPattern_fastInternal(pattern, patternSize, files, sequence);
+}
+} // namespace {
+
+bool
+filesListFromPattern_slow(const string& pattern,
+                          SequenceParsing::SequenceFromPattern* sequence)
+{
+    return filesListFromPattern_slowInternal(pattern.data(), pattern.size(), sequence);
+}
+
+#if __cplusplus >= 201703L
+bool
+filesListFromPattern_slow(std::string_view pattern,
+                          SequenceParsing::SequenceFromPattern* sequence)
+{
+    return filesListFromPattern_slowInternal(pattern.data(), pattern.size(), sequence);
+}
+
+bool
+filesListFromPattern_slow(const char* pattern,
+                          SequenceParsing::SequenceFromPattern* sequence)
+{
+    return filesListFromPattern_slowInternal(pattern, std::strlen(pattern), sequence);
+}
+#endif
+
+bool
+filesListFromPattern_slow(const string& pattern,
+                          SequenceParsing::SequenceFromPattern* sequence,
+                          SequenceFilesMetadata* metadata)
+{
+    if ( pattern.empty() ) {
+        return false;
+    }
+
+    string patternUnPathed = pattern;
+    string patternPath = removePath(patternUnPathed);
+    string patternExtension = removeFileExtension(patternUnPathed);
+
+    tinydir_dir patternDir;
+    if ( !openDirectory(&patternDir, patternPath) ) {
+        return false;
+    }
+    getMatchingFilesWithMetadataFromDir(patternDir, patternUnPathed, patternExtension, patternPath, sequence, metadata);
+    tinydir_close(&patternDir);
+
+    return true;
+}
+
+namespace {
+/*
+   Appends the names of the sub-directories of the directory, without their path.
+ */
+static bool
+appendSubdirectories(const string& path,
+                     FileTable* table)
+{
+    tinydir_dir dir;
+
+    if ( !openDirectory(&dir, path) ) {
+        return false;
+    }
+#ifndef _WIN32
+    const int dirFd = dirfd(dir._d);
+    while (dir.has_next) {
+        const struct dirent* entry = dir._e;
+        if (entry) {
+            const size_t size = std::strlen(entry->d_name);
+            bool isDir = !( (size == 1) && (entry->d_name[0] == '.') ) &&
+                         !( (size == 2) && (entry->d_name[0] == '.') && (entry->d_name[1] == '.') );
+#if defined(DT_DIR)
+            if ( isDir && (entry->d_type == DT_REG) ) {
+                isDir = false;
+            } else if ( isDir && (entry->d_type != DT_DIR) ) {
+#else
+            if (isDir) {
+#endif
+                ///symbolic links and file-systems not filling d_type
+                struct stat s;
+                isDir = statDirectoryEntry(dirFd, entry->d_name, &s) == 0 && S_ISDIR(s.st_mode);
+            }
+            if (isDir) {
+                table->append(entry->d_name, size);
+            }
+        }
+        nextDirectoryEntry(&dir);
+    }
+#else
+    while (dir.has_next) {
+        tinydir_file file;
+        if ( (readDirectoryEntry(&dir, &file) == 0) && file.is_dir &&
+             ( string(file.name) != "." ) && ( string(file.name) != ".." ) ) {
+            table->append(file.name);
+        }
+        nextDirectoryEntry(&dir);
+    }
+#endif
+    tinydir_close(&dir);
+
+    return true;
+} // appendSubdirectories
+
+/*
+   Lists the directories, concurrently on the I/O thread pool if available. Directories that cannot be opened
+   have an empty listing. The filter only applies to the listings of files.
+ */
+static void
+listDirectories(const StringList& paths,
+                bool subdirectories,
+                const DirectoryListingFilter& filter,
+                vector<FileTable>* listings)
+{
+    listings->resize( paths.size() );
+#if __cplusplus >= 201103L
+    if (paths.size() > 1) {
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t left = paths.size();
+        for (size_t i = 0; i < paths.size(); ++i) {
+            getIOThreadPool().post([&, i] {
+                FileTable& listing = (*listings)[i];
+                if (subdirectories) {
+                    appendSubdirectories(paths[i], &listing);
+                } else {
+                    listing.appendDirectory(paths[i], filter);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--left == 0) {
+                    cond.notify_one();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return left == 0; });
+
+        return;
+    }
+#endif
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (subdirectories) {
+            appendSubdirectories(paths[i], &(*listings)[i]);
+        } else {
+            (*listings)[i].appendDirectory(paths[i], filter);
+        }
+    }
+}
+
+///A directory matching the components of the pattern seen so far
+struct NestedCandidate
+{
+    string path;
+    int frameNumber;
+    int viewNumber;
+    bool hasFrameNumber;
+    bool hasViewNumber;
+};
+
+/*
+   A component of the pattern (directory or file name) split the same way as the file name of a pattern.
+ */
+struct NestedComponent
+{
+    string unPathed;
+    string extension;
+    PatternPrefilter filter;
+
+    ///Directory names are matched whole: in shot.####/ the frame number is not an extension
+    NestedComponent(const string& component,
+                    bool isDirectory)
+        : unPathed(component)
+        , extension()
+        , filter()
+    {
+        if (!isDirectory) {
+            extension = removeFileExtension(unPathed);
+        }
+        makePatternPrefilter(unPathed, extension, &filter);
+        filter.wholeName = isDirectory;
+    }
+};
+
+/*
+   Matches the names listed in the candidate directories against the component. Names are sorted so that
+   the result does not depend on the order of the directory entries.
+ */
+static void
+matchNestedComponent(const NestedComponent& component,
+                     const vector<NestedCandidate>& candidates,
+                     const vector<FileTable>& listings,
+                     vector<NestedCandidate>* matches)
+{
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const FileTable& listing = listings[i];
+        StringList names;
+        for (size_t j = 0; j < listing.size(); ++j) {
+            int frameNumber, viewNumber;
+            const char* name = listing.getName(j);
+            const size_t nameSize = listing.getNameSize(j);
+            if ( !passesPatternPrefilter(component.filter, name, nameSize) ||
+                 !matchesPattern_v2(name, nameSize, component.unPathed, component.extension, &frameNumber, &viewNumber,
+                                    !component.filter.wholeName) ) {
+                continue;
+            }
+            if ( component.filter.hasFrameVariable && candidates[i].hasFrameNumber && (frameNumber != candidates[i].frameNumber) ) {
+                continue;
+            }
+            if ( component.filter.hasViewVariable && candidates[i].hasViewNumber && (viewNumber != candidates[i].viewNumber) ) {
+                continue;
+            }
+            names.push_back( string(name, nameSize) );
+        }
+        std::sort( names.begin(), names.end() );
+        for (size_t j = 0; j < names.size(); ++j) {
+            NestedCandidate match = candidates[i];
+            int frameNumber, viewNumber;
+            matchesPattern_v2(names[j], component.unPathed, component.extension, &frameNumber, &viewNumber, !component.filter.wholeName);
+            if (component.filter.hasFrameVariable) {
+                match.frameNumber = frameNumber;
+                match.hasFrameNumber = true;
+            }
+            if (component.filter.hasViewVariable) {
+                match.viewNumber = viewNumber;
+                match.hasViewNumber = true;
+            }
+            match.path += names[j];
+            matches->push_back(match);
+        }
+    }
+}
+} // namespace {
+
+bool
+filesListFromPattern_nested(const string& pattern,
+                            SequenceParsing::SequenceFromPattern* sequence)
+{
+    if ( pattern.empty() ) {
+        return false;
+    }
+    string patternUnPathed = pattern;
+    const string patternPath = removePath(patternUnPathed);
+
+    ///Split the path in components, each one with its trailing separator
+    StringList components;
+    size_t componentStart = 0;
+    for (size_t i = 0; i < patternPath.size(); ++i) {
+        if ( (patternPath[i] == '/') || (patternPath[i] == '\\') ) {
+            components.push_back( patternPath.substr(componentStart, i + 1 - componentStart) );
+            componentStart = i + 1;
+        }
+    }
+
+    ///The directories before the first variable are used as is
+    NestedCandidate root;
+    root.frameNumber = -1;
+    root.viewNumber = 0;
+    root.hasFrameNumber = false;
+    root.hasViewNumber = false;
+    size_t firstVariableComponent = 0;
+    for (; firstVariableComponent < components.size(); ++firstVariableComponent) {
+        const string& component = components[firstVariableComponent];
+        if ( NestedComponent(component.substr(0, component.size() - 1), true).filter.hasVariables ) {
+            break;
+        }
+        root.path += component;
+    }
+    if ( firstVariableComponent == components.size() ) {
+        return filesListFromPattern_slow(pattern, sequence);
+    }
+    {
+        tinydir_dir dir;
+        if ( !openDirectory(&dir, root.path) ) {
+            return false;
+        }
+        tinydir_close(&dir);
+    }
+
+    vector<NestedCandidate> candidates(1, root);
+    for (size_t c = firstVariableComponent; c < components.size() && !candidates.empty(); ++c) {
+        const string& component = components[c];
+        const string separator = component.substr(component.size() - 1);
+        const NestedComponent nestedComponent(component.substr(0, component.size() - 1), true);
+        if (!nestedComponent.filter.hasVariables) {
+            ///existence is checked when listing the next level
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                candidates[i].path += component;
+            }
+            continue;
+        }
+
+        StringList paths;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            paths.push_back(candidates[i].path);
+        }
+        vector<FileTable> listings;
+        listDirectories(paths, true, DirectoryListingFilter(), &listings);
+
+        vector<NestedCandidate> matches;
+        matchNestedComponent(nestedComponent, candidates, listings, &matches);
+        for (size_t i = 0; i < matches.size(); ++i) {
+            matches[i].path += separator;
+        }
+        candidates.swap(matches);
+    }
+
+    ///Finally match the files of the candidate directories
+    StringList paths;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        paths.push_back(candidates[i].path);
+    }
+    DirectoryListingFilter filter;
+    getDirectoryListingFilterFromPattern(patternUnPathed, &filter);
+    vector<FileTable> listings;
+    listDirectories(paths, false, filter, &listings);
+
+    vector<NestedCandidate> files;
+    const NestedComponent fileComponent(patternUnPathed, false);
+    matchNestedComponent(fileComponent, candidates, listings, &files);
+    for (size_t i = 0; i < files.size(); ++i) {
+        insertFileInSequence(files[i].frameNumber, files[i].viewNumber, files[i].path, sequence);
+    }
+
+    return true;
+} // filesListFromPattern_nested
+
+IOStatistics::IOStatistics()
+    : directoriesOpened(0)
+    , directoryEntriesRead(0)
+    , filesStatted(0)
+    , filesOpened(0)
+    , filesRenamed(0)
+    , filesRemoved(0)
+    , fileTimesSet(0)
+    , readCalls(0)
+    , writeCalls(0)
+    , copyCalls(0)
+{
+}
+
+void
+getIOStatistics(IOStatistics* statistics)
+{
+    statistics->directoriesOpened = gDirectoriesOpened;
+    statistics->directoryEntriesRead = gDirectoryEntriesRead;
+    statistics->filesStatted = gFilesStatted;
+    statistics->filesOpened = gFilesOpened;
+    statistics->filesRenamed = gFilesRenamed;
+    statistics->filesRemoved = gFilesRemoved;
+    statistics->fileTimesSet = gFileTimesSet;
+    statistics->readCalls = gReadCalls;
+    statistics->writeCalls = gWriteCalls;
+    statistics->copyCalls = gCopyCalls;
+}
+
+void
+resetIOStatistics()
+{
+    gDirectoriesOpened = 0;
+    gDirectoryEntriesRead = 0;
+    gFilesStatted = 0;
+    gFilesOpened = 0;
+    gFilesRenamed = 0;
+    gFilesRemoved = 0;
+    gFileTimesSet = 0;
+    gReadCalls = 0;
+    gWriteCalls = 0;
+    gCopyCalls = 0;
+}
+
+void
+SequenceFilesMetadata::clear()
+{
+    frames.clear();
+    views.clear();
+    sizes.clear();
+    modificationTimes.clear();
+    inodes.clear();
+}
+
+size_t
+SequenceFilesMetadata::size() const
+{
+    return frames.size();
+}
+
+unsigned long long
+SequenceFilesMetadata::getMedianSize() const
+{
+    if ( sizes.empty() ) {
+        return 0;
+    }
+    vector<unsigned long long> sorted = sizes;
+    vector<unsigned long long>::iterator median = sorted.begin() + sorted.size() / 2;
+    std::nth_element(sorted.begin(), median, sorted.end());
+
+    return *median;
+}
+
+void
+SequenceFilesMetadata::getFilesSmallerThanMedian(double ratio,
+                                                 vector<size_t>* indexes) const
+{
+    const double threshold = ratio * (double)getMedianSize();
+
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if ( (double)sizes[i] < threshold ) {
+            indexes->push_back(i);
+        }
+    }
+}
+
+#if __cplusplus >= 201103L
+struct AsyncScanPrivate
+{
+    std::mutex lock; //< protects status and sequence
+    std::condition_variable doneCond;
+    AsyncScanHandle::Status status;
+    SequenceFromPattern sequence; //< not modified anymore once status is not eStatusRunning
+    AsyncScanCallback callback;
+    std::atomic<bool> cancelRequested;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+
+    AsyncScanPrivate()
+        : lock()
+        , doneCond()
+        , status(AsyncScanHandle::eStatusRunning)
+        , sequence()
+        , callback()
+        , cancelRequested(false)
+        , hasDeadline(false)
+        , deadline()
+    {
+    }
+
+    bool isDeadlineExpired() const
+    {
+        return hasDeadline && std::chrono::steady_clock::now() >= deadline;
+    }
+
+    ///Ends the scan with the given status, unless it was already ended.
+    void finish(AsyncScanHandle::Status finalStatus)
+    {
+        {
+            std::lock_guard<std::mutex> locker(lock);
+            if (status != AsyncScanHandle::eStatusRunning) {
+                return;
+            }
+            status = finalStatus;
+        }
+        doneCond.notify_all();
+        if (callback) {
+            callback(finalStatus, sequence);
+        }
+    }
+};
+
+AsyncScanHandle::AsyncScanHandle()
+    : _imp()
+{
+}
+
+AsyncScanHandle::AsyncScanHandle(const std::shared_ptr<AsyncScanPrivate>& imp)
+    : _imp(imp)
+{
+}
+
+void
+AsyncScanHandle::cancel()
+{
+    if (!_imp) {
+        return;
+    }
+    _imp->cancelRequested = true;
+    _imp->finish(eStatusCancelled);
+}
+
+AsyncScanHandle::Status
+AsyncScanHandle::getStatus() const
+{
+    if (!_imp) {
+        return eStatusFailed;
+    }
+    ///The deadline timer may not have run yet if it is busy with another callback
+    if ( _imp->isDeadlineExpired() ) {
+        _imp->finish(eStatusTimedOut);
+    }
+    std::lock_guard<std::mutex> locker(_imp->lock);
+
+    return _imp->status;
+}
+
+AsyncScanHandle::Status
+AsyncScanHandle::wait() const
+{
+    if (!_imp) {
+        return eStatusFailed;
+    }
+    {
+        std::unique_lock<std::mutex> locker(_imp->lock);
+        AsyncScanPrivate* imp = _imp.get();
+        if (imp->hasDeadline) {
+            imp->doneCond.wait_until(locker, imp->deadline, [imp] { return imp->status != eStatusRunning; });
+        } else {
+            imp->doneCond.wait(locker, [imp] { return imp->status != eStatusRunning; });
+        }
+    }
+    if ( _imp->isDeadlineExpired() ) {
+        _imp->finish(eStatusTimedOut);
+    }
+
+    return getStatus();
+}
+
+bool
+AsyncScanHandle::waitFor(int milliseconds) const
+{
+    if (!_imp) {
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> locker(_imp->lock);
+        AsyncScanPrivate* imp = _imp.get();
+        std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+        if ( imp->hasDeadline && (imp->deadline < until) ) {
+            until = imp->deadline;
+        }
+        imp->doneCond.wait_until(locker, until, [imp] { return imp->status != eStatusRunning; });
+    }
+    if ( _imp->isDeadlineExpired() ) {
+        _imp->finish(eStatusTimedOut);
+    }
+
+    return getStatus() != eStatusRunning;
+}
+
+SequenceFromPattern
+AsyncScanHandle::getResult() const
+{
+    if (!_imp) {
+        return SequenceFromPattern();
+    }
+    std::lock_guard<std::mutex> locker(_imp->lock);
+
+    return _imp->sequence;
+}
+
+AsyncScanHandle
+filesListFromPattern_async(const string& pattern,
+                           int timeoutMilliseconds,
+                           const AsyncScanCallback& callback)
+{
+    std::shared_ptr<AsyncScanPrivate> imp = std::make_shared<AsyncScanPrivate>();
+
+    imp->callback = callback;
+    if (timeoutMilliseconds > 0) {
+        imp->hasDeadline = true;
+        imp->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+    }
+    if ( pattern.empty() ) {
+        imp->finish(AsyncScanHandle::eStatusFailed);
+
+        return AsyncScanHandle(imp);
+    }
+    if (imp->hasDeadline) {
+        ///End the scan at its deadline even if its thread is stuck in the file-system and nobody waits for it
+        std::weak_ptr<AsyncScanPrivate> weakImp = imp;
+        getDeadlineTimer().post(imp->deadline, [weakImp] {
+            std::shared_ptr<AsyncScanPrivate> imp = weakImp.lock();
+            if (imp) {
+                imp->finish(AsyncScanHandle::eStatusTimedOut);
+            }
+        });
+    }
+
+    getScanThreadPool().post([imp, pattern] {
+        string patternUnPathed = pattern;
+        string patternPath = removePath(patternUnPathed);
+        string patternExtension = removeFileExtension(patternUnPathed);
+
+        ///Names that cannot match are rejected before the entries of unknown type are stat'ed
+        DirectoryListingFilter filter;
+        getDirectoryListingFilterFromPattern(pattern, &filter);
+
+        tinydir_dir patternDir;
+        if (imp->cancelRequested || imp->isDeadlineExpired() ||
+            !openDirectory(&patternDir, patternPath) ) {
+            imp->finish(imp->cancelRequested ? AsyncScanHandle::eStatusCancelled :
+                        imp->isDeadlineExpired() ? AsyncScanHandle::eStatusTimedOut : AsyncScanHandle::eStatusFailed);
+
+            return;
+        }
+
+        ///Files are matched as soon as they are read so that the result is always up to date
+        AsyncScanHandle::Status status = AsyncScanHandle::eStatusFinished;
+        while (patternDir.has_next) {
+            if (imp->cancelRequested) {
+                status = AsyncScanHandle::eStatusCancelled;
+                break;
+            }
+            if ( imp->isDeadlineExpired() ) {
+                status = AsyncScanHandle::eStatusTimedOut;
+                break;
+            }
+            tinydir_file file;
+            const char* name;
+            size_t size;
+            if ( readDirectoryFileName(patternDir, filter, &file, &name, &size) ) {
+                const string filename(name, size);
+                std::lock_guard<std::mutex> locker(imp->lock);
+                if (imp->status != AsyncScanHandle::eStatusRunning) {
+                    break;
+                }
+                insertFileIfMatching(filename, patternUnPathed, patternExtension, patternPath, &imp->sequence);
+            }
+            nextDirectoryEntry(&patternDir);
+        }
+        tinydir_close(&patternDir);
+        imp->finish(status);
+    });
+
+    return AsyncScanHandle(imp);
+} // filesListFromPattern_async
+
+#endif // __cplusplus >= 201103L
+
+StringList
+sequenceFromPatternToFilesList(const SequenceParsing::SequenceFromPattern& sequence,
+                               int onlyViewIndex)
+{
+    SequenceFilesRange range(sequence, onlyViewIndex);
+
+    return StringList( range.begin(), range.end() );
+}
+
+SequenceFilesRange::const_iterator::const_iterator()
+    : _frameIt()
+    , _framesEnd()
+    , _viewIt()
+    , _onlyViewIndex(-1)
+{
+}
+
+SequenceFilesRange::const_iterator::const_iterator(SequenceFromPattern::const_iterator frameIt,
+                                                   SequenceFromPattern::const_iterator framesEnd,
+                                                   int onlyViewIndex)
+    : _frameIt(frameIt)
+    , _framesEnd(framesEnd)
+    , _viewIt()
+    , _onlyViewIndex(onlyViewIndex)
+{
+    if (_frameIt != _framesEnd) {
+        _viewIt = _frameIt->second.begin();
+        skipFilteredViews();
+    }
+}
+
+void
+SequenceFilesRange::const_iterator::skipFilteredViews()
+{
+    while (_frameIt != _framesEnd) {
+        for (; _viewIt != _frameIt->second.end(); ++_viewIt) {
+            if ( (_onlyViewIndex == -1) || (_viewIt->first == _onlyViewIndex) || (_viewIt->first == -1) ) {
+                return;
+            }
+        }
+        ++_frameIt;
+        if (_frameIt != _framesEnd) {
+            _viewIt = _frameIt->second.begin();
+        }
+    }
+}
+
+SequenceFilesRange::const_iterator::reference
+SequenceFilesRange::const_iterator::operator*() const
+{
+    assert(_frameIt != _framesEnd);
+
+    return _viewIt->second;
+}
+
+SequenceFilesRange::const_iterator::pointer
+SequenceFilesRange::const_iterator::operator->() const
+{
+    assert(_frameIt != _framesEnd);
+
+    return &_viewIt->second;
+}
+
+SequenceFilesRange::const_iterator&
+SequenceFilesRange::const_iterator::operator++()
+{
+    assert(_frameIt != _framesEnd);
+    ++_viewIt;
+    skipFilteredViews();
+
+    return *this;
+}
+
+SequenceFilesRange::const_iterator
+SequenceFilesRange::const_iterator::operator++(int)
+{
+    const_iterator ret = *this;
+
+    ++(*this);
+
+    return ret;
+}
+
+bool
+SequenceFilesRange::const_iterator::operator==(const const_iterator& other) const
+{
+    ///the view iterator is only valid when not at the end
+    return _frameIt == other._frameIt && ( (_frameIt == _framesEnd) || (_viewIt == other._viewIt) );
+}
+
+bool
+SequenceFilesRange::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+int
+SequenceFilesRange::const_iterator::getFrame() const
+{
+    assert(_frameIt != _framesEnd);
+
+    return _frameIt->first;
+}
+
+int
+SequenceFilesRange::const_iterator::getView() const
+{
+    assert(_frameIt != _framesEnd);
+
+    return _viewIt->first;
+}
+
+SequenceFilesRange::SequenceFilesRange(const SequenceFromPattern& sequence,
+                                       int onlyViewIndex)
+    : _framesBegin( sequence.begin() )
+    , _framesEnd( sequence.end() )
+    , _onlyViewIndex(onlyViewIndex)
+{
+}
+
+SequenceFilesRange::SequenceFilesRange(const SequenceFromPattern& sequence,
+                                       int onlyViewIndex,
+                                       int firstFrame,
+                                       int lastFrame)
+    : _framesBegin( sequence.lower_bound(firstFrame) )
+    , _framesEnd( sequence.upper_bound(lastFrame) )
+    , _onlyViewIndex(onlyViewIndex)
+{
+    if (firstFrame > lastFrame) {
+        _framesEnd = _framesBegin;
+    }
+}
+
+SequenceFilesRange::const_iterator
+SequenceFilesRange::begin() const
+{
+    return const_iterator(_framesBegin, _framesEnd, _onlyViewIndex);
+}
+
+SequenceFilesRange::const_iterator
+SequenceFilesRange::end() const
+{
+    return const_iterator(_framesEnd, _framesEnd, _onlyViewIndex);
+}
+
+bool
+SequenceFilesRange::empty() const
+{
+    return begin() == end();
+}
+
+void
+makeSequenceSnapshot(const SequenceFromPattern& sequence,
+                     bool collectFileInfos,
+                     SequenceSnapshot* snapshot)
+{
+    snapshot->viewsFrames.clear();
+    snapshot->viewsFileInfos.clear();
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            appendFrameToRanges(it->first, &snapshot->viewsFrames[it2->first]);
+            FileInfo info;
+            if ( collectFileInfos && getFileInfo(it2->second, &info) ) {
+                snapshot->viewsFileInfos[it2->first].insert( snapshot->viewsFileInfos[it2->first].end(), make_pair(it->first, info) );
+            }
+        }
+    }
+}
+
+void
+makeSequenceSnapshot(const SequenceFromPattern& sequence,
+                     const SequenceFilesMetadata& metadata,
+                     SequenceSnapshot* snapshot)
+{
+    makeSequenceSnapshot(sequence, false, snapshot);
+    for (size_t i = 0; i < metadata.size(); ++i) {
+        FileInfo info;
+        info.size = metadata.sizes[i];
+        info.modificationTime = metadata.modificationTimes[i];
+        snapshot->viewsFileInfos[metadata.views[i]][metadata.frames[i]] = info;
+    }
+}
+
+void
+diffSequenceSnapshots(const SequenceSnapshot& oldSnapshot,
+                      const SequenceSnapshot& newSnapshot,
+                      map<int, SequenceSnapshotViewDiff>* diff)
+{
+    diff->clear();
+    const FrameRanges noFrames;
+
+    ///all the views of both snapshots
+    map<int, pair<const FrameRanges*, const FrameRanges*> > views;
+    for (map<int, FrameRanges>::const_iterator it = oldSnapshot.viewsFrames.begin(); it != oldSnapshot.viewsFrames.end(); ++it) {
+        views[it->first] = make_pair(&it->second, &noFrames);
+    }
+    for (map<int, FrameRanges>::const_iterator it = newSnapshot.viewsFrames.begin(); it != newSnapshot.viewsFrames.end(); ++it) {
+        pair<map<int, pair<const FrameRanges*, const FrameRanges*> >::iterator, bool> ret =
+            views.insert( make_pair( it->first, make_pair(&noFrames, &it->second) ) );
+        ret.first->second.second = &it->second;
+    }
+
+    for (map<int, pair<const FrameRanges*, const FrameRanges*> >::const_iterator it = views.begin(); it != views.end(); ++it) {
+        SequenceSnapshotViewDiff viewDiff;
+        subtractFrameRanges(*it->second.second, *it->second.first, &viewDiff.added);
+        subtractFrameRanges(*it->second.first, *it->second.second, &viewDiff.removed);
+
+        map<int, map<int, FileInfo> >::const_iterator oldInfos = oldSnapshot.viewsFileInfos.find(it->first);
+        map<int, map<int, FileInfo> >::const_iterator newInfos = newSnapshot.viewsFileInfos.find(it->first);
+        if ( ( oldInfos != oldSnapshot.viewsFileInfos.end() ) && ( newInfos != newSnapshot.viewsFileInfos.end() ) ) {
+            ///Both maps are sorted by frame, walk them together
+            map<int, FileInfo>::const_iterator oldIt = oldInfos->second.begin();
+            map<int, FileInfo>::const_iterator newIt = newInfos->second.begin();
+            while ( oldIt != oldInfos->second.end() && newIt != newInfos->second.end() ) {
+                if (oldIt->first < newIt->first) {
+                    ++oldIt;
+                } else if (newIt->first < oldIt->first) {
+                    ++newIt;
+                } else {
+                    if (oldIt->second != newIt->second) {
+                        appendFrameToRanges(oldIt->first, &viewDiff.changed);
+                    }
+                    ++oldIt;
+                    ++newIt;
+                }
+            }
+        }
+
+        if ( !viewDiff.added.empty() || !viewDiff.removed.empty() || !viewDiff.changed.empty() ) {
+            (*diff)[it->first] = viewDiff;
+        }
+    }
+} // diffSequenceSnapshots
+
+unsigned long long
+computeSequenceFingerprint(const string& pattern,
+                           const SequenceSnapshot& snapshot)
+{
+    unsigned long long ret = hashString(kFingerprintSeed, pattern);
+
+    for (map<int, FrameRanges>::const_iterator it = snapshot.viewsFrames.begin(); it != snapshot.viewsFrames.end(); ++it) {
+        ret = hashFrameRanges( ret, it->first, it->second.size(), it->second.begin(), it->second.end() );
+    }
+    if ( !snapshot.viewsFileInfos.empty() ) {
+        unsigned long long fileInfosHash = 0;
+        for (map<int, map<int, FileInfo> >::const_iterator it = snapshot.viewsFileInfos.begin(); it != snapshot.viewsFileInfos.end(); ++it) {
+            for (map<int, FileInfo>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                fileInfosHash += hashFileInfo(it->first, it2->first, it2->second);
+            }
+        }
+        ret = combineHash(ret, (long long)fileInfosHash);
+    }
+
+    return ret;
+}
+
+unsigned long long
+computeSequenceFingerprint(const string& pattern,
+                           const SequenceFromPattern& sequence)
+{
+    SequenceSnapshot snapshot;
+
+    makeSequenceSnapshot(sequence, false, &snapshot);
+
+    return computeSequenceFingerprint(pattern, snapshot);
+}
+
+namespace {
+/*
+   Implemented on the characters of the pattern, like the listing functions, so that the overloads taking a view or
+   a null-terminated string do not copy it.
+ */
+static string
+generateFileNameFromPatternInternal(const char* pattern,
+                                    size_t patternSize,
+                                    const vector<string>& viewNames,
+                                    int frameNumber,
+                                    int viewNumber)
+{
+    ///this list represents the common parts of the filename to find in a file in order for it to match the pattern.
+    StringList commonPartsToFind;
+    ///this list represents the variables ( ###  %04d %v etc...) found in the pattern ordered from left to right in the
+    ///original string.
+    vector<pair<string, int> > variablesByOrder;
+    ///the extension only adds a common part, which is not needed to generate the name
+    extractCommonPartsAndVariablesFromPattern(pattern, patternSize, string(), &commonPartsToFind, &variablesByOrder);
+
+    ///The output is built from left to right: the text up to each variable, then its value
+    string output;
+    output.reserve(patternSize);
+    size_t pos = 0; //< the end of the last variable in the pattern
+    for (size_t i = 0; i < variablesByOrder.size(); ++i) {
+        const string& variable = variablesByOrder[i].first;
+        const size_t variablePos = findStr(pattern, patternSize, variable, pos);
+
+        ///if we can't find the variable that means extractCommonPartsAndVariablesFromPattern is bugged.
+        assert(variablePos != string::npos);
+        output.append(pattern + pos, variablePos - pos);
+        pos = variablePos + variable.size();
+
+        if (variable.find_first_of('#') != string::npos) {
+            const string frameNoStr = stringFromInt(frameNumber);
+            ///prepend with extra 0's
+            if ( frameNoStr.size() < variable.size() ) {
+                output.append(variable.size() - frameNoStr.size(), '0');
+            }
+            output.append(frameNoStr);
+        } else if (variable.find("%v") != string::npos) {
+            if ( ( viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
+                output.push_back( std::toupper(viewNames[viewNumber][0]) );
+            }
+        } else if (variable.find("%V") != string::npos) {
+            if ( ( viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
+                output.append(viewNames[viewNumber]);
+            } else {
+                output.append(variable);
+            }
+        } else if ( startsWith(variable, "%0") && endsWith(variable, "d") ) {
+            const int digitsCount = stringToInt( variable.substr(2, variable.size() - 3) );
+            const string frameNoStr = stringFromInt(frameNumber);
+            //prepend with extra 0's
+            if ( (int)frameNoStr.size() < digitsCount ) {
+                output.append(digitsCount - frameNoStr.size(), '0');
+            }
+            output.append(frameNoStr);
+        } else if (variable == "%d") {
+            output.append( stringFromInt(frameNumber) );
+        } else {
+            throw std::invalid_argument( "Unrecognized pattern: " + string(pattern, patternSize) );
+        }
+    }
+    output.append(pattern + pos, patternSize - pos);
+
+    return output;
+} // generateFileNameFromPatternInternal
+} // namespace {
+
+string
+generateFileNameFromPattern(const string& pattern,
+                            const vector<string>& viewNames,
+                            int frameNumber,
+                            int viewNumber)
+{
+    return generateFileNameFromPatternInternal(pattern.data(), pattern.size(), viewNames, frameNumber, viewNumber);
+}
+
+#if __cplusplus >= 201703L
+string
+generateFileNameFromPattern(std::string_view pattern,
+                            const vector<string>& viewNames,
+                            int frameNumber,
+                            int viewNumber)
+{
+    return generateFileNameFromPatternInternal(pattern.data(), pattern.size(), viewNames, frameNumber, viewNumber);
+}
+
+string
+generateFileNameFromPattern(const char* pattern,
+                            const vector<string>& viewNames,
+                            int frameNumber,
+                            int viewNumber)
+{
+    return generateFileNameFromPatternInternal(pattern, std::strlen(pattern), viewNames, frameNumber, viewNumber);
+}
+#endif
+
+namespace {
+
+#if __cplusplus >= 201103L
+typedef std::unordered_map<string, size_t> RenameIndex;
+#else
+typedef map<string, size_t> RenameIndex;
+#endif
+
+/*
+   The files of the directories listed so far, to check that the names given to the files are free.
+ */
+struct DirectoryListings
+{
+    map<string, bool> directories; //< directory -> whether it could be listed
+    RenameIndex files;
+};
+
+/*
+   Sets exists to whether the file is in its directory, listing the directory if it was not yet.
+   Returns false if the directory cannot be listed.
+ */
+static bool
+isFileInListings(const string& filename,
+                 DirectoryListings* listings,
+                 bool* exists)
+{
+    string name = filename;
+    const string path = removePath(name);
+    map<string, bool>::iterator found = listings->directories.find(path);
+
+    if ( found == listings->directories.end() ) {
+        FileTable table;
+        const bool listed = table.appendDirectory( path.empty() ? string(".") : path );
+        for (size_t i = 0; i < table.size(); ++i) {
+            listings->files.insert( make_pair(path + table.getNameString(i), 0) );
+        }
+        found = listings->directories.insert( make_pair(path, listed) ).first;
+    }
+    if (!found->second) {
+        return false;
+    }
+    *exists = listings->files.find(filename) != listings->files.end();
+
+    return true;
+}
+
+/*
+   Appends to chains the renames waiting for each other starting from the rename first (whose target is free)
+   up to the rename stop, excluded. Every SEQUENCEPARSING_MAX_RENAME_CHAIN_LENGTH renames, a file is moved to a
+   temporary name instead so that the rest of the chain can start without waiting.
+ */
+static void
+appendRenameChains(size_t first,
+                   size_t stop,
+                   const vector<size_t>& waitingRenames,
+                   vector<bool>* planned,
+                   vector<size_t>* temporaries,
+                   vector<vector<size_t> >* chains)
+{
+    chains->push_back( vector<size_t>() );
+    size_t length = 0;
+    for (size_t i = first; i != stop; i = waitingRenames[i]) {
+        (*planned)[i] = true;
+        if ( (length == SEQUENCEPARSING_MAX_RENAME_CHAIN_LENGTH) && (waitingRenames[i] != stop) ) {
+            temporaries->push_back(i);
+            chains->push_back( vector<size_t>() );
+            length = 0;
+        } else {
+            chains->back().push_back(i);
+            ++length;
+        }
+    }
+}
+
+static bool
+planSequenceRenameInternal(const SequenceFromPattern& sequence,
+                           const string& newPattern,
+                           const vector<string>& viewNames,
+                           const map<int, int>* frameMapping,
+                           int frameOffset,
+                           SequenceRenamePlan* plan)
+{
+    plan->clear();
+
+    ///the renames to do, and all the files of the sequence mapped to the index of their rename (npos if they keep their name)
+    vector<FileRename> renames;
+    RenameIndex files;
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        int newFrame = it->first + frameOffset;
+        if (frameMapping) {
+            map<int, int>::const_iterator found = frameMapping->find(it->first);
+            newFrame = found != frameMapping->end() ? found->second : it->first;
+        }
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            FileRename rename;
+            rename.from = it2->second;
+            rename.to = generateFileNameFromPattern(newPattern, viewNames, newFrame, it2->first);
+            const size_t index = rename.to == rename.from ? string::npos : renames.size();
+            if ( !files.insert( make_pair(rename.from, index) ).second ) {
+                return false;
+            }
+            if (index != string::npos) {
+                renames.push_back(rename);
+            }
+        }
+    }
+
+    ///For each rename, the rename whose target is its source and which has to wait for it
+    vector<size_t> waitingRenames(renames.size(), string::npos);
+    vector<bool> blocked(renames.size(), false); //< whether the target is the source of another rename
+    RenameIndex targets;
+    DirectoryListings listings;
+    for (size_t i = 0; i < renames.size(); ++i) {
+        if ( !targets.insert( make_pair(renames[i].to, i) ).second ) {
+            return false;
+        }
+        RenameIndex::const_iterator found = files.find(renames[i].to);
+        if ( found != files.end() ) {
+            if (found->second == string::npos) {
+                ///taken by a file which keeps its name
+                return false;
+            }
+            waitingRenames[found->second] = i;
+            blocked[i] = true;
+        } else {
+            bool exists;
+            if ( !isFileInListings(renames[i].to, &listings, &exists) || exists ) {
+                return false;
+            }
+        }
+    }
+
+    ///Renames to a free name start the chains, what is left forms cycles
+    vector<bool> planned(renames.size(), false);
+    vector<size_t> temporaries;
+    vector<vector<size_t> > chains;
+    for (size_t i = 0; i < renames.size(); ++i) {
+        if (!blocked[i]) {
+            appendRenameChains(i, string::npos, waitingRenames, &planned, &temporaries, &chains);
+        }
+    }
+    for (size_t i = 0; i < renames.size(); ++i) {
+        if (!planned[i]) {
+            planned[i] = true;
+            temporaries.push_back(i);
+            appendRenameChains(waitingRenames[i], i, waitingRenames, &planned, &temporaries, &chains);
+        }
+    }
+
+    for (size_t i = 0; i < temporaries.size(); ++i) {
+        const FileRename& rename = renames[temporaries[i]];
+        string temporary = rename.from + ".renaming";
+        for (int attempt = 1;; ++attempt) {
+            bool exists;
+            if ( !isFileInListings(temporary, &listings, &exists) ) {
+                return false;
+            }
+            if ( !exists && ( files.find(temporary) == files.end() ) && ( targets.find(temporary) == targets.end() ) ) {
+                break;
+            }
+            temporary = rename.from + ".renaming" + stringFromInt(attempt);
+        }
+        listings.files.insert( make_pair(temporary, 0) );
+
+        FileRename toTemporary;
+        toTemporary.from = rename.from;
+        toTemporary.to = temporary;
+        plan->toTemporary.push_back(toTemporary);
+        FileRename fromTemporary;
+        fromTemporary.from = temporary;
+        fromTemporary.to = rename.to;
+        plan->fromTemporary.push_back(fromTemporary);
+    }
+    plan->chains.reserve( chains.size() );
+    for (size_t i = 0; i < chains.size(); ++i) {
+        plan->chains.push_back( vector<FileRename>() );
+        vector<FileRename>& chain = plan->chains.back();
+        chain.reserve( chains[i].size() );
+        for (size_t j = 0; j < chains[i].size(); ++j) {
+            chain.push_back(renames[chains[i][j]]);
+        }
+    }
+
+    return true;
+} // planSequenceRenameInternal
+
+/*
+   Renames files, relative to the directories it opened on POSIX systems, and collects the failures.
+ */
+class RenameExecutor
+{
+public:
+
+    RenameExecutor(const SequenceRenamePlan& plan,
+                   vector<FileRename>* failedRenames)
+        : _failed(false)
+        , _failedRenames(failedRenames)
+    {
+#ifndef _WIN32
+        openDirectories(plan.toTemporary);
+        for (size_t i = 0; i < plan.chains.size(); ++i) {
+            openDirectories(plan.chains[i]);
+        }
+        openDirectories(plan.fromTemporary);
+#else
+        (void)plan;
+#endif
+    }
+
+    ~RenameExecutor()
+    {
+#ifndef _WIN32
+        for (map<string, int>::iterator it = _directories.begin(); it != _directories.end(); ++it) {
+            if (it->second != -1) {
+                ::close(it->second);
+            }
+        }
+#endif
+    }
+
+    bool rename(const FileRename& rename) const
+    {
+        ++gFilesRenamed;
+#ifdef _WIN32
+
+        return MoveFileExW(utf8_to_utf16(rename.from).c_str(), utf8_to_utf16(rename.to).c_str(), 0) != 0;
+#else
+        string fromName = rename.from;
+        const string fromPath = removePath(fromName);
+        string toName = rename.to;
+        const string toPath = removePath(toName);
+
+        return renameat(getDirectory(fromPath), fromName.c_str(), getDirectory(toPath), toName.c_str()) == 0;
+#endif
+    }
+
+    ///Records the renames as failed
+    void fail(const FileRename* begin,
+              const FileRename* end)
+    {
+#if __cplusplus >= 201103L
+        std::lock_guard<std::mutex> lock(_failedRenamesMutex);
+#endif
+        _failed = true;
+        if (_failedRenames) {
+            _failedRenames->insert(_failedRenames->end(), begin, end);
+        }
+    }
+
+    void fail(const vector<FileRename>& renames)
+    {
+        if ( !renames.empty() ) {
+            fail( &renames[0], &renames[0] + renames.size() );
+        }
+    }
+
+    bool hasFailed() const
+    {
+        return _failed;
+    }
+
+private:
+
+#ifndef _WIN32
+    void openDirectories(const vector<FileRename>& renames)
+    {
+        for (size_t i = 0; i < renames.size(); ++i) {
+            openDirectory(renames[i].from);
+            openDirectory(renames[i].to);
+        }
+    }
+
+    void openDirectory(const string& filename)
+    {
+        const size_t pos = filename.find_last_of('/');
+        const string path = pos == string::npos ? string() : filename.substr(0, pos + 1);
+        if ( path.empty() || ( _directories.find(path) != _directories.end() ) ) {
+            return;
+        }
+        ++gDirectoriesOpened;
+#ifdef O_DIRECTORY
+        _directories[path] = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+#else
+        _directories[path] = ::open(path.c_str(), O_RDONLY);
+#endif
+    }
+
+    ///A directory that could not be opened is -1, which makes renameat fail
+    int getDirectory(const string& path) const
+    {
+        if ( path.empty() ) {
+            return AT_FDCWD;
+        }
+        map<string, int>::const_iterator found = _directories.find(path);
+
+        return found != _directories.end() ? found->second : -1;
+    }
+
+    map<string, int> _directories;
+#endif
+#if __cplusplus >= 201103L
+    std::atomic<bool> _failed;
+    std::mutex _failedRenamesMutex;
+#else
+    bool _failed;
+#endif
+    vector<FileRename>* _failedRenames;
+};
+
+struct RenameTask
+{
+    RenameExecutor* executor;
+    const vector<FileRename>* renames;
+
+    void operator()(size_t i) const
+    {
+        const FileRename& rename = (*renames)[i];
+
+        if ( !executor->rename(rename) ) {
+            executor->fail(&rename, &rename + 1);
+        }
+    }
+};
+
+struct RenameChainTask
+{
+    RenameExecutor* executor;
+    const vector<vector<FileRename> >* chains;
+
+    void operator()(size_t i) const
+    {
+        const vector<FileRename>& chain = (*chains)[i];
+
+        for (size_t j = 0; j < chain.size(); ++j) {
+            if ( !executor->rename(chain[j]) ) {
+                ///the next renames of the chain would overwrite the file that could not be moved
+                executor->fail( &chain[j], &chain[0] + chain.size() );
+
+                return;
+            }
+        }
+    }
+};
+
+/*
+   Calls task(i) for i in [0, tasksCount), on threadsCount threads including the calling one.
+ */
+template <typename Task>
+static void
+runConcurrently(size_t tasksCount,
+                int threadsCount,
+                const Task& task)
+{
+#if __cplusplus >= 201103L
+    if ( (threadsCount > 1) && (tasksCount > 1) ) {
+        std::atomic<size_t> nextTask(0);
+        auto run = [&] {
+            for (size_t i = nextTask++; i < tasksCount; i = nextTask++) {
+                task(i);
+            }
+        };
+        vector<std::thread> threads;
+        for (size_t i = 1; i < std::min( (size_t)threadsCount, tasksCount ); ++i) {
+            threads.push_back( std::thread(run) );
+        }
+        run();
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+
+        return;
+    }
+#else
+    (void)threadsCount;
+#endif
+    for (size_t i = 0; i < tasksCount; ++i) {
+        task(i);
+    }
+}
+} // namespace {
+
+void
+SequenceRenamePlan::clear()
+{
+    toTemporary.clear();
+    chains.clear();
+    fromTemporary.clear();
+}
+
+size_t
+SequenceRenamePlan::getRenamesCount() const
+{
+    size_t count = toTemporary.size() + fromTemporary.size();
+
+    for (size_t i = 0; i < chains.size(); ++i) {
+        count += chains[i].size();
+    }
+
+    return count;
+}
+
+void
+SequenceRenamePlan::getRenamesInOrder(vector<FileRename>* renames) const
+{
+    renames->reserve( renames->size() + getRenamesCount() );
+    renames->insert( renames->end(), toTemporary.begin(), toTemporary.end() );
+    for (size_t i = 0; i < chains.size(); ++i) {
+        renames->insert( renames->end(), chains[i].begin(), chains[i].end() );
+    }
+    renames->insert( renames->end(), fromTemporary.begin(), fromTemporary.end() );
+}
+
+string
+SequenceRenamePlan::toString() const
+{
+    vector<FileRename> renames;
+    getRenamesInOrder(&renames);
+    string ret;
+    for (size_t i = 0; i < renames.size(); ++i) {
+        ret.append(renames[i].from);
+        ret.append(" -> ");
+        ret.append(renames[i].to);
+        ret.push_back('\n');
+    }
+
+    return ret;
+}
+
+bool
+planSequenceRename(const SequenceFromPattern& sequence,
+                   const string& newPattern,
+                   const vector<string>& viewNames,
+                   int frameOffset,
+                   SequenceRenamePlan* plan)
+{
+    return planSequenceRenameInternal(sequence, newPattern, viewNames, 0, frameOffset, plan);
+}
+
+bool
+planSequenceRename(const SequenceFromPattern& sequence,
+                   const string& newPattern,
+                   const vector<string>& viewNames,
+                   const map<int, int>& frameMapping,
+                   SequenceRenamePlan* plan)
+{
+    return planSequenceRenameInternal(sequence, newPattern, viewNames, &frameMapping, 0, plan);
+}
+
+bool
+executeSequenceRename(const SequenceRenamePlan& plan,
+                      int threadsCount,
+                      vector<FileRename>* failedRenames)
+{
+    RenameExecutor executor(plan, failedRenames);
+
+    RenameTask toTemporary;
+    toTemporary.executor = &executor;
+    toTemporary.renames = &plan.toTemporary;
+    runConcurrently(plan.toTemporary.size(), threadsCount, toTemporary);
+    if ( executor.hasFailed() ) {
+        ///a file still in the way would be overwritten by a chain
+        for (size_t i = 0; i < plan.chains.size(); ++i) {
+            executor.fail(plan.chains[i]);
+        }
+        executor.fail(plan.fromTemporary);
+
+        return false;
+    }
+
+    RenameChainTask chains;
+    chains.executor = &executor;
+    chains.chains = &plan.chains;
+    runConcurrently(plan.chains.size(), threadsCount, chains);
+    if ( executor.hasFailed() ) {
+        executor.fail(plan.fromTemporary);
+
+        return false;
+    }
+
+    RenameTask fromTemporary;
+    fromTemporary.executor = &executor;
+    fromTemporary.renames = &plan.fromTemporary;
+    runConcurrently(plan.fromTemporary.size(), threadsCount, fromTemporary);
+
+    return !executor.hasFailed();
+} // executeSequenceRename
+
+#if __cplusplus >= 201103L
+namespace {
+
+/*
+   The bytes of the files being copied, blocking the copies that would exceed the maximum.
+ */
+class InFlightBytes
+{
+public:
+
+    explicit InFlightBytes(unsigned long long maxBytes)
+        : _maxBytes(maxBytes)
+        , _bytes(0)
+    {
+    }
+
+    ///Returns the bytes reserved, a file bigger than the maximum reserves all of it
+    unsigned long long acquire(unsigned long long bytes)
+    {
+        bytes = std::min(bytes, _maxBytes);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [&] { return _bytes + bytes <= _maxBytes; });
+        _bytes += bytes;
+
+        return bytes;
+    }
+
+    void release(unsigned long long bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bytes -= bytes;
+        }
+        _cond.notify_all();
+    }
+
+private:
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    const unsigned long long _maxBytes;
+    unsigned long long _bytes;
+};
+
+#ifndef _WIN32
+/*
+   Copies the rest of the file from to the file to, from their current offsets.
+ */
+static bool
+copyFileContent(int from,
+                int to,
+                unsigned long long size)
+{
+    unsigned long long copied = 0;
+
+#if defined(__linux__) && defined(__GLIBC__) && ( (__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27) )
+    ///copy_file_range fails (e.g: with EXDEV across file-systems before Linux 5.3, or ENOSYS) without moving the offsets
+    ///where it is not supported: the buffered copy below finishes the copy
+    while (copied < size) {
+        ++gCopyCalls;
+        const ssize_t count = copy_file_range( from, NULL, to, NULL, (size_t)std::min(size - copied, 1ULL << 30), 0 );
+        if (count <= 0) {
+            break;
+        }
+        copied += (unsigned long long)count;
+    }
+#endif
+
+    ///read up to the end of the file, which may have changed size since it was stat'ed
+    vector<char> buffer( (size_t)std::max( 4096ULL, std::min(size - std::min(copied, size), 1ULL << 20) ) );
+    for (;;) {
+        const ssize_t count = readFileData( from, &buffer[0], buffer.size() );
+        if (count == 0) {
+            return true;
+        } else if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+        for (ssize_t written = 0; written < count;) {
+            const ssize_t n = writeFileData(to, &buffer[written], count - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return false;
+            }
+            written += n;
+        }
+    }
+}
+#endif // _WIN32
+
+/*
+   Copies a file with its modification time, overwriting the destination.
+ */
+static bool
+copyFile(const string& from,
+         const string& to,
+         const FileInfo& fromInfo)
+{
+#ifdef _WIN32
+
+    ///CopyFileW copies the modification time
+    ++gCopyCalls;
+
+    return CopyFileW(utf8_to_utf16(from).c_str(), utf8_to_utf16(to).c_str(), FALSE) != 0;
+#else
+    ++gFilesOpened;
+    const int fromFd = ::open(from.c_str(), O_RDONLY);
+    if (fromFd == -1) {
+        return false;
+    }
+    ++gFilesOpened;
+    const int toFd = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool ok = toFd != -1 && copyFileContent(fromFd, toFd, fromInfo.size);
+    if (ok) {
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = (time_t)(fromInfo.modificationTime / 1000000000LL);
+        times[1].tv_nsec = (long)(fromInfo.modificationTime % 1000000000LL);
+        ++gFileTimesSet;
+        ok = futimens(toFd, times) == 0;
+    }
+    if (toFd != -1) {
+        ok = (::close(toFd) == 0) && ok;
+        if (!ok) {
+            ++gFilesRemoved;
+            ::unlink( to.c_str() );
+        }
+    }
+    ::close(fromFd);
+
+    return ok;
+#endif
+}
+
+static bool
+removeFile(const string& filename)
+{
+    ++gFilesRemoved;
+#ifdef _WIN32
+
+    return DeleteFileW( utf8_to_utf16(filename).c_str() ) != 0;
+#else
+
+    return ::unlink( filename.c_str() ) == 0;
+#endif
+}
+
+/*
+   Copies or moves a file of a sequence, bytesCopied is set to the bytes actually copied.
+ */
+static bool
+copySequenceFile(const FileRename& copy,
+                 const SequenceCopyOptions& options,
+                 InFlightBytes* inFlightBytes,
+                 unsigned long long* bytesCopied)
+{
+    FileInfo fromInfo;
+
+    if ( !getFileInfo(copy.from, &fromInfo) ) {
+        return false;
+    }
+    if (options.resume) {
+        FileInfo toInfo;
+        if ( getFileInfo(copy.to, &toInfo) && (toInfo.size == fromInfo.size) &&
+             ( toInfo.modificationTime / 1000000000LL == fromInfo.modificationTime / 1000000000LL ) ) {
+            ///copied by a previous call
+            return !options.move || removeFile(copy.from);
+        }
+    }
+    if (options.move) {
+        ++gFilesRenamed;
+#ifdef _WIN32
+        if ( MoveFileExW(utf8_to_utf16(copy.from).c_str(), utf8_to_utf16(copy.to).c_str(), MOVEFILE_REPLACE_EXISTING) ) {
+#else
+        if ( ::rename( copy.from.c_str(), copy.to.c_str() ) == 0 ) {
+#endif
+
+            return true;
+        }
+    }
+
+    const unsigned long long reserved = inFlightBytes->acquire(fromInfo.size);
+    const bool copied = copyFile(copy.from, copy.to, fromInfo);
+    inFlightBytes->release(reserved);
+    if (!copied) {
+        return false;
+    }
+    *bytesCopied = fromInfo.size;
+
+    return !options.move || removeFile(copy.from);
+}
+} // namespace {
+
+SequenceCopyOptions::SequenceCopyOptions()
+    : frameOffset(0)
+    , threadsCount(4)
+    , maxInFlightBytes(256ULL << 20)
+    , resume(true)
+    , move(false)
+    , progressCallback()
+{
+}
+
+bool
+copySequence(const SequenceFromPattern& sequence,
+             const string& destinationPattern,
+             const vector<string>& viewNames,
+             const SequenceCopyOptions& options,
+             vector<string>* failedFiles)
+{
+    vector<FileRename> copies;
+    RenameIndex files;
+
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            FileRename copy;
+            copy.from = it2->second;
+            copy.to = generateFileNameFromPattern(destinationPattern, viewNames, it->first + options.frameOffset, it2->first);
+            files.insert( make_pair(copy.from, 0) );
+            if (copy.to != copy.from) {
+                copies.push_back(copy);
+            }
+        }
+    }
+    RenameIndex targets;
+    for (size_t i = 0; i < copies.size(); ++i) {
+        if ( ( files.find(copies[i].to) != files.end() ) || !targets.insert( make_pair(copies[i].to, i) ).second ) {
+            return false;
+        }
+    }
+
+    InFlightBytes inFlightBytes( std::max(options.maxInFlightBytes, 1ULL) );
+    std::mutex mutex;
+    size_t filesDone = 0;
+    unsigned long long bytesCopied = 0;
+    bool ok = true;
+    runConcurrently(copies.size(), options.threadsCount, [&] (size_t i) {
+        unsigned long long bytes = 0;
+        const bool copied = copySequenceFile(copies[i], options, &inFlightBytes, &bytes);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++filesDone;
+        bytesCopied += bytes;
+        if (!copied) {
+            ok = false;
+            if (failedFiles) {
+                failedFiles->push_back(copies[i].from);
+            }
+        }
+        if (options.progressCallback) {
+            options.progressCallback(filesDone, copies.size(), bytesCopied);
+        }
+    });
+
+    return ok;
+} // copySequence
+#endif // __cplusplus >= 201103L
+
+namespace {
+
+/*
+   Orders the indexes of count files so that any prefix of the order is spread across all the files: the indexes are
+   taken in the order of their bit-reversed value (van der Corput sequence). Stops after maxCount indexes.
+ */
+static void
+makeSpreadOrder(size_t count,
+                size_t maxCount,
+                vector<size_t>* order)
+{
+    size_t bitsCount = 0;
+
+    while ( ( (size_t)1 << bitsCount ) < count ) {
+        ++bitsCount;
+    }
+    maxCount = std::min(maxCount, count);
+    order->reserve(maxCount);
+    for (size_t i = 0; order->size() < maxCount; ++i) {
+        size_t index = 0;
+        for (size_t b = 0; b < bitsCount; ++b) {
+            if ( i & ( (size_t)1 << b ) ) {
+                index |= (size_t)1 << (bitsCount - 1 - b);
+            }
+        }
+        if (index < count) {
+            order->push_back(index);
+        }
+    }
+}
+
+/*
+   The number of standard deviations of the two-sided confidence interval, from the rational approximation 26.2.23
+   of the normal quantile of Abramowitz and Stegun (error below 4.5e-4).
+ */
+static double
+getConfidenceZScore(double confidence)
+{
+    confidence = std::min(std::max(confidence, 0.), 0.999999);
+    const double t = std::sqrt( -2. * std::log( (1. - confidence) / 2. ) );
+
+    return std::max( 0., t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+                     (1. + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t) );
+}
+
+///The sizes of the files of a sequence read so far
+struct SizeSample
+{
+    size_t filesCount;
+    size_t sizedFilesCount; //< including the files that could not be sized
+    size_t readSizesCount;
+    unsigned long long readSizesSum;
+    double readSizesSquaresSum;
+
+    explicit SizeSample(size_t count)
+        : filesCount(count)
+        , sizedFilesCount(0)
+        , readSizesCount(0)
+        , readSizesSum(0)
+        , readSizesSquaresSum(0)
+    {
+    }
+
+    void addFile(bool sized,
+                 unsigned long long size)
+    {
+        ++sizedFilesCount;
+        if (sized) {
+            ++readSizesCount;
+            readSizesSum += size;
+            readSizesSquaresSum += (double)size * (double)size;
+        }
+    }
+};
+
+/*
+   Extrapolates the sizes read to all the files. The variance of the sizes is estimated from the sample, and reduced by
+   the finite population correction since the sample is taken without replacement.
+ */
+static void
+makeSizeEstimate(const SizeSample& sample,
+                 double zScore,
+                 SequenceSizeEstimate* estimate)
+{
+    estimate->filesCount = sample.filesCount;
+    estimate->sizedFilesCount = sample.sizedFilesCount;
+    estimate->exact = sample.sizedFilesCount == sample.filesCount;
+    estimate->estimatedSize = estimate->lowerBound = estimate->upperBound = sample.readSizesSum;
+    if ( estimate->exact || (sample.readSizesCount == 0) ) {
+        if (!estimate->exact) {
+            estimate->upperBound = ~0ULL;
+        }
+
+        return;
+    }
+
+    const double filesCount = (double)sample.filesCount;
+    const double readSizesCount = (double)sample.readSizesCount;
+    const double mean = (double)sample.readSizesSum / readSizesCount;
+    const double estimatedSize = mean * filesCount;
+    estimate->estimatedSize = std::max( sample.readSizesSum, (unsigned long long)(estimatedSize + 0.5) );
+    if (sample.readSizesCount < 2) {
+        estimate->upperBound = ~0ULL;
+
+        return;
+    }
+    const double variance = std::max(0., (sample.readSizesSquaresSum - (double)sample.readSizesSum * mean) / (readSizesCount - 1.) );
+    const double correction = 1. - (double)sample.sizedFilesCount / filesCount;
+    const double margin = zScore * filesCount * std::sqrt(variance / readSizesCount * correction);
+    estimate->lowerBound = std::max( sample.readSizesSum, (unsigned long long)std::max( 0., std::floor(estimatedSize - margin) ) );
+    estimate->upperBound = std::max( estimate->estimatedSize, (unsigned long long)std::ceil(estimatedSize + margin) );
+}
+
+static void
+getSequenceFiles(const SequenceFromPattern& sequence,
+                 vector<const string*>* files)
+{
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            files->push_back(&it2->second);
+        }
+    }
+}
+
+static void
+getSequenceFiles(const SequenceFromFiles& sequence,
+                 vector<const string*>* files)
+{
+    const map<int, FileNameContent>& indexes = sequence.getFrameIndexes();
+
+    files->reserve( indexes.size() );
+    for (map<int, FileNameContent>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+        files->push_back( &it->second.absoluteFileName() );
+    }
+}
+
+static void
+estimateSizeOfFiles(const vector<const string*>& files,
+                    size_t samplesCount,
+                    double confidence,
+                    SequenceSizeEstimate* estimate)
+{
+    vector<size_t> order;
+    makeSpreadOrder(files.size(), samplesCount, &order);
+    SizeSample sample( files.size() );
+    for (size_t i = 0; i < order.size(); ++i) {
+        FileInfo info;
+        const bool sized = getFileInfo(*files[order[i]], &info);
+        sample.addFile(sized, info.size);
+    }
+    makeSizeEstimate(sample, getConfidenceZScore(confidence), estimate);
+}
+} // namespace {
+
+SequenceSizeEstimate::SequenceSizeEstimate()
+    : estimatedSize(0)
+    , lowerBound(0)
+    , upperBound(0)
+    , filesCount(0)
+    , sizedFilesCount(0)
+    , exact(true)
+{
+}
+
+void
+estimateSequenceSize(const SequenceFromPattern& sequence,
+                     size_t samplesCount,
+                     SequenceSizeEstimate* estimate,
+                     double confidence)
+{
+    vector<const string*> files;
+
+    getSequenceFiles(sequence, &files);
+    estimateSizeOfFiles(files, samplesCount, confidence, estimate);
+}
+
+void
+estimateSequenceSize(const SequenceFromFiles& sequence,
+                     size_t samplesCount,
+                     SequenceSizeEstimate* estimate,
+                     double confidence)
+{
+    vector<const string*> files;
+
+    getSequenceFiles(sequence, &files);
+    estimateSizeOfFiles(files, samplesCount, confidence, estimate);
+}
+
+#if __cplusplus >= 201103L
+struct SequenceSizeEstimatorPrivate
+{
+    vector<string> files; //< in the order they are sized
+    double zScore;
+    SequenceSizeEstimateCallback callback;
+    mutable std::mutex mutex;
+    std::condition_variable finishedCond;
+    SizeSample sample;
+    bool finished;
+    std::atomic<bool> cancelRequested;
+    std::thread thread;
+
+    SequenceSizeEstimatorPrivate(const vector<const string*>& sequenceFiles,
+                                 size_t samplesCount,
+                                 double confidence,
+                                 const SequenceSizeEstimateCallback& callback)
+        : files()
+        , zScore( getConfidenceZScore(confidence) )
+        , callback(callback)
+        , mutex()
+        , finishedCond()
+        , sample( sequenceFiles.size() )
+        , finished(false)
+        , cancelRequested(false)
+        , thread()
+    {
+        vector<size_t> order;
+        makeSpreadOrder(sequenceFiles.size(), sequenceFiles.size(), &order);
+        files.reserve( order.size() );
+        for (size_t i = 0; i < order.size(); ++i) {
+            files.push_back(*sequenceFiles[order[i]]);
+        }
+
+        ///the first files of the order are the sample
+        samplesCount = std::min( samplesCount, files.size() );
+        for (size_t i = 0; i < samplesCount; ++i) {
+            FileInfo info;
+            const bool sized = getFileInfo(files[i], &info);
+            sample.addFile(sized, info.size);
+        }
+        if ( samplesCount < files.size() ) {
+            thread = std::thread(&SequenceSizeEstimatorPrivate::refine, this, samplesCount);
+        } else {
+            finished = true;
+        }
+    }
+
+    void refine(size_t first)
+    {
+        for (size_t i = first; i < files.size() && !cancelRequested; ++i) {
+            FileInfo info;
+            const bool sized = getFileInfo(files[i], &info);
+            SequenceSizeEstimate estimate;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sample.addFile(sized, info.size);
+                makeSizeEstimate(sample, zScore, &estimate);
+            }
+            if ( callback && ( estimate.exact || ( (i + 1 - first) % SEQUENCEPARSING_SIZE_ESTIMATE_CALLBACK_INTERVAL == 0 ) ) ) {
+                callback(estimate);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        finishedCond.notify_all();
+    }
+};
+
+SequenceSizeEstimator::SequenceSizeEstimator(const SequenceFromPattern& sequence,
+                                             size_t samplesCount,
+                                             double confidence,
+                                             const SequenceSizeEstimateCallback& callback)
+    : _imp()
+{
+    vector<const string*> files;
+
+    getSequenceFiles(sequence, &files);
+    _imp.reset( new SequenceSizeEstimatorPrivate(files, samplesCount, confidence, callback) );
+}
+
+SequenceSizeEstimator::SequenceSizeEstimator(const SequenceFromFiles& sequence,
+                                             size_t samplesCount,
+                                             double confidence,
+                                             const SequenceSizeEstimateCallback& callback)
+    : _imp()
+{
+    vector<const string*> files;
+
+    getSequenceFiles(sequence, &files);
+    _imp.reset( new SequenceSizeEstimatorPrivate(files, samplesCount, confidence, callback) );
+}
+
+SequenceSizeEstimator::~SequenceSizeEstimator()
+{
+    cancel();
+    if ( _imp->thread.joinable() ) {
+        _imp->thread.join();
+    }
+}
+
+void
+SequenceSizeEstimator::getEstimate(SequenceSizeEstimate* estimate) const
+{
+    std::lock_guard<std::mutex> lock(_imp->mutex);
+
+    makeSizeEstimate(_imp->sample, _imp->zScore, estimate);
+}
+
+void
+SequenceSizeEstimator::cancel()
+{
+    _imp->cancelRequested = true;
+}
+
+void
+SequenceSizeEstimator::wait()
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
+    _imp->finishedCond.wait(lock, [this] { return _imp->finished; });
+}
+#endif // __cplusplus >= 201103L
+
+#if __cplusplus >= 201103L
+typedef std::unordered_map<string, int> FileNamesIndex;
+#else
+typedef map<string, int> FileNamesIndex;
+#endif
+
+struct SequenceFromFilesPrivate
+{
+    ///all the files mapped to their index
+    map<int, FileNameContent> filesMap;
+
+    /// The index of the frame number string in case there're several numbers in a filename.
+    int frameNumberStringIndex;
+    unsigned long long totalSize;
+    bool sizeEstimationEnabled;
+    int minNumHashes;     //< the minimum number of hash tags # for the pattern
+
+    ///the frames of filesMap as ranges first frame -> last frame, for the fingerprint
+    map<int, int> frameRanges;
+
+    ///the sum of the hashes of the files info, only if sizeEstimationEnabled
+    unsigned long long fileInfosHash;
+
+    ///absolute file name -> frame of filesMap, built on the first lookup under indexesMutex, then updated by insertions
+    mutable FileNamesIndex fileNamesIndex;
+    mutable LazyFlag indexesValid;
+    mutable LazyInitMutex indexesMutex;
+
+    SequenceFromFilesPrivate(bool enableSizeEstimation)
+
+        : filesMap()
+        , frameNumberStringIndex(-1)
+        , totalSize(0)
+        , sizeEstimationEnabled(enableSizeEstimation)
+        , minNumHashes(0)
+        , frameRanges()
+        , fileInfosHash(0)
+        , fileNamesIndex()
+        , indexesValid(false)
+        , indexesMutex()
+    {
+    }
+
+    void ensureIndexes() const
+    {
+        if ( isLazyFlagSet(indexesValid) ) {
+            return;
+        }
+        LazyInitLocker locker(indexesMutex);
+        if ( isLazyFlagSet(indexesValid) ) {
+            return;
+        }
+        fileNamesIndex.clear();
+        for (map<int, FileNameContent>::const_iterator it = filesMap.begin(); it != filesMap.end(); ++it) {
+            fileNamesIndex.insert( make_pair(it->second.absoluteFileName(), it->first) );
+        }
+        setLazyFlag(indexesValid, true);
+    }
+
+    bool isInSequence(int index) const
+    {
+        return filesMap.find(index) != filesMap.end();
+    }
+
+    ///Must be called for each file inserted in filesMap
+    void onFileInserted(int frameNumber,
+                        const FileNameContent& file)
+    {
+        ///Sequences grouped without lookups never build the index, the others keep it up to date
+        if ( isLazyFlagSet(indexesValid) ) {
+            fileNamesIndex.insert( make_pair(file.absoluteFileName(), frameNumber) );
+        }
+        insertFrameInRanges(frameNumber, &frameRanges);
+        FileInfo info;
+        if ( sizeEstimationEnabled && getFileInfo(file.absoluteFileName(), &info) ) {
+            totalSize += info.size;
+            fileInfosHash += hashFileInfo(0, frameNumber, info);
+        }
+    }
+};
+
+SequenceFromFiles::SequenceFromFiles(bool enableSizeEstimation)
+    : _imp( new SequenceFromFilesPrivate(enableSizeEstimation) )
+{
+}
+
+SequenceFromFiles::SequenceFromFiles(const FileNameContent& firstFile,
+                                     bool enableSizeEstimation)
+    : _imp( new SequenceFromFilesPrivate(enableSizeEstimation) )
+{
+    tryInsertFile(firstFile);
+}
+
+SequenceFromFiles::~SequenceFromFiles()
+{
+}
+
+SequenceFromFiles::SequenceFromFiles(const SequenceFromFiles& other)
+    : _imp( new SequenceFromFilesPrivate(false) )
+{
+    *this = other;
+}
+
+void
+SequenceFromFiles::operator=(const SequenceFromFiles& other) const
+{
+    _imp->filesMap = other._imp->filesMap;
+    _imp->frameNumberStringIndex = other._imp->frameNumberStringIndex;
+    _imp->totalSize = other._imp->totalSize;
+    _imp->sizeEstimationEnabled = other._imp->sizeEstimationEnabled;
+    _imp->minNumHashes = other._imp->minNumHashes;
+    _imp->frameRanges = other._imp->frameRanges;
+    _imp->fileInfosHash = other._imp->fileInfosHash;
+    setLazyFlag(_imp->indexesValid, false);
+}
+
+bool
+SequenceFromFiles::tryInsertFile(const FileNameContent& file,
+                                 bool checkPath)
+{
+    if ( _imp->filesMap.empty() ) {
+        ///Special case when the sequence is empty, we don't have anything to match against.
+        string frameNumberStr;
+        _imp->frameNumberStringIndex = file.getPotentialFrameNumbersCount() - 1;
+        int frameNumber = -1;
+        bool ok = file.getNumberByIndex(_imp->frameNumberStringIndex, &frameNumberStr);
+        if (ok) {
+            frameNumber = stringToInt(frameNumberStr);
+        }
+        _imp->filesMap.insert( make_pair(frameNumber, file) );
+
+        _imp->minNumHashes = (int)frameNumberStr.size();
+
+        _imp->onFileInserted(frameNumber, file);
+
+        return true;
+    }
+
+    assert( !_imp->filesMap.empty() );
+
+    const FileNameContent& firstFileContent = _imp->filesMap.begin()->second;
+
+
+    if ( checkPath && ( file.getPath() != firstFileContent.getPath() ) ) {
+        return false;
+    }
+
+    ///If the filename has several numbers, such as toto11_titi22.jpg
+    ///This corresponds to the index of the number in which the frame number is expected to be.
+    ///e.g in this example if 22 would be the frame number, frameNumberIndex would be 1.
+    int frameNumberIndex;
+    bool insert = false;
     if ( file.matchesPattern(firstFileContent, &frameNumberIndex) ) {
         if (frameNumberIndex == _imp->frameNumberStringIndex) {
             insert = true;
 
-            string frameNumberStr;
-            bool ok = file.getNumberByIndex(_imp->frameNumberStringIndex, &frameNumberStr);
-            if (ok) {
-                pair<map<int, FileNameContent>::iterator, bool> success =
-                    _imp->filesMap.insert( make_pair(stringToInt(frameNumberStr), file) );
+            string frameNumberStr;
+            bool ok = file.getNumberByIndex(_imp->frameNumberStringIndex, &frameNumberStr);
+            if (ok) {
+                pair<map<int, FileNameContent>::iterator, bool> success =
+                    _imp->filesMap.insert( make_pair(stringToInt(frameNumberStr), file) );
+
+                ///Insert might have failed because we didn't check prior to this whether the file was already
+                ///present or not.
+                if (success.second) {
+                    _imp->onFileInserted(success.first->first, file);
+                } else {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+    }
+
+    return insert;
+} // SequenceFromFiles::tryInsertFile
+
+bool
+SequenceFromFiles::contains(const string& absoluteFileName) const
+{
+    _imp->ensureIndexes();
+
+    return _imp->fileNamesIndex.find(absoluteFileName) != _imp->fileNamesIndex.end();
+}
+
+void
+SequenceFromFiles::contains(const StringList& absoluteFileNames,
+                            vector<bool>* ret) const
+{
+    _imp->ensureIndexes();
+    ret->resize( absoluteFileNames.size() );
+    for (size_t i = 0; i < absoluteFileNames.size(); ++i) {
+        (*ret)[i] = _imp->fileNamesIndex.find(absoluteFileNames[i]) != _imp->fileNamesIndex.end();
+    }
+}
+
+const FileNameContent*
+SequenceFromFiles::getFileForFrame(int frameNumber) const
+{
+    map<int, FileNameContent>::const_iterator found = _imp->filesMap.find(frameNumber);
+
+    return found == _imp->filesMap.end() ? NULL : &found->second;
+}
+
+bool
+SequenceFromFiles::empty() const
+{
+    return _imp->filesMap.empty();
+}
+
+int
+SequenceFromFiles::count() const
+{
+    return (int)_imp->filesMap.size();
+}
+
+bool
+SequenceFromFiles::isSingleFile() const
+{
+    return _imp->filesMap.size() == 1;
+}
+
+int
+SequenceFromFiles::getFirstFrame() const
+{
+    if ( _imp->filesMap.empty() ) {
+        return INT_MIN;
+    } else {
+        return _imp->filesMap.begin()->first;
+    }
+}
+
+int
+SequenceFromFiles::getLastFrame() const
+{
+    if ( _imp->filesMap.empty() ) {
+        return INT_MAX;
+    } else {
+        map<int, FileNameContent>::const_iterator it = _imp->filesMap.end();
+        --it;
+
+        return it->first;
+    }
+}
+
+const map<int, FileNameContent>&
+SequenceFromFiles::getFrameIndexes() const
+{
+    return _imp->filesMap;
+}
+
+unsigned long long
+SequenceFromFiles::getEstimatedTotalSize() const
+{
+    return _imp->totalSize;
+}
+
+unsigned long long
+SequenceFromFiles::getFingerprint() const
+{
+    unsigned long long ret = hashString( kFingerprintSeed, generateValidSequencePattern() );
+
+    ///All files are in the view 0, as with a pattern without view variable
+    if ( !_imp->frameRanges.empty() ) {
+        ret = hashFrameRanges( ret, 0, _imp->frameRanges.size(), _imp->frameRanges.begin(), _imp->frameRanges.end() );
+    }
+    if (_imp->sizeEstimationEnabled) {
+        ret = combineHash(ret, (long long)_imp->fileInfosHash);
+    }
+
+    return ret;
+}
+
+string
+SequenceFromFiles::generateValidSequencePattern() const
+{
+    if ( empty() ) {
+        return "";
+    }
+    if ( isSingleFile() ) {
+        return _imp->filesMap.begin()->second.absoluteFileName();
+    }
+    assert(_imp->filesMap.size() >= 2);
+    string firstFramePattern;
+    _imp->filesMap.begin()->second.generatePatternWithFrameNumberAtIndex(_imp->frameNumberStringIndex,
+                                                                         _imp->minNumHashes,
+                                                                         &firstFramePattern);
+
+    return firstFramePattern;
+}
+
+string
+SequenceFromFiles::generateUserFriendlySequencePatternFromValidPattern(const string& validPattern) const
+{
+    assert( !isSingleFile() );
+    string pattern = validPattern;
+    vector< pair<int, int> > chunks;
+    //int first = getFirstFrame();
+    map<int, FileNameContent>::const_iterator first = _imp->filesMap.begin();
+    map<int, FileNameContent>::const_iterator cur = first;
+    map<int, FileNameContent>::const_iterator next = first;
+    if ( next != _imp->filesMap.end() ) {
+        ++next;
+    }
+    while ( first != _imp->filesMap.end() ) {
+        int breakCounter = 0;
+        while ( next != _imp->filesMap.end() && next->first == (cur->first + 1) ) {
+            if ( next != _imp->filesMap.end() ) {
+                ++next;
+            }
+            if ( cur != _imp->filesMap.end() ) {
+                ++cur;
+            }
+            ++breakCounter;
+        }
+        chunks.push_back( make_pair(first->first, cur->first) );
+        first = next;
+        if ( next != _imp->filesMap.end() ) {
+            ++next;
+        }
+        cur = first;
+    }
+
+    if (chunks.size() == 1) {
+        pattern += ' ';
+        pattern += stringFromInt(chunks[0].first);
+        pattern += '-';
+        pattern += stringFromInt(chunks[0].second);
+    } else {
+        pattern.append(" ( ");
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (chunks[i].first != chunks[i].second) {
+                pattern += ' ';
+                pattern += stringFromInt(chunks[i].first);
+                pattern += '-';
+                pattern += stringFromInt(chunks[i].second);
+            } else {
+                pattern += ' ';
+                pattern += stringFromInt(chunks[i].first);
+            }
+            if (i < chunks.size() - 1) {
+                pattern.append(" /");
+            }
+        }
+        pattern.append(" ) ");
+    }
+
+    return pattern;
+} // SequenceFromFiles::generateUserFriendlySequencePatternFromValidPattern
+
+string
+SequenceFromFiles::generateUserFriendlySequencePattern() const
+{
+    if ( isSingleFile() ) {
+        return _imp->filesMap.begin()->second.fileName();
+    }
+    string pattern = generateValidSequencePattern();
+    removePath(pattern);
+
+    return generateUserFriendlySequencePatternFromValidPattern(pattern);
+}
+
+string
+SequenceFromFiles::fileExtension() const
+{
+    if ( !empty() ) {
+        return _imp->filesMap.begin()->second.getExtension();
+    } else {
+        return string();
+    }
+}
+
+string
+SequenceFromFiles::getPath() const
+{
+    if ( !empty() ) {
+        return _imp->filesMap.begin()->second.getPath();
+    } else {
+        return string();
+    }
+}
+
+namespace {
+///Placeholder replacing the 'viewN' names while grouping, so that the view number is not mistaken for a frame number
+const char* const kViewNumberPlaceholder = "%V";
+
+///Files having a 'viewN' name, grouped by view number on their name where 'viewN' was replaced by kViewNumberPlaceholder
+struct ViewNumberSequences
+{
+    vector<SequenceFromFiles> sequences;
+    map<unsigned long long, vector<size_t> > sequencesBySignature;
+    size_t lastInsertedIndex;
+    map<string, string> realFileNames; //< placeholder file name -> real file name
+
+    ViewNumberSequences()
+        : sequences()
+        , sequencesBySignature()
+        , lastInsertedIndex(0)
+        , realFileNames()
+    {
+    }
+};
+
+///A sequence found by groupFilesIntoSequences whose pattern contains a view name
+struct ViewSequenceCandidate
+{
+    const SequenceFromFiles* sequence;
+    const map<string, string>* realFileNames; //< NULL unless the sequence was grouped with kViewNumberPlaceholder
+    char* merged;
+    bool isShortView;
+    bool isLongView;
+    int viewNumber;
+};
+
+///Candidates sharing the same pattern once their view name is removed
+struct ViewSequenceBucket
+{
+    string patternPath;
+    string prefix;
+    string suffix;
+    vector<ViewSequenceCandidate> candidates;
+};
+
+/*
+   Inserts the file in the first sequence accepting it, or in a new sequence.
+   Only the sequences whose files have the same signature are tried.
+ */
+static void
+insertInSequences(const FileNameContent& content,
+                  bool enableSizeEstimation,
+                  vector<SequenceFromFiles>* sequences,
+                  map<unsigned long long, vector<size_t> >* sequencesBySignature,
+                  size_t* lastInsertedIndex)
+{
+    vector<size_t>& candidates = (*sequencesBySignature)[content.getSignature()];
+
+    ///Consecutive files usually belong to the same sequence, try it first
+    bool inserted = !sequences->empty() &&
+                    (*sequences)[*lastInsertedIndex].getFrameIndexes().begin()->second.getSignature() == content.getSignature() &&
+                    (*sequences)[*lastInsertedIndex].tryInsertFile(content);
+
+    for (size_t j = 0; !inserted && j < candidates.size(); ++j) {
+        if ( (candidates[j] != *lastInsertedIndex) && (*sequences)[candidates[j]].tryInsertFile(content) ) {
+            inserted = true;
+            *lastInsertedIndex = candidates[j];
+        }
+    }
+    if (!inserted) {
+        candidates.push_back( sequences->size() );
+        sequences->push_back( SequenceFromFiles(content, enableSizeEstimation) );
+        *lastInsertedIndex = sequences->size() - 1;
+    }
+}
+
+static void
+addViewSequenceCandidate(const SequenceFromFiles& sequence,
+                         const map<string, string>* realFileNames,
+                         int placeholderViewNumber,
+                         char* merged,
+                         vector<ViewSequenceBucket>* buckets,
+                         map<string, size_t>* bucketsIndexes)
+{
+    string pattern = sequence.generateValidSequencePattern();
+    string patternPath = removePath(pattern);
+    ViewSequenceCandidate candidate;
+
+    candidate.sequence = &sequence;
+    candidate.realFileNames = realFileNames;
+    candidate.merged = merged;
+    size_t tokenPos, tokenSize;
+    if (realFileNames) {
+        tokenPos = pattern.find(kViewNumberPlaceholder);
+        assert(tokenPos != string::npos);
+        tokenSize = std::strlen(kViewNumberPlaceholder);
+        candidate.isShortView = candidate.isLongView = true;
+        candidate.viewNumber = placeholderViewNumber;
+    } else if ( !findViewToken(pattern, &tokenPos, &tokenSize, &candidate.isShortView, &candidate.isLongView, &candidate.viewNumber) ) {
+        return;
+    }
+    string prefix = pattern.substr(0, tokenPos);
+    string suffix = pattern.substr(tokenPos + tokenSize);
+    string key = patternPath + prefix + '\0' + suffix;
+    map<string, size_t>::iterator found = bucketsIndexes->find(key);
+    if ( found == bucketsIndexes->end() ) {
+        ViewSequenceBucket bucket;
+        bucket.patternPath = patternPath;
+        bucket.prefix = prefix;
+        bucket.suffix = suffix;
+        found = bucketsIndexes->insert( make_pair( key, buckets->size() ) ).first;
+        buckets->push_back(bucket);
+    }
+    (*buckets)[found->second].candidates.push_back(candidate);
+}
+
+/*
+   Returns true if the extension of the file (what follows the last '.') is in the list.
+ */
+static bool
+hasExtensionInList(const char* filename,
+                   size_t filenameSize,
+                   const StringList& extensions)
+{
+    size_t extensionPos = filenameSize;
+    while ( extensionPos > 0 && filename[extensionPos - 1] != '.' ) {
+        --extensionPos;
+    }
+    if (extensionPos == 0) {
+        extensionPos = filenameSize; // no extension
+    }
+    for (size_t i = 0; i < extensions.size(); ++i) {
+        if ( extensions[i].compare(0, string::npos, filename + extensionPos, filenameSize - extensionPos) == 0 ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+   Implementation of both groupFilesIntoSequences overloads: if sharedPath is not NULL, fileNames
+   are the names of files in that directory, otherwise they are absolute file names.
+ */
+static void
+groupFilesIntoSequencesInternal(const string* sharedPath,
+                                const StringList& fileNames,
+                                const StringList& extensions,
+                                vector<SequenceFromFiles>* sequences,
+                                vector<MultiViewSequence>* multiViewSequences,
+                                bool enableSizeEstimation)
+{
+    vector<SequenceFromFiles> found;
+    map<unsigned long long, vector<size_t> > foundBySignature;
+    size_t lastInsertedIndex = 0;
+    map<int, ViewNumberSequences> viewNumberSequences;
+
+    for (size_t i = 0; i < fileNames.size(); ++i) {
+        string filename = fileNames[i];
+        string path = sharedPath ? *sharedPath : removePath(filename);
+
+        ///Cheap rejection of the files we will never group, before any tokenization
+        if ( !extensions.empty() && !hasExtensionInList( filename.data(), filename.size(), extensions ) ) {
+            continue;
+        }
+
+        if (multiViewSequences) {
+            ///The number of a 'viewN' name would otherwise be taken as the frame number by SequenceFromFiles
+            size_t tokenPos, tokenSize;
+            bool isShortView, isLongView;
+            int viewNumber;
+            if ( findViewToken(filename, &tokenPos, &tokenSize, &isShortView, &isLongView, &viewNumber) && isShortView && isLongView ) {
+                string placeholderName = path + filename.substr(0, tokenPos) + kViewNumberPlaceholder + filename.substr(tokenPos + tokenSize);
+                ViewNumberSequences& viewSequences = viewNumberSequences[viewNumber];
+                ///view1 and view01 give the same placeholder name: the second one is grouped with its real name
+                if ( viewSequences.realFileNames.insert( make_pair(placeholderName, path + filename) ).second ) {
+                    insertInSequences(FileNameContent(placeholderName), false, &viewSequences.sequences,
+                                      &viewSequences.sequencesBySignature, &viewSequences.lastInsertedIndex);
+                    continue;
+                }
+            }
+        }
+        insertInSequences(FileNameContent(path, filename), enableSizeEstimation, &found, &foundBySignature, &lastInsertedIndex);
+    }
+
+    vector<char> merged(found.size(), 0);
+    map<int, vector<char> > viewNumberMerged;
+    if (multiViewSequences) {
+        ///Bucket the sequences by their pattern without the view name, in the order they were found
+        vector<ViewSequenceBucket> buckets;
+        map<string, size_t> bucketsIndexes;
+        for (size_t i = 0; i < found.size(); ++i) {
+            addViewSequenceCandidate(found[i], NULL, -1, &merged[i], &buckets, &bucketsIndexes);
+        }
+        for (map<int, ViewNumberSequences>::const_iterator it = viewNumberSequences.begin(); it != viewNumberSequences.end(); ++it) {
+            vector<char>& viewMerged = viewNumberMerged[it->first];
+            viewMerged.resize(it->second.sequences.size(), 0);
+            for (size_t i = 0; i < it->second.sequences.size(); ++i) {
+                addViewSequenceCandidate(it->second.sequences[i], &it->second.realFileNames, it->first, &viewMerged[i], &buckets, &bucketsIndexes);
+            }
+        }
+
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            const vector<ViewSequenceCandidate>& candidates = buckets[i].candidates;
+            if (candidates.size() < 2) {
+                continue;
+            }
+
+            ///%v and %V cannot be mixed: if any long view name is present, use %V and leave out the short ones.
+            ///viewN names are accepted by both.
+            bool hasShortOnly = false;
+            bool hasLongOnly = false;
+            for (size_t j = 0; j < candidates.size(); ++j) {
+                hasShortOnly |= candidates[j].isShortView && !candidates[j].isLongView;
+                hasLongOnly |= candidates[j].isLongView && !candidates[j].isShortView;
+            }
+            const bool useLongView = hasLongOnly || !hasShortOnly;
+
+            map<int, const ViewSequenceCandidate*> candidateByView;
+            for (size_t j = 0; j < candidates.size(); ++j) {
+                if ( useLongView ? !candidates[j].isLongView : !candidates[j].isShortView ) {
+                    continue;
+                }
+                ///2 sequences for the same view cannot be told apart, keep the first one
+                candidateByView.insert( make_pair(candidates[j].viewNumber, &candidates[j]) );
+            }
+            if (candidateByView.size() < 2) {
+                continue;
+            }
+
+            MultiViewSequence multiView;
+            multiView.pattern = buckets[i].patternPath + buckets[i].prefix + (useLongView ? "%V" : "%v") + buckets[i].suffix;
+            for (map<int, const ViewSequenceCandidate*>::const_iterator it = candidateByView.begin(); it != candidateByView.end(); ++it) {
+                const ViewSequenceCandidate& candidate = *it->second;
+                const map<int, FileNameContent>& frames = candidate.sequence->getFrameIndexes();
+                for (map<int, FileNameContent>::const_iterator it2 = frames.begin(); it2 != frames.end(); ++it2) {
+                    const string& filename = candidate.realFileNames ?
+                                             candidate.realFileNames->find( it2->second.absoluteFileName() )->second :
+                                             it2->second.absoluteFileName();
+                    multiView.sequence[it2->first].insert( make_pair(it->first, filename) );
+                }
+                *candidate.merged = 1;
+            }
+            multiViewSequences->push_back(multiView);
+        }
+
+        ///Files with a 'viewN' name that could not be merged are grouped again with their real name.
+        ///They are kept apart from the sequences found so far: a sequence already merged must not receive them.
+        vector<SequenceFromFiles> regrouped;
+        map<unsigned long long, vector<size_t> > regroupedBySignature;
+        size_t lastRegroupedIndex = 0;
+        for (map<int, ViewNumberSequences>::const_iterator it = viewNumberSequences.begin(); it != viewNumberSequences.end(); ++it) {
+            const vector<char>& viewMerged = viewNumberMerged[it->first];
+            for (size_t i = 0; i < it->second.sequences.size(); ++i) {
+                if (viewMerged[i]) {
+                    continue;
+                }
+                const map<int, FileNameContent>& frames = it->second.sequences[i].getFrameIndexes();
+                for (map<int, FileNameContent>::const_iterator it2 = frames.begin(); it2 != frames.end(); ++it2) {
+                    const string& filename = it->second.realFileNames.find( it2->second.absoluteFileName() )->second;
+                    insertInSequences(FileNameContent(filename), enableSizeEstimation, &regrouped, &regroupedBySignature, &lastRegroupedIndex);
+                }
+            }
+        }
+        for (size_t i = 0; i < found.size(); ++i) {
+            if (!merged[i]) {
+                sequences->push_back(found[i]);
+            }
+        }
+        sequences->insert( sequences->end(), regrouped.begin(), regrouped.end() );
+    } else {
+        sequences->insert( sequences->end(), found.begin(), found.end() );
+    }
+} // groupFilesIntoSequencesInternal
+} // namespace {
+
+void
+groupFilesIntoSequences(const StringList& absoluteFileNames,
+                        vector<SequenceFromFiles>* sequences,
+                        vector<MultiViewSequence>* multiViewSequences,
+                        bool enableSizeEstimation)
+{
+    groupFilesIntoSequencesInternal(NULL, absoluteFileNames, StringList(), sequences, multiViewSequences, enableSizeEstimation);
+}
+
+void
+groupFilesIntoSequences(const string& path,
+                        const StringList& fileNames,
+                        const StringList& extensions,
+                        vector<SequenceFromFiles>* sequences,
+                        vector<MultiViewSequence>* multiViewSequences,
+                        bool enableSizeEstimation)
+{
+    groupFilesIntoSequencesInternal(&path, fileNames, extensions, sequences, multiViewSequences, enableSizeEstimation);
+}
+
+#if __cplusplus >= 201103L
+struct SequenceStreamGrouperPrivate
+{
+    ///A sequence that may still be extended
+    struct OpenSequence
+    {
+        string prefix; //< the text preceding the frame number, shared by all the files of the sequence
+        SequenceFromFiles sequence;
+
+        OpenSequence(const string& prefix,
+                     const FileNameContent& firstFile,
+                     bool enableSizeEstimation)
+            : prefix(prefix)
+            , sequence(firstFile, enableSizeEstimation)
+        {
+        }
+    };
+
+    SequenceGroupedCallback callback;
+    bool enableSizeEstimation;
+    std::deque<OpenSequence> openSequences; //< in the order they were started
+
+    SequenceStreamGrouperPrivate(const SequenceGroupedCallback& callback,
+                                 bool enableSizeEstimation)
+        : callback(callback)
+        , enableSizeEstimation(enableSizeEstimation)
+        , openSequences()
+    {
+    }
+
+    void addFile(const string& path,
+                 const string& filename,
+                 const FileNameContent& content)
+    {
+        ///SequenceFromFiles only varies the last number of the names, so the text before it cannot change.
+        ///A file without number cannot be extended, its whole name is used.
+        size_t numberStart = filename.size();
+        size_t numberEnd = filename.find_last_of("0123456789");
+        if (numberEnd != string::npos) {
+            numberStart = numberEnd;
+            while ( numberStart > 0 && std::isdigit( (unsigned char)filename[numberStart - 1] ) ) {
+                --numberStart;
+            }
+        }
+
+        ///In sorted order, the names starting with a given prefix are contiguous: once a name does not
+        ///start with the prefix of a sequence, no later name does.
+        for (std::deque<OpenSequence>::iterator it = openSequences.begin(); it != openSequences.end();) {
+            const string& prefix = it->prefix;
+            ///path + filename starts with prefix
+            const bool extendable = prefix.size() <= path.size() ?
+                                    path.compare(0, prefix.size(), prefix) == 0 :
+                                    ( path.compare(0, path.size(), prefix, 0, path.size()) == 0 ) &&
+                                    ( filename.compare(0, prefix.size() - path.size(), prefix, path.size(), string::npos) == 0 );
+            if (extendable) {
+                ++it;
+            } else {
+                callback(it->sequence);
+                it = openSequences.erase(it);
+            }
+        }
+
+        for (std::deque<OpenSequence>::iterator it = openSequences.begin(); it != openSequences.end(); ++it) {
+            if ( (it->sequence.getFrameIndexes().begin()->second.getSignature() == content.getSignature()) &&
+                 it->sequence.tryInsertFile(content) ) {
+                return;
+            }
+        }
+        openSequences.push_back( OpenSequence(path + filename.substr(0, numberStart), content, enableSizeEstimation) );
+    }
+};
+
+SequenceStreamGrouper::SequenceStreamGrouper(const SequenceGroupedCallback& callback,
+                                             bool enableSizeEstimation)
+    : _imp( new SequenceStreamGrouperPrivate(callback, enableSizeEstimation) )
+{
+}
+
+SequenceStreamGrouper::~SequenceStreamGrouper()
+{
+}
+
+void
+SequenceStreamGrouper::addFile(const string& absoluteFileName)
+{
+    string filename = absoluteFileName;
+    string path = removePath(filename);
+
+    _imp->addFile( path, filename, FileNameContent(path, filename) );
+}
+
+void
+SequenceStreamGrouper::addFile(const string& path,
+                               const string& filename)
+{
+    _imp->addFile( path, filename, FileNameContent(path, filename) );
+}
+
+void
+SequenceStreamGrouper::finish()
+{
+    while ( !_imp->openSequences.empty() ) {
+        _imp->callback(_imp->openSequences.front().sequence);
+        _imp->openSequences.pop_front();
+    }
+}
+
+size_t
+SequenceStreamGrouper::getOpenSequencesCount() const
+{
+    return _imp->openSequences.size();
+}
+
+namespace {
+/*
+   Brings the file in the cache of the operating system. Returns early if 'generation' no longer equals 'requestGeneration'.
+ */
+static void
+prefetchFile(const string& filename,
+             SequencePrefetcher::PrefetchModeEnum mode,
+             const std::atomic<unsigned int>& generation,
+             unsigned int requestGeneration)
+{
+    ///reading by chunks allows to stop when the player seeks
+    const size_t chunkSize = 1024 * 1024;
+#ifdef _WIN32
+    (void)mode;
+    ++gFilesOpened;
+    HANDLE file = CreateFileW(utf8_to_utf16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    vector<char> buffer(chunkSize);
+    DWORD bytesRead = 0;
+    while (generation == requestGeneration) {
+        ++gReadCalls;
+        if ( !ReadFile(file, &buffer[0], (DWORD)buffer.size(), &bytesRead, NULL) || (bytesRead == 0) ) {
+            break;
+        }
+    }
+    CloseHandle(file);
+#else
+    ++gFilesOpened;
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+#if defined(POSIX_FADV_WILLNEED) && !defined(__APPLE__)
+    if ( (mode == SequencePrefetcher::eModeAdvise) && (posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0) ) {
+        ::close(fd);
+
+        return;
+    }
+#else
+    (void)mode;
+#endif
+    vector<char> buffer(chunkSize);
+    while ( generation == requestGeneration && readFileData(fd, &buffer[0], buffer.size()) > 0 ) {
+    }
+    ::close(fd);
+#endif // _WIN32
+} // prefetchFile
+} // namespace {
+
+struct SequencePrefetcherPrivate
+{
+    const SequenceFromPattern& sequence;
+    const int windowSize;
+    const SequencePrefetcher::PrefetchModeEnum mode;
+
+    ///Incremented to drop the pending requests
+    std::atomic<unsigned int> generation;
+    std::atomic<size_t> pendingRequests;
+    std::atomic<size_t> prefetchedFiles;
+
+    ///The frames already requested since the last seek, and the last frame set by the player
+    std::set<int> requestedFrames;
+    int currentFrame;
+    int direction;
+    bool hasCurrentFrame;
+
+    ///Declared last so that its threads are joined before anything else is destroyed
+    ThreadPool pool;
+
+    SequencePrefetcherPrivate(const SequenceFromPattern& sequence,
+                              int windowSize,
+                              int threadsCount,
+                              SequencePrefetcher::PrefetchModeEnum mode)
+        : sequence(sequence)
+        , windowSize( std::max(1, windowSize) )
+        , mode(mode)
+        , generation(0)
+        , pendingRequests(0)
+        , prefetchedFiles(0)
+        , requestedFrames()
+        , currentFrame(0)
+        , direction(1)
+        , hasCurrentFrame(false)
+        , pool( std::max(1, threadsCount) )
+    {
+    }
+
+    void request(const string& filename)
+    {
+        const unsigned int requestGeneration = generation;
+
+        ++pendingRequests;
+        pool.post([this, filename, requestGeneration] {
+            if (generation == requestGeneration) {
+                prefetchFile(filename, mode, generation, requestGeneration);
+                ++prefetchedFiles;
+            }
+            --pendingRequests;
+        });
+    }
+
+    void requestFrame(int frame,
+                      const map<int, string>& views)
+    {
+        if ( !requestedFrames.insert(frame).second ) {
+            return;
+        }
+        for (map<int, string>::const_iterator it = views.begin(); it != views.end(); ++it) {
+            request(it->second);
+        }
+    }
+};
+
+SequencePrefetcher::SequencePrefetcher(const SequenceFromPattern& sequence,
+                                       int windowSize,
+                                       int threadsCount,
+                                       PrefetchModeEnum mode)
+    : _imp( new SequencePrefetcherPrivate(sequence, windowSize, threadsCount, mode) )
+{
+}
+
+SequencePrefetcher::~SequencePrefetcher()
+{
+    cancel();
+}
+
+void
+SequencePrefetcher::setCurrentFrame(int frame,
+                                    int direction)
+{
+    direction = direction < 0 ? -1 : 1;
+
+    ///Moving within the previous window in the same direction is not a seek
+    const long long distance = ( (long long)frame - _imp->currentFrame ) * direction;
+    if ( !_imp->hasCurrentFrame || (direction != _imp->direction) || (distance < 0) || (distance > _imp->windowSize) ) {
+        cancel();
+    }
+    _imp->hasCurrentFrame = true;
+    _imp->currentFrame = frame;
+    _imp->direction = direction;
+
+    ///Forget the frames behind the player
+    if (direction > 0) {
+        _imp->requestedFrames.erase( _imp->requestedFrames.begin(), _imp->requestedFrames.lower_bound(frame) );
+    } else {
+        _imp->requestedFrames.erase( _imp->requestedFrames.upper_bound(frame), _imp->requestedFrames.end() );
+    }
+
+    ///The frames after the current one, in the sequence
+    int count = 0;
+    if (direction > 0) {
+        for (SequenceFromPattern::const_iterator it = _imp->sequence.upper_bound(frame);
+             it != _imp->sequence.end() && count < _imp->windowSize; ++it, ++count) {
+            _imp->requestFrame(it->first, it->second);
+        }
+    } else {
+        for (SequenceFromPattern::const_reverse_iterator it( _imp->sequence.lower_bound(frame) );
+             it != _imp->sequence.rend() && count < _imp->windowSize; ++it, ++count) {
+            _imp->requestFrame(it->first, it->second);
+        }
+    }
+} // SequencePrefetcher::setCurrentFrame
+
+void
+SequencePrefetcher::cancel()
+{
+    ++_imp->generation;
+    _imp->requestedFrames.clear();
+    _imp->hasCurrentFrame = false;
+}
+
+size_t
+SequencePrefetcher::getPendingRequestsCount() const
+{
+    return _imp->pendingRequests;
+}
+
+size_t
+SequencePrefetcher::getPrefetchedFilesCount() const
+{
+    return _imp->prefetchedFiles;
+}
+#endif // __cplusplus >= 201103L
+
+namespace {
+///The first bytes of any encoded sequence, followed by the format version
+const char kWireMagic[4] = { 'S', 'Q', 'W', 'F' };
+const unsigned long long kWireVersion = 1;
+
+enum WireFlagsEnum
+{
+    eWireFlagSizes = 0x1,
+    eWireFlagModificationTimes = 0x2,
+    eWireFlagInodes = 0x4
+};
+
+///The files of a view, ordered by frame, as they are encoded
+struct WireViewFiles
+{
+    string token; //< what replaces the %v or %V variables of the pattern
+    vector<pair<int, const string*> > files;
+};
+
+static void
+writeVarint(unsigned long long value,
+            string* data)
+{
+    while (value >= 0x80) {
+        data->push_back( (char)( (value & 0x7f) | 0x80 ) );
+        value >>= 7;
+    }
+    data->push_back( (char)value );
+}
+
+///Zigzag encoding so that small negative values take few bytes too
+static void
+writeSignedVarint(long long value,
+                  string* data)
+{
+    writeVarint( ( (unsigned long long)value << 1 ) ^ (unsigned long long)(value >> 63), data );
+}
+
+static void
+writeString(const string& str,
+            string* data)
+{
+    writeVarint(str.size(), data);
+    data->append(str);
+}
+
+/*
+   Reads the encoded data in place. Once a read fails, all the following ones fail too.
+ */
+class WireReader
+{
+public:
+
+    WireReader(const char* data,
+               size_t size)
+        : _it(data)
+        , _end(data + size)
+        , _ok(true)
+    {
+    }
+
+    bool ok() const
+    {
+        return _ok;
+    }
+
+    size_t getRemainingSize() const
+    {
+        return (size_t)(_end - _it);
+    }
+
+    bool readVarint(unsigned long long* value)
+    {
+        *value = 0;
+        for (int shift = 0; _ok && shift < 64; shift += 7) {
+            if (_it == _end) {
+                break;
+            }
+            const unsigned char byte = (unsigned char)*_it++;
+            *value |= (unsigned long long)(byte & 0x7f) << shift;
+            if ( !(byte & 0x80) ) {
+                return true;
+            }
+        }
+        _ok = false;
+
+        return false;
+    }
+
+    bool readSignedVarint(long long* value)
+    {
+        unsigned long long encoded;
+        if ( !readVarint(&encoded) ) {
+            return false;
+        }
+        *value = (long long)(encoded >> 1) ^ -(long long)(encoded & 1);
+
+        return true;
+    }
+
+    ///Reads an int, failing if the value does not fit
+    bool readInt(long long value,
+                 int* ret)
+    {
+        if ( (value < INT_MIN) || (value > INT_MAX) ) {
+            _ok = false;
+
+            return false;
+        }
+        *ret = (int)value;
+
+        return true;
+    }
+
+    ///Returns the location of the string in the data, without copying it
+    bool readString(const char** str,
+                    size_t* size)
+    {
+        unsigned long long length;
+        if ( !readVarint(&length) ) {
+            return false;
+        }
+        if ( length > (unsigned long long)(_end - _it) ) {
+            _ok = false;
+
+            return false;
+        }
+        *str = _it;
+        *size = (size_t)length;
+        _it += length;
+
+        return true;
+    }
+
+    bool readMagic()
+    {
+        if ( (_end - _it < (long)sizeof(kWireMagic)) || (std::memcmp(_it, kWireMagic, sizeof(kWireMagic)) != 0) ) {
+            _ok = false;
+
+            return false;
+        }
+        _it += sizeof(kWireMagic);
+
+        return true;
+    }
+
+private:
+    const char* _it;
+    const char* _end;
+    bool _ok;
+};
+
+/*
+   Returns the pattern where the view variables are replaced by the given view token.
+ */
+static string
+substituteViewVariables(const string& pattern,
+                        const string& token)
+{
+    string ret;
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if ( (pattern[i] == '%') && ( i + 1 < pattern.size() ) && ( (pattern[i + 1] == 'v') || (pattern[i + 1] == 'V') ) ) {
+            ret.append(token);
+            ++i;
+        } else {
+            ret.push_back(pattern[i]);
+        }
+    }
+
+    return ret;
+}
+
+/*
+   Finds the name of the view used in the given file name, among the names the %v and %V variables accept.
+   Returns an empty string if the pattern has no view variable or if none generates the file name,
+   in which case the files of the view that do not match the pattern are stored verbatim.
+ */
+static string
+findWireViewToken(const string& pattern,
+                  int viewNumber,
+                  int frameNumber,
+                  const string& fileName)
+{
+    if ( (pattern.find("%v") == string::npos) && (pattern.find("%V") == string::npos) ) {
+        return string();
+    }
+    StringList candidates;
+    if (viewNumber == 0) {
+        candidates.push_back("l");
+        candidates.push_back("left");
+    } else if (viewNumber == 1) {
+        candidates.push_back("r");
+        candidates.push_back("right");
+    }
+    candidates.push_back( "view" + stringFromInt(viewNumber) );
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const string viewPattern = substituteViewVariables(pattern, candidates[i]);
+        if (generateFileNameFromPattern(viewPattern, StringList(), frameNumber, viewNumber) == fileName) {
+            return candidates[i];
+        }
+    }
+
+    return string();
+}
+
+/*
+   Reads the header and the frames of each view, then generates the file names in 'files' if it is not NULL
+   and collects the frame ranges in 'viewsFrames' if it is not NULL.
+ */
+static bool
+readWireSequence(WireReader& reader,
+                 string* pattern,
+                 unsigned long long* flags,
+                 vector<pair<int, size_t> >* filesCountPerView,
+                 SequenceFromPattern* files,
+                 std::map<int, FrameRanges>* viewsFrames)
+{
+    unsigned long long version, viewsCount;
+    const char* patternData;
+    size_t patternSize;
+
+    if ( !reader.readMagic() || !reader.readVarint(&version) || (version > kWireVersion) ||
+         !reader.readVarint(flags) || !reader.readString(&patternData, &patternSize) ||
+         !reader.readVarint(&viewsCount) ) {
+        return false;
+    }
+    pattern->assign(patternData, patternSize);
+
+    unsigned long long totalFilesCount = 0;
+    for (unsigned long long v = 0; v < viewsCount; ++v) {
+        long long viewValue;
+        int view;
+        const char* tokenData;
+        size_t tokenSize;
+        unsigned long long rangesCount;
+        if ( !reader.readSignedVarint(&viewValue) || !reader.readInt(viewValue, &view) ||
+             !reader.readString(&tokenData, &tokenSize) || !reader.readVarint(&rangesCount) ) {
+            return false;
+        }
+        ///views are sorted
+        if ( !filesCountPerView->empty() && (view <= filesCountPerView->back().first) ) {
+            return false;
+        }
+
+        FrameRanges ranges;
+        long long previous = 0;
+        unsigned long long filesCount = 0;
+        for (unsigned long long r = 0; r < rangesCount; ++r) {
+            long long delta;
+            unsigned long long length;
+            int first, last;
+            if ( !reader.readSignedVarint(&delta) || !reader.readVarint(&length) ||
+                 !reader.readInt(previous + delta, &first) || (length > (unsigned long long)INT_MAX) ||
+                 !reader.readInt(first + (long long)length, &last) ) {
+                return false;
+            }
+            ///ranges are sorted and disjoint
+            if ( !ranges.empty() && (first <= ranges.back().second) ) {
+                return false;
+            }
+            ranges.push_back( make_pair(first, last) );
+            filesCount += length + 1;
+            previous = last;
+        }
+
+        ///Generating the names (and the metadata of deserializeSequence) takes memory proportional to the files count
+        totalFilesCount += filesCount;
+        if ( files && (totalFilesCount > SEQUENCEPARSING_WIRE_MAX_FILES_COUNT) ) {
+            return false;
+        }
+
+        ///The exceptions are indexes in the files of the view, in increasing order. They are not copied.
+        ///Each one takes at least 2 bytes: check the count against the data left before allocating them.
+        unsigned long long exceptionsCount;
+        if ( !reader.readVarint(&exceptionsCount) || (exceptionsCount > filesCount) ||
+             ( exceptionsCount > reader.getRemainingSize() / 2 ) ) {
+            return false;
+        }
+        vector<pair<unsigned long long, pair<const char*, size_t> > > exceptions( (size_t)exceptionsCount );
+        for (size_t i = 0; i < exceptions.size(); ++i) {
+            unsigned long long delta;
+            if ( !reader.readVarint(&delta) || !reader.readString(&exceptions[i].second.first, &exceptions[i].second.second) ) {
+                return false;
+            }
+            exceptions[i].first = (i == 0 ? 0 : exceptions[i - 1].first) + delta;
+            if ( ( (i > 0) && (delta == 0) ) || (exceptions[i].first >= filesCount) ) {
+                return false;
+            }
+        }
+
+        if (viewsFrames) {
+            FrameRanges& viewRanges = (*viewsFrames)[view];
+            viewRanges.insert( viewRanges.end(), ranges.begin(), ranges.end() );
+        }
+        if (files) {
+            const string viewPattern = substituteViewVariables( *pattern, string(tokenData, tokenSize) );
+            size_t fileIndex = 0;
+            size_t exceptionIndex = 0;
+            for (FrameRanges::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+                for (long long frame = it->first; frame <= it->second; ++frame, ++fileIndex) {
+                    if ( ( exceptionIndex < exceptions.size() ) && (exceptions[exceptionIndex].first == fileIndex) ) {
+                        const pair<const char*, size_t>& name = exceptions[exceptionIndex].second;
+                        insertFileInSequence( (int)frame, view, string(name.first, name.second), files );
+                        ++exceptionIndex;
+                    } else {
+                        insertFileInSequence( (int)frame, view, generateFileNameFromPattern(viewPattern, StringList(), (int)frame, view), files );
+                    }
+                }
+            }
+        }
+        filesCountPerView->push_back( make_pair(view, (size_t)filesCount) );
+    }
+
+    return reader.ok();
+} // readWireSequence
+} // namespace {
+
+void
+serializeSequence(const string& pattern,
+                  const SequenceFromPattern& sequence,
+                  const SequenceFilesMetadata* metadata,
+                  string* data)
+{
+    map<int, WireViewFiles> views;
+
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            views[it2->first].files.push_back( make_pair(it->first, &it2->second) );
+        }
+    }
+
+    ///Index the metadata by view and frame
+    unsigned long long flags = 0;
+    map<pair<int, int>, size_t> metadataIndexes;
+    if (metadata) {
+        for (size_t i = 0; i < metadata->size(); ++i) {
+            metadataIndexes.insert( make_pair(make_pair(metadata->views[i], metadata->frames[i]), i) );
+            flags |= metadata->sizes[i] ? eWireFlagSizes : 0;
+            flags |= metadata->modificationTimes[i] ? eWireFlagModificationTimes : 0;
+            flags |= metadata->inodes[i] ? eWireFlagInodes : 0;
+        }
+    }
+
+    data->append( kWireMagic, sizeof(kWireMagic) );
+    writeVarint(kWireVersion, data);
+    writeVarint(flags, data);
+    writeString(pattern, data);
+    writeVarint(views.size(), data);
+
+    for (map<int, WireViewFiles>::iterator it = views.begin(); it != views.end(); ++it) {
+        WireViewFiles& view = it->second;
+        view.token = findWireViewToken(pattern, it->first, view.files.front().first, *view.files.front().second);
+        const string viewPattern = substituteViewVariables(pattern, view.token);
+
+        FrameRanges ranges;
+        vector<size_t> exceptions;
+        for (size_t i = 0; i < view.files.size(); ++i) {
+            appendFrameToRanges(view.files[i].first, &ranges);
+            if (generateFileNameFromPattern(viewPattern, StringList(), view.files[i].first, it->first) != *view.files[i].second) {
+                exceptions.push_back(i);
+            }
+        }
+
+        writeSignedVarint(it->first, data);
+        writeString(view.token, data);
+        writeVarint(ranges.size(), data);
+        long long previous = 0;
+        for (FrameRanges::const_iterator it2 = ranges.begin(); it2 != ranges.end(); ++it2) {
+            writeSignedVarint( (long long)it2->first - previous, data );
+            writeVarint( (unsigned long long)( (long long)it2->second - it2->first ), data );
+            previous = it2->second;
+        }
+        writeVarint(exceptions.size(), data);
+        size_t previousException = 0;
+        for (size_t i = 0; i < exceptions.size(); ++i) {
+            writeVarint(exceptions[i] - previousException, data);
+            writeString(*view.files[exceptions[i]].second, data);
+            previousException = exceptions[i];
+        }
+    }
 
-                ///Insert might have failed because we didn't check prior to this whether the file was already
-                ///present or not.
-                if (success.second) {
-                    if (_imp->sizeEstimationEnabled) {
-                        _imp->totalSize += getFileSize( file.absoluteFileName() );
-                    }
-                } else {
-                    return false;
+    ///The metadata columns, in the same order as the files
+    const int columns[3] = { eWireFlagSizes, eWireFlagModificationTimes, eWireFlagInodes };
+    for (int c = 0; c < 3; ++c) {
+        if ( !(flags & columns[c]) ) {
+            continue;
+        }
+        for (map<int, WireViewFiles>::const_iterator it = views.begin(); it != views.end(); ++it) {
+            long long previous = 0;
+            for (size_t i = 0; i < it->second.files.size(); ++i) {
+                map<pair<int, int>, size_t>::const_iterator found = metadataIndexes.find( make_pair(it->first, it->second.files[i].first) );
+                long long value = 0;
+                if ( found != metadataIndexes.end() ) {
+                    value = columns[c] == eWireFlagSizes ? (long long)metadata->sizes[found->second] :
+                            columns[c] == eWireFlagModificationTimes ? metadata->modificationTimes[found->second] :
+                            (long long)metadata->inodes[found->second];
                 }
-            } else {
-                return false;
+                ///modification times and inodes of a sequence are usually close to each other
+                writeSignedVarint(value - previous, data);
+                previous = value;
             }
         }
     }
-
-    return insert;
-} // SequenceFromFiles::tryInsertFile
+} // serializeSequence
 
 bool
-SequenceFromFiles::contains(const string& absoluteFileName) const
+deserializeSequence(const char* data,
+                    size_t size,
+                    string* pattern,
+                    SequenceFromPattern* sequence,
+                    SequenceFilesMetadata* metadata)
 {
-    for (map <int, FileNameContent >::const_iterator it = _imp->filesMap.begin(); it != _imp->filesMap.end(); ++it) {
-        if (it->second.absoluteFileName() == absoluteFileName) {
-            return true;
+    WireReader reader(data, size);
+    unsigned long long flags;
+    vector<pair<int, size_t> > filesCountPerView;
+    SequenceFromPattern files;
+
+    if ( !readWireSequence(reader, pattern, &flags, &filesCountPerView, &files, NULL) ) {
+        return false;
+    }
+
+    if (metadata) {
+        ///Files are stored by view then frame, that is not the order of the SequenceFromPattern
+        size_t filesCount = 0;
+        for (size_t i = 0; i < filesCountPerView.size(); ++i) {
+            filesCount += filesCountPerView[i].second;
+        }
+        metadata->clear();
+        metadata->sizes.resize(filesCount, 0);
+        metadata->modificationTimes.resize(filesCount, 0);
+        metadata->inodes.resize(filesCount, 0);
+        for (size_t i = 0; i < filesCountPerView.size(); ++i) {
+            const int view = filesCountPerView[i].first;
+            for (SequenceFromPattern::const_iterator it = files.begin(); it != files.end(); ++it) {
+                if ( it->second.find(view) != it->second.end() ) {
+                    metadata->frames.push_back(it->first);
+                    metadata->views.push_back(view);
+                }
+            }
         }
     }
 
-    return false;
-}
+    const int columns[3] = { eWireFlagSizes, eWireFlagModificationTimes, eWireFlagInodes };
+    for (int c = 0; c < 3; ++c) {
+        if ( !(flags & columns[c]) ) {
+            continue;
+        }
+        size_t index = 0;
+        for (size_t i = 0; i < filesCountPerView.size(); ++i) {
+            long long value = 0;
+            for (size_t j = 0; j < filesCountPerView[i].second; ++j, ++index) {
+                long long delta;
+                if ( !reader.readSignedVarint(&delta) ) {
+                    return false;
+                }
+                value += delta;
+                if (!metadata) {
+                    continue;
+                }
+                if (columns[c] == eWireFlagSizes) {
+                    metadata->sizes[index] = (unsigned long long)value;
+                } else if (columns[c] == eWireFlagModificationTimes) {
+                    metadata->modificationTimes[index] = value;
+                } else {
+                    metadata->inodes[index] = (unsigned long long)value;
+                }
+            }
+        }
+    }
+
+    if ( sequence->empty() ) {
+        sequence->swap(files);
+    } else {
+        for (SequenceFromPattern::const_iterator it = files.begin(); it != files.end(); ++it) {
+            for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                insertFileInSequence(it->first, it2->first, it2->second, sequence);
+            }
+        }
+    }
+
+    return true;
+} // deserializeSequence
 
 bool
-SequenceFromFiles::empty() const
+deserializeSequenceFrames(const char* data,
+                          size_t size,
+                          string* pattern,
+                          std::map<int, FrameRanges>* viewsFrames)
 {
-    return _imp->filesMap.empty();
+    WireReader reader(data, size);
+    unsigned long long flags;
+    vector<pair<int, size_t> > filesCountPerView;
+
+    return readWireSequence(reader, pattern, &flags, &filesCountPerView, NULL, viewsFrames);
 }
 
-int
-SequenceFromFiles::count() const
+void
+serializeSequence(const SequenceFromFiles& sequence,
+                  string* data)
 {
-    return (int)_imp->filesMap.size();
+    SequenceFromPattern files;
+    const map<int, FileNameContent>& frames = sequence.getFrameIndexes();
+
+    for (map<int, FileNameContent>::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+        files[it->first].insert( make_pair( 0, it->second.absoluteFileName() ) );
+    }
+    serializeSequence(sequence.empty() ? string() : sequence.generateValidSequencePattern(), files, NULL, data);
 }
 
 bool
-SequenceFromFiles::isSingleFile() const
+deserializeSequence(const char* data,
+                    size_t size,
+                    SequenceFromFiles* sequence)
 {
-    return _imp->filesMap.size() == 1;
+    assert( sequence->empty() );
+    string pattern;
+    SequenceFromPattern files;
+    if ( !deserializeSequence(data, size, &pattern, &files) ) {
+        return false;
+    }
+    for (SequenceFromPattern::const_iterator it = files.begin(); it != files.end(); ++it) {
+        for (map<int, string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            sequence->tryInsertFile( FileNameContent(it2->second) );
+        }
+    }
+
+    return true;
 }
 
-int
-SequenceFromFiles::getFirstFrame() const
+#if __cplusplus >= 201703L
+struct FileManifestPrivate
 {
-    if ( _imp->filesMap.empty() ) {
-        return INT_MIN;
-    } else {
-        return _imp->filesMap.begin()->first;
+    ///The files of a directory, in the order of the manifest
+    struct Segment
+    {
+        std::string_view directory;
+        vector<std::string_view> files;
+    };
+
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+    vector<Segment> segments;
+    std::unordered_map<std::string_view, size_t> segmentsIndexes;
+
+    FileManifestPrivate()
+        : data(NULL)
+        , size(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE)
+        , mapping(NULL)
+#endif
+        , segments()
+        , segmentsIndexes()
+    {
+    }
+
+    bool mapFile(const string& filename)
+    {
+#ifdef _WIN32
+        ++gFilesOpened;
+        file = CreateFileW(utf8_to_utf16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        ++gFilesStatted;
+        if ( !GetFileSizeEx(file, &fileSize) ) {
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+        if (size == 0) {
+            ///an empty file cannot be mapped
+            return true;
+        }
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            return false;
+        }
+        data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        ++gFilesOpened;
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return false;
+        }
+        struct stat s;
+        ++gFilesStatted;
+        if (::fstat(fd, &s) != 0) {
+            ::close(fd);
+
+            return false;
+        }
+        size = (size_t)s.st_size;
+        if (size == 0) {
+            ///an empty file cannot be mapped
+            ::close(fd);
+
+            return true;
+        }
+        void* addr = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ///the mapping stays valid once the file is closed
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+        data = (const char*)addr;
+#endif
+
+        return data != NULL;
+    } // mapFile
+
+    void unmapFile()
+    {
+        segments.clear();
+        segmentsIndexes.clear();
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) {
+            ::munmap( (void*)data, size );
+        }
+#endif
+        data = NULL;
+        size = 0;
     }
+
+    ///Splits the mapping in lines, gathered by directory
+    void split()
+    {
+        size_t lastSegment = 0;
+        const char* it = data;
+        const char* end = data + size;
+
+        while (it < end) {
+            const char* lineEnd = (const char*)std::memchr(it, '\n', end - it);
+            if (!lineEnd) {
+                lineEnd = end;
+            }
+            std::string_view line( it, lineEnd - it );
+            it = lineEnd + 1;
+
+            if ( !line.empty() && (line.back() == '\r') ) {
+                line.remove_suffix(1);
+            }
+            if ( line.empty() ) {
+                continue;
+            }
+
+            ///Same separators as removePath
+            size_t pos = line.find_last_of('/');
+            if (pos == std::string_view::npos) {
+                pos = line.find_last_of('\\');
+            }
+            std::string_view directory = line.substr(0, pos == std::string_view::npos ? 0 : pos + 1);
+
+            ///Listings are usually sorted, so the file is most likely in the same directory as the previous one
+            if ( segments.empty() || (segments[lastSegment].directory != directory) ) {
+                std::unordered_map<std::string_view, size_t>::iterator found = segmentsIndexes.find(directory);
+                if ( found == segmentsIndexes.end() ) {
+                    found = segmentsIndexes.insert( std::make_pair( directory, segments.size() ) ).first;
+                    segments.push_back( Segment() );
+                    segments.back().directory = directory;
+                }
+                lastSegment = found->second;
+            }
+            segments[lastSegment].files.push_back(line);
+        }
+    } // split
+};
+
+FileManifest::FileManifest()
+    : _imp( new FileManifestPrivate() )
+{
 }
 
-int
-SequenceFromFiles::getLastFrame() const
+FileManifest::~FileManifest()
 {
-    if ( _imp->filesMap.empty() ) {
-        return INT_MAX;
-    } else {
-        map<int, FileNameContent>::const_iterator it = _imp->filesMap.end();
-        --it;
+    _imp->unmapFile();
+}
 
-        return it->first;
+bool
+FileManifest::open(const string& filename)
+{
+    _imp->unmapFile();
+    if ( !_imp->mapFile(filename) ) {
+        _imp->unmapFile();
+
+        return false;
     }
+    _imp->split();
+
+    return true;
 }
 
-const map<int, FileNameContent>&
-SequenceFromFiles::getFrameIndexes() const
+void
+FileManifest::close()
 {
-    return _imp->filesMap;
+    _imp->unmapFile();
 }
 
-unsigned long long
-SequenceFromFiles::getEstimatedTotalSize() const
+size_t
+FileManifest::getDirectoriesCount() const
 {
-    return _imp->totalSize;
+    return _imp->segments.size();
 }
 
-string
-SequenceFromFiles::generateValidSequencePattern() const
+std::string_view
+FileManifest::getDirectory(size_t index) const
 {
-    if ( empty() ) {
-        return "";
-    }
-    if ( isSingleFile() ) {
-        return _imp->filesMap.begin()->second.absoluteFileName();
-    }
-    assert(_imp->filesMap.size() >= 2);
-    string firstFramePattern;
-    _imp->filesMap.begin()->second.generatePatternWithFrameNumberAtIndex(_imp->frameNumberStringIndex,
-                                                                         _imp->minNumHashes,
-                                                                         &firstFramePattern);
+    assert( index < _imp->segments.size() );
 
-    return firstFramePattern;
+    return _imp->segments[index].directory;
 }
 
-string
-SequenceFromFiles::generateUserFriendlySequencePatternFromValidPattern(const string& validPattern) const
+const vector<std::string_view>&
+FileManifest::getFiles(size_t index) const
 {
-    assert( !isSingleFile() );
-    string pattern = validPattern;
-    vector< pair<int, int> > chunks;
-    //int first = getFirstFrame();
-    map<int, FileNameContent>::const_iterator first = _imp->filesMap.begin();
-    map<int, FileNameContent>::const_iterator cur = first;
-    map<int, FileNameContent>::const_iterator next = first;
-    if ( next != _imp->filesMap.end() ) {
-        ++next;
-    }
-    while ( first != _imp->filesMap.end() ) {
-        int breakCounter = 0;
-        while ( next != _imp->filesMap.end() && next->first == (cur->first + 1) ) {
-            if ( next != _imp->filesMap.end() ) {
-                ++next;
-            }
-            if ( cur != _imp->filesMap.end() ) {
-                ++cur;
-            }
-            ++breakCounter;
-        }
-        chunks.push_back( make_pair(first->first, cur->first) );
-        first = next;
-        if ( next != _imp->filesMap.end() ) {
-            ++next;
-        }
-        cur = first;
-    }
-
-    if (chunks.size() == 1) {
-        pattern += ' ';
-        pattern += stringFromInt(chunks[0].first);
-        pattern += '-';
-        pattern += stringFromInt(chunks[0].second);
-    } else {
-        pattern.append(" ( ");
-        for (size_t i = 0; i < chunks.size(); ++i) {
-            if (chunks[i].first != chunks[i].second) {
-                pattern += ' ';
-                pattern += stringFromInt(chunks[i].first);
-                pattern += '-';
-                pattern += stringFromInt(chunks[i].second);
-            } else {
-                pattern += ' ';
-                pattern += stringFromInt(chunks[i].first);
-            }
-            if (i < chunks.size() - 1) {
-                pattern.append(" /");
-            }
-        }
-        pattern.append(" ) ");
-    }
+    assert( index < _imp->segments.size() );
 
-    return pattern;
-} // SequenceFromFiles::generateUserFriendlySequencePatternFromValidPattern
+    return _imp->segments[index].files;
+}
 
-string
-SequenceFromFiles::generateUserFriendlySequencePattern() const
+int
+FileManifest::findDirectory(std::string_view path) const
 {
-    if ( isSingleFile() ) {
-        return _imp->filesMap.begin()->second.fileName();
-    }
-    string pattern = generateValidSequencePattern();
-    removePath(pattern);
+    std::unordered_map<std::string_view, size_t>::const_iterator found = _imp->segmentsIndexes.find(path);
 
-    return generateUserFriendlySequencePatternFromValidPattern(pattern);
+    return found == _imp->segmentsIndexes.end() ? -1 : (int)found->second;
 }
 
-string
-SequenceFromFiles::fileExtension() const
+bool
+filesListFromPattern_fast(const string& pattern,
+                          const FileManifest& manifest,
+                          SequenceViewFromPattern* sequence)
 {
-    if ( !empty() ) {
-        return _imp->filesMap.begin()->second.getExtension();
-    } else {
-        return string();
+    if ( pattern.empty() ) {
+        return false;
+    }
+    string patternUnPathed = pattern;
+    string patternPath = removePath(patternUnPathed);
+    string patternExtension = removeFileExtension(patternUnPathed);
+
+    int directoryIndex = manifest.findDirectory(patternPath);
+    if (directoryIndex == -1) {
+        return true;
+    }
+    const vector<std::string_view>& files = manifest.getFiles(directoryIndex);
+    for (size_t i = 0; i < files.size(); ++i) {
+        int frameNumber;
+        int viewNumber;
+        if ( matchesPattern_v2(files[i].data() + patternPath.size(), files[i].size() - patternPath.size(),
+                               patternUnPathed, patternExtension, &frameNumber, &viewNumber) ) {
+            ///The first file found for a frame and view is kept, as in insertFileInSequence
+            (*sequence)[frameNumber].insert( std::make_pair(viewNumber, files[i]) );
+        }
     }
+
+    return true;
 }
 
-string
-SequenceFromFiles::getPath() const
+void
+groupFilesIntoSequences(const FileManifest& manifest,
+                        const StringList& extensions,
+                        vector<SequenceFromFiles>* sequences,
+                        vector<MultiViewSequence>* multiViewSequences,
+                        bool enableSizeEstimation)
 {
-    if ( !empty() ) {
-        return _imp->filesMap.begin()->second.getPath();
-    } else {
-        return string();
+    StringList fileNames;
+
+    for (size_t i = 0; i < manifest.getDirectoriesCount(); ++i) {
+        const std::string_view directory = manifest.getDirectory(i);
+        const vector<std::string_view>& files = manifest.getFiles(i);
+
+        ///Only the names passing the extension filter are copied, one directory at a time
+        fileNames.clear();
+        for (size_t j = 0; j < files.size(); ++j) {
+            const char* name = files[j].data() + directory.size();
+            const size_t nameSize = files[j].size() - directory.size();
+            if ( extensions.empty() || hasExtensionInList(name, nameSize, extensions) ) {
+                fileNames.push_back( string(name, nameSize) );
+            }
+        }
+        if ( !fileNames.empty() ) {
+            const string path(directory);
+            groupFilesIntoSequencesInternal(&path, fileNames, StringList(), sequences, multiViewSequences, enableSizeEstimation);
+        }
     }
 }
+#endif // if __cplusplus >= 201703L
 } // namespace SequenceParsing
-
@@ -25,6 +25,15 @@
 #include <list>
 #include <string>
 #include <memory>
+#include <cstddef>
+#include <cctype>
+#include <iterator>
+#if __cplusplus >= 201103L
+#include <functional>
+#endif
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace SequenceParsing {
 
@@ -41,6 +50,7 @@ typedef std::vector<std::string> StringList;
  * @brief A class representing the content of a filename.
  * Initialize it passing it a real filename and it will initialize the data structures
  * depending on the filename content. This class is used by the file dialog to find sequences.
+ * With C++11, the const member functions may be called concurrently from several threads.
  **/
 struct FileNameContentPrivate;
 class FileNameContent
@@ -49,6 +59,14 @@ public:
 
     explicit FileNameContent(const std::string& absoluteFilename);
 
+    /**
+     * @brief Same as above, for a file of an already split directory listing.
+     * @param path The directory of the file, ending with a separator, e.g: "/Users/Lala/Pictures/"
+     * @param filename The file name, without any path
+     **/
+    FileNameContent(const std::string& path,
+                    const std::string& filename);
+
     FileNameContent(const FileNameContent& other);
 
     ~FileNameContent();
@@ -86,6 +104,10 @@ public:
      * This is because there may be several numbers existing in the filename, and we have
      * no clue given just this filename what actually corresponds to the frame number.
      * Nb: this pattern is not an absolute path.
+     * The pattern is cached for each numHashes: the returned reference remains valid until this object
+     * is assigned or destroyed. A cached pattern is returned without locking, only the first call for a
+     * given numHashes locks the object to generate it, so concurrent callers may share this object.
+     * A negative numHashes is the same as 0.
      **/
     const std::string& getFilePattern(int numHashes) const;
 
@@ -94,6 +116,13 @@ public:
      **/
     int getLeadingZeroes() const;
 
+    /**
+     * @brief Returns a hash of the text parts and of the count of numbers of the filename.
+     * Files that belong to the same sequence have the same signature, so it can be used to bucket files
+     * before calling matchesPattern, which rejects files with a different signature right away.
+     **/
+    unsigned long long getSignature() const;
+
     /**
      * @brief Expands the string returned by getFilePattern to a valid pattern.
      * In order to make it a valid pattern we remove all hash tags indexes and expand
@@ -141,6 +170,14 @@ private:
  **/
 std::string removePath(std::string& filename);
 
+#if __cplusplus >= 201703L
+/**
+ * @brief Same as removePath without modifying nor copying the file name: returns the path (with its trailing separator)
+ * and the name, as views on filename.
+ **/
+std::pair<std::string_view, std::string_view> splitPath(std::string_view filename);
+#endif
+
 
 ///map: < time, map < view_index, file name > >
 ///Explanation: for each frame number, there may be multiple views, each mapped to a filename.
@@ -181,12 +218,264 @@ typedef std::map<int, std::map<int, std::string> > SequenceFromPattern;
  **/
 bool filesListFromPattern_slow(const std::string& pattern, SequenceParsing::SequenceFromPattern* sequence);
 
+#if __cplusplus >= 201703L
+///Overloads of the functions taking a pattern for callers holding a view or a null-terminated string, which do not need
+///to build a std::string first.
+bool filesListFromPattern_slow(std::string_view pattern, SequenceParsing::SequenceFromPattern* sequence);
+bool filesListFromPattern_slow(const char* pattern, SequenceParsing::SequenceFromPattern* sequence);
+#endif
+
+/**
+ * @brief Info on the files of a sequence, stored as parallel arrays: the i-th element of each array
+ * describes the same file.
+ **/
+struct SequenceFilesMetadata
+{
+    std::vector<int> frames;
+    std::vector<int> views;
+    std::vector<unsigned long long> sizes; //< in bytes
+    std::vector<long long> modificationTimes; //< in nanoseconds since the epoch, the resolution depends on the platform
+    std::vector<unsigned long long> inodes; //< 0 if the platform has no inodes
+
+    void clear();
+
+    ///The number of files
+    std::size_t size() const;
+
+    ///Returns the median of the sizes, 0 if there is no file.
+    unsigned long long getMedianSize() const;
+
+    ///Appends to 'indexes' the index of the files smaller than 'ratio' times the median size,
+    ///e.g: 0.5 finds the files that are less than half the median size, which are likely truncated.
+    void getFilesSmallerThanMedian(double ratio, std::vector<std::size_t>* indexes) const;
+};
+
+/**
+ * @brief Same as filesListFromPattern_slow, but it also fills 'metadata' with the size, modification time and inode
+ * of each file of the sequence, in the same pass. Only files matching the pattern are stat'ed, on the directory file descriptor.
+ **/
+bool filesListFromPattern_slow(const std::string& pattern,
+                               SequenceParsing::SequenceFromPattern* sequence,
+                               SequenceFilesMetadata* metadata);
+
+/**
+ * @brief Same as filesListFromPattern_slow, except that the directories of the pattern may contain variables too,
+ * e.g: /renders/####/beauty.exr or /renders/%V/shot.####.exr. Directory names are matched with the same rules as file names,
+ * except that they have no extension: /renders/shot.####/beauty.exr accepts /renders/shot.0001/beauty.exr
+ * The frame number, and the view, must be the same in all the components where they appear:
+ * /renders/####/shot.####.exr accepts /renders/0001/shot.0001.exr but not /renders/0001/shot.0002.exr
+ * The candidate directories are enumerated level by level, the directories of a level being listed concurrently
+ * on the internal I/O thread pool (when compiled in C++11).
+ * @returns False if the pattern is empty or the directory before the first variable could not be opened.
+ **/
+bool filesListFromPattern_nested(const std::string& pattern,
+                                 SequenceParsing::SequenceFromPattern* sequence);
+
+/**
+ * @brief Counts of the file-system calls made by the library since the start of the process or the last call to
+ * resetIOStatistics(), to find out what dominates the cost of an operation on a given file-system, e.g:
+ *
+ * resetIOStatistics();
+ * filesListFromPattern_slow(pattern, &sequence);
+ * IOStatistics stats;
+ * getIOStatistics(&stats);
+ *
+ * The counts are global to the process. They are updated atomically when compiled in C++11.
+ * Every call reaching the file-system is counted, except the ones releasing or hinting about an already opened file:
+ * close, closedir, CloseHandle, posix_fadvise, and the mapping of an opened manifest (mmap, munmap and their Windows
+ * equivalents).
+ **/
+struct IOStatistics
+{
+    unsigned long long directoriesOpened; //< including the directories opened to rename files relatively to them
+    unsigned long long directoryEntriesRead;
+    unsigned long long filesStatted; //< stat, fstatat, fstat and their Windows equivalent
+    unsigned long long filesOpened; //< files opened for reading or writing, e.g: by the prefetcher, to map a manifest or to copy
+    unsigned long long filesRenamed; //< rename, renameat and MoveFileExW
+    unsigned long long filesRemoved; //< unlink and DeleteFileW
+    unsigned long long fileTimesSet; //< futimens, to preserve the modification time of copies
+    unsigned long long readCalls; //< read and ReadFile
+    unsigned long long writeCalls; //< write
+    unsigned long long copyCalls; //< copy_file_range and CopyFileW
+
+    IOStatistics();
+};
+
+void getIOStatistics(IOStatistics* statistics);
+
+void resetIOStatistics();
+
 /**
  * @brief Same as filesListFromPattern_slow except that it takes the pattern (without path) and a list of filenames in the same directory.
  * This avoids the tinydir bottleneck when reading from files over the network.
  **/
 bool filesListFromPattern_fast(const std::string& pattern, const StringList& files, SequenceParsing::SequenceFromPattern* sequence);
 
+#if __cplusplus >= 201703L
+bool filesListFromPattern_fast(std::string_view pattern, const StringList& files, SequenceParsing::SequenceFromPattern* sequence);
+bool filesListFromPattern_fast(const char* pattern, const StringList& files, SequenceParsing::SequenceFromPattern* sequence);
+#endif
+
+/**
+ * @brief Cheap tests on the names of the files of a directory, applied by the directory reader before the names are
+ * copied (and on POSIX systems before the entries of unknown type are stat'ed). The default filter accepts all the files.
+ **/
+struct DirectoryListingFilter
+{
+    ///If not empty, the extensions of the files to keep, without the dot. They are compared case-insensitively.
+    StringList extensions;
+
+    ///If not empty, the text the names must start with
+    std::string prefix;
+
+    ///Skips the names starting with a '.'
+    bool excludeHidden;
+
+    ///If not 0, the names must contain a run of at least this number of digits
+    int minDigitsCount;
+
+    DirectoryListingFilter();
+
+    bool accepts(const char* name, std::size_t size) const;
+};
+
+///Makes the filter accepting all the files that may match the pattern, as filesListFromPattern_slow does.
+void getDirectoryListingFilterFromPattern(const std::string& pattern, DirectoryListingFilter* filter);
+
+/**
+ * @brief A list of file names packed in a single buffer, with the offset and size of each name in separate arrays.
+ * Compared to a StringList it costs one allocation for the whole list instead of one per name,
+ * and matching it reads memory sequentially.
+ **/
+class FileTable
+{
+public:
+
+    FileTable();
+
+    void clear();
+
+    ///Preallocates memory for the given number of names, totalling the given number of characters
+    void reserve(std::size_t namesCount, std::size_t charactersCount);
+
+    void append(const char* name, std::size_t size);
+
+    void append(const std::string& name);
+
+    /**
+     * @brief Appends the names of the files of the directory, without their path. Directories are skipped, like
+     * filesListFromPattern_slow does. On POSIX systems the names are copied straight from the directory entries.
+     * @returns False if the directory could not be opened.
+     **/
+    bool appendDirectory(const std::string& path);
+
+    ///Same as above, for the files accepted by the filter only.
+    bool appendDirectory(const std::string& path, const DirectoryListingFilter& filter);
+
+    ///The number of names
+    std::size_t size() const;
+
+    bool empty() const;
+
+    ///The name is not null-terminated
+    const char* getName(std::size_t index) const;
+
+    std::size_t getNameSize(std::size_t index) const;
+
+    std::string getNameString(std::size_t index) const;
+
+private:
+    std::string _buffer;
+    std::vector<std::size_t> _offsets;
+    std::vector<std::size_t> _sizes;
+};
+
+/**
+ * @brief Same as filesListFromPattern_fast for a FileTable. Before running the full matcher on a name,
+ * a cheap filter rejects the names that are too short or do not start and end with the literal text
+ * surrounding the variables of the pattern, e.g: "shot_" and ".exr" for shot_####.exr.
+ **/
+bool filesListFromPattern_fast(const std::string& pattern, const FileTable& files, SequenceParsing::SequenceFromPattern* sequence);
+
+#if __cplusplus >= 201703L
+bool filesListFromPattern_fast(std::string_view pattern, const FileTable& files, SequenceParsing::SequenceFromPattern* sequence);
+bool filesListFromPattern_fast(const char* pattern, const FileTable& files, SequenceParsing::SequenceFromPattern* sequence);
+#endif
+
+/**
+ * @brief Same as above, but the files are matched by chunks on an internal thread pool. The result is exactly the
+ * one of the serial version: when several files have the same frame and view, the first one in the list is kept.
+ * @param threadsCount The maximum number of chunks matched concurrently, 0 to use as many as the hardware supports.
+ * Small lists are matched on the calling thread, and so is every list when not compiled in C++11.
+ **/
+bool filesListFromPattern_fast(const std::string& pattern,
+                               const StringList& files,
+                               SequenceParsing::SequenceFromPattern* sequence,
+                               int threadsCount);
+
+#if __cplusplus >= 201103L
+/**
+ * @brief A handle on a directory scan running in the background, @see filesListFromPattern_async.
+ * Copies of a handle share the same scan. The scan keeps running if all handles are destroyed,
+ * use cancel() to stop it.
+ **/
+struct AsyncScanPrivate;
+class AsyncScanHandle
+{
+public:
+
+    enum Status
+    {
+        eStatusRunning = 0, //< the directory is still being read
+        eStatusFinished, //< the whole directory was read
+        eStatusCancelled, //< cancel() was called before the end of the scan
+        eStatusTimedOut, //< the deadline expired before the end of the scan
+        eStatusFailed //< the pattern is empty or its directory could not be opened
+    };
+
+    AsyncScanHandle();
+
+    explicit AsyncScanHandle(const std::shared_ptr<AsyncScanPrivate>& imp);
+
+    ///Stops the scan as soon as possible. The files found so far are kept in the result.
+    ///This does nothing if the scan is already done.
+    void cancel();
+
+    ///Returns the status of the scan, without blocking
+    Status getStatus() const;
+
+    ///Blocks until the scan is done or its deadline expired and returns its status
+    Status wait() const;
+
+    ///Blocks at most the given amount of time and returns true if the scan is done
+    bool waitFor(int milliseconds) const;
+
+    ///Returns the files found by the scan: all of them if finished, the ones found so far otherwise.
+    SequenceFromPattern getResult() const;
+
+private:
+    std::shared_ptr<AsyncScanPrivate> _imp;
+};
+
+///Called once when a scan is done, from the thread that ended it, with the same values as getStatus() and getResult().
+typedef std::function<void (AsyncScanHandle::Status status, const SequenceFromPattern& sequence)> AsyncScanCallback;
+
+/**
+ * @brief Same as filesListFromPattern_slow except that the directory is read on an internal thread pool
+ * and that this function returns immediately. Like FileTable::appendDirectory, the directory entries are not stat'ed
+ * unless the file-system does not give their type.
+ * The pool has a few threads used by no other function: a scan stalled by the file-system
+ * holds one of them until the system call returns, even once the scan is ended, and the next scans are queued meanwhile.
+ * @param timeoutMilliseconds If positive, the scan is ended with eStatusTimedOut after this delay. Waiters are
+ * released at the deadline even if the file-system is stalled, the files found until then are kept in the result.
+ * @param callback If set, it is called once the scan is done, whatever the reason. On timeout it is called at the
+ * deadline from an internal timer thread shared by all scans, so it should return quickly.
+ **/
+AsyncScanHandle filesListFromPattern_async(const std::string& pattern,
+                                           int timeoutMilliseconds = -1,
+                                           const AsyncScanCallback& callback = AsyncScanCallback());
+#endif // __cplusplus >= 201103L
+
 /**
  * @brief Transforms a sequence parsed from a pattern to a absolute file names list. If
  * onlyViewIndex is greater or equal to 0 it will append to the string list only file names
@@ -196,6 +485,84 @@ bool filesListFromPattern_fast(const std::string& pattern, const StringList& fil
 StringList sequenceFromPatternToFilesList(const SequenceParsing::SequenceFromPattern& sequence,
                                           int onlyViewIndex = -1);
 
+/**
+ * @brief Iterates over the absolute file names of a sequence without copying them, in the same order as
+ * sequenceFromPatternToFilesList, e.g:
+ *
+ * SequenceFilesRange range(sequence, 0, 1, 100);
+ * for (SequenceFilesRange::const_iterator it = range.begin(); it != range.end(); ++it) {
+ *     play(*it, it.getFrame());
+ * }
+ *
+ * The range references the sequence which must outlive it and not be modified while iterating.
+ **/
+class SequenceFilesRange
+{
+public:
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::string value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string* pointer;
+        typedef const std::string& reference;
+
+        const_iterator();
+
+        const_iterator(SequenceFromPattern::const_iterator frameIt,
+                       SequenceFromPattern::const_iterator framesEnd,
+                       int onlyViewIndex);
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        const_iterator& operator++();
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+        int getFrame() const;
+
+        int getView() const;
+
+    private:
+        ///Moves to the first file accepted by the view filter, starting at the current one
+        void skipFilteredViews();
+
+        SequenceFromPattern::const_iterator _frameIt;
+        SequenceFromPattern::const_iterator _framesEnd;
+        std::map<int, std::string>::const_iterator _viewIt;
+        int _onlyViewIndex;
+    };
+
+    /**
+     * @param onlyViewIndex Same as for sequenceFromPatternToFilesList: if not -1, only the files of this view
+     * and of the view -1 are iterated.
+     **/
+    explicit SequenceFilesRange(const SequenceFromPattern& sequence,
+                                int onlyViewIndex = -1);
+
+    ///Same as above, only for frames in [firstFrame, lastFrame].
+    SequenceFilesRange(const SequenceFromPattern& sequence,
+                       int onlyViewIndex,
+                       int firstFrame,
+                       int lastFrame);
+
+    const_iterator begin() const;
+
+    const_iterator end() const;
+
+    bool empty() const;
+
+private:
+    SequenceFromPattern::const_iterator _framesBegin;
+    SequenceFromPattern::const_iterator _framesEnd;
+    int _onlyViewIndex;
+};
+
 /**
  * @brief Generates a filename out of a pattern
  * @see filesListFromPattern
@@ -205,10 +572,508 @@ std::string generateFileNameFromPattern(const std::string& pattern,
                                         int frameNumber,
                                         int viewNumber);
 
+#if __cplusplus >= 201703L
+std::string generateFileNameFromPattern(std::string_view pattern,
+                                        const std::vector<std::string>& viewNames,
+                                        int frameNumber,
+                                        int viewNumber);
+std::string generateFileNameFromPattern(const char* pattern,
+                                        const std::vector<std::string>& viewNames,
+                                        int frameNumber,
+                                        int viewNumber);
+#endif
+
+///A file to rename, @see SequenceRenamePlan
+struct FileRename
+{
+    std::string from;
+    std::string to;
+};
+
+/**
+ * @brief The renames moving the files of a sequence to new names, ordered so that no file is overwritten.
+ * They are executed in 3 steps, the renames within a step being independent of each other:
+ * - toTemporary: files moved out of the way to a temporary name, to break cycles (e.g: swapping 2 frames)
+ * and long chains (e.g: renumbering 1-240 to 2-241, where each frame takes the name of the next one).
+ * - chains: each chain is a list of renames to execute in order, the first one being to a free name.
+ * Chains can be executed concurrently.
+ * - fromTemporary: the files of toTemporary (in the same order) moved to their final name.
+ **/
+struct SequenceRenamePlan
+{
+    std::vector<FileRename> toTemporary;
+    std::vector<std::vector<FileRename> > chains;
+    std::vector<FileRename> fromTemporary;
+
+    void clear();
+
+    std::size_t getRenamesCount() const;
+
+    ///Lists the renames in an order in which they can be executed one after the other.
+    void getRenamesInOrder(std::vector<FileRename>* renames) const;
+
+    ///The renames in order, one "from -> to" per line, e.g: for a dry run.
+    std::string toString() const;
+};
+
+/**
+ * @brief Plans the renames of the files of a sequence (e.g: obtained with filesListFromPattern_slow) to the
+ * names generated by newPattern (which may be the pattern of the sequence), with frameOffset added to the frame numbers.
+ * The views keep their index, viewNames are used to generate the names like in generateFileNameFromPattern.
+ * Files which already have their new name are not renamed.
+ * @returns False if two files would get the same name or if a new name is taken by a file which is not renamed
+ * (including files that are not part of the sequence) or is in a directory that cannot be listed.
+ **/
+bool planSequenceRename(const SequenceFromPattern& sequence,
+                        const std::string& newPattern,
+                        const std::vector<std::string>& viewNames,
+                        int frameOffset,
+                        SequenceRenamePlan* plan);
+
+///Same as above with the new frame number of each frame. The frames not in frameMapping keep their number.
+bool planSequenceRename(const SequenceFromPattern& sequence,
+                        const std::string& newPattern,
+                        const std::vector<std::string>& viewNames,
+                        const std::map<int, int>& frameMapping,
+                        SequenceRenamePlan* plan);
+
+/**
+ * @brief Executes the renames of the plan, with renameat relative to the directories of the files (opened once)
+ * on POSIX systems. The chains and the renames of the temporary files are spread over threadsCount threads
+ * (only in C++11, the renames are serial otherwise).
+ * The plan must be executed before the files are modified by anyone else.
+ * @param failedRenames If not NULL, the renames that failed or were not attempted because of a previous failure,
+ * in which case some files may be left with their temporary name.
+ * @returns True if all the renames succeeded.
+ **/
+bool executeSequenceRename(const SequenceRenamePlan& plan,
+                           int threadsCount = 4,
+                           std::vector<FileRename>* failedRenames = 0);
+
+#if __cplusplus >= 201402L
+/**
+ * @brief A pattern parsed at compile-time, for naming conventions that are known when compiling.
+ * It matches file names exactly like filesListFromPattern_fast and generates them exactly like
+ * generateFileNameFromPattern, but the pattern is not parsed again at each call: the literal parts,
+ * their lengths and the padding of the variables are constants the compiler can inline.
+ * Declare it with SEQUENCEPARSING_STATIC_PATTERN so that an invalid pattern fails to compile:
+ *
+ * SEQUENCEPARSING_STATIC_PATTERN(kBeautyPattern, "/renders/shot_beauty.####.exr");
+ * int frame, view;
+ * if ( kBeautyPattern.matches("shot_beauty.0001.exr", &frame, &view) ) ...
+ *
+ * Compared to the patterns accepted at run-time, variables are not allowed in the path nor in the extension,
+ * and the '%' character may only introduce a %d, %0<digitsCount>d, %v or %V variable.
+ **/
+template <std::size_t N> // N is the size of the pattern string literal, including the terminating null character
+class StaticPattern
+{
+public:
+
+    enum ElementType
+    {
+        eElementText = 0,
+        eElementFrameNumber,
+        eElementShortView,
+        eElementLongView
+    };
+
+    struct Element
+    {
+        ElementType type = eElementText;
+        std::size_t begin = 0; //< position of the element in the pattern
+        std::size_t size = 0; //< number of characters of the element in the pattern
+        int digitsCount = 0; //< for frame numbers, the minimum number of digits
+    };
+
+    constexpr explicit StaticPattern(const char (&pattern)[N])
+        : _pattern()
+        , _elements()
+        , _elementsCount(0)
+        , _pathSize(0)
+        , _bodyEnd(N - 1)
+        , _extensionBegin(N - 1)
+        , _valid(true)
+    {
+        const std::size_t size = N - 1;
+
+        for (std::size_t i = 0; i < N; ++i) {
+            _pattern[i] = pattern[i];
+        }
+
+        ///Same separators as removePath: the last '/', or the last '\' if there is none
+        for (std::size_t i = 0; i < size; ++i) {
+            if (pattern[i] == '/') {
+                _pathSize = i + 1;
+            }
+        }
+        if (_pathSize == 0) {
+            for (std::size_t i = 0; i < size; ++i) {
+                if (pattern[i] == '\\') {
+                    _pathSize = i + 1;
+                }
+            }
+        }
+        for (std::size_t i = _pathSize; i < size; ++i) {
+            if (pattern[i] == '.') {
+                _bodyEnd = i;
+                _extensionBegin = i + 1;
+            }
+        }
+        for (std::size_t i = 0; i < size; ++i) {
+            if ( ( (i < _pathSize) || (i >= _bodyEnd) ) && ( (pattern[i] == '#') || (pattern[i] == '%') ) ) {
+                _valid = false;
+            }
+        }
+
+        std::size_t i = _pathSize;
+        while (_valid && i < _bodyEnd) {
+            if (pattern[i] == '#') {
+                std::size_t end = i;
+                while (end < _bodyEnd && pattern[end] == '#') {
+                    ++end;
+                }
+                addElement(eElementFrameNumber, i, end - i, (int)(end - i));
+                i = end;
+            } else if (pattern[i] == '%') {
+                std::size_t end = i + 1;
+                int digitsCount = 0;
+                while ( end < _bodyEnd && isDigit(pattern[end]) ) {
+                    digitsCount = digitsCount * 10 + (pattern[end] - '0');
+                    ++end;
+                }
+                if ( (end < _bodyEnd) && (pattern[end] == 'd') && ( (end == i + 1) || (pattern[i + 1] == '0') ) ) {
+                    addElement(eElementFrameNumber, i, end + 1 - i, digitsCount);
+                    i = end + 1;
+                } else if ( (end == i + 1) && (end < _bodyEnd) && ( (pattern[end] == 'v') || (pattern[end] == 'V') ) ) {
+                    addElement(pattern[end] == 'v' ? eElementShortView : eElementLongView, i, 2, 0);
+                    i = end + 1;
+                } else {
+                    _valid = false;
+                }
+            } else {
+                if ( (_elementsCount > 0) && (_elements[_elementsCount - 1].type == eElementText) ) {
+                    ++_elements[_elementsCount - 1].size;
+                } else {
+                    addElement(eElementText, i, 1, 0);
+                }
+                ++i;
+            }
+        }
+    }
+
+    constexpr bool isValid() const
+    {
+        return _valid;
+    }
+
+    ///The number of variables and text parts of the file name
+    constexpr std::size_t getElementsCount() const
+    {
+        return _elementsCount;
+    }
+
+    constexpr const Element& getElement(std::size_t index) const
+    {
+        return _elements[index];
+    }
+
+    /**
+     * @brief Returns true if the file name (without path) matches the pattern, in which case frameNumber and viewNumber
+     * are set like filesListFromPattern_fast would.
+     **/
+    constexpr bool matches(const char* filename,
+                           std::size_t size,
+                           int* frameNumber,
+                           int* viewNumber) const
+    {
+        bool wasFrameNumberSet = false;
+        bool wasViewNumberSet = false;
+
+        *viewNumber = 0;
+        *frameNumber = -1;
+        if (!_valid) {
+            return false;
+        }
+
+        ///The extensions must be identical
+        std::size_t bodySize = size;
+        for (std::size_t i = 0; i < size; ++i) {
+            if (filename[i] == '.') {
+                bodySize = i;
+            }
+        }
+        const std::size_t extensionBegin = bodySize < size ? bodySize + 1 : size;
+        if ( (size - extensionBegin) != (N - 1 - _extensionBegin) ) {
+            return false;
+        }
+        for (std::size_t i = 0; i < size - extensionBegin; ++i) {
+            if (filename[extensionBegin + i] != _pattern[_extensionBegin + i]) {
+                return false;
+            }
+        }
+
+        std::size_t filenameIt = 0;
+        std::size_t elementIt = 0;
+        while (filenameIt < bodySize && elementIt < _elementsCount) {
+            const Element& e = _elements[elementIt];
+            if (e.type == eElementText) {
+                if (bodySize - filenameIt < e.size) {
+                    return false;
+                }
+                for (std::size_t i = 0; i < e.size; ++i) {
+                    if (filename[filenameIt + i] != _pattern[e.begin + i]) {
+                        return false;
+                    }
+                }
+                filenameIt += e.size;
+            } else if (e.type == eElementFrameNumber) {
+                std::size_t end = filenameIt;
+                unsigned int number = 0;
+                while ( end < bodySize && isDigit(filename[end]) ) {
+                    number = number * 10 + (unsigned int)(filename[end] - '0');
+                    ++end;
+                }
+                ///Same rules as the hashes: more digits are only allowed without leading zeroes
+                const std::size_t digitsCount = end - filenameIt;
+                if ( (digitsCount < (std::size_t)e.digitsCount) ||
+                     ( (digitsCount > (std::size_t)e.digitsCount) && (filename[filenameIt] == '0') ) ) {
+                    return false;
+                }
+                if ( wasFrameNumberSet && ( (int)number != *frameNumber ) ) {
+                    return false;
+                }
+                wasFrameNumberSet = true;
+                *frameNumber = (int)number;
+                filenameIt = end;
+            } else {
+                int view = -1;
+                std::size_t end = filenameIt;
+                if ( (e.type == eElementShortView) && (filename[filenameIt] == 'r') ) {
+                    view = 1;
+                    end = filenameIt + 1;
+                } else if ( (e.type == eElementShortView) && (filename[filenameIt] == 'l') ) {
+                    view = 0;
+                    end = filenameIt + 1;
+                } else if ( (e.type == eElementLongView) && startsWith(filename, filenameIt, bodySize, "right", 5) ) {
+                    view = 1;
+                    end = filenameIt + 5;
+                } else if ( (e.type == eElementLongView) && startsWith(filename, filenameIt, bodySize, "left", 4) ) {
+                    view = 0;
+                    end = filenameIt + 4;
+                } else if ( startsWith(filename, filenameIt, bodySize, "view", 4) ) {
+                    end = filenameIt + 4;
+                    unsigned int number = 0;
+                    while ( end < bodySize && isDigit(filename[end]) ) {
+                        number = number * 10 + (unsigned int)(filename[end] - '0');
+                        ++end;
+                    }
+                    if (end == filenameIt + 4) {
+                        return false;
+                    }
+                    view = (int)number;
+                } else {
+                    return false;
+                }
+                if ( wasViewNumberSet && (view != *viewNumber) ) {
+                    return false;
+                }
+                wasViewNumberSet = true;
+                *viewNumber = view;
+                filenameIt = end;
+            }
+            ++elementIt;
+        }
+
+        return filenameIt >= bodySize && elementIt >= _elementsCount;
+    } // matches
+
+    bool matches(const std::string& filename,
+                 int* frameNumber,
+                 int* viewNumber) const
+    {
+        return matches(filename.data(), filename.size(), frameNumber, viewNumber);
+    }
+
+    /**
+     * @brief Same as generateFileNameFromPattern called with this pattern.
+     **/
+    std::string generateFileName(const std::vector<std::string>& viewNames,
+                                 int frameNumber,
+                                 int viewNumber) const
+    {
+        std::string ret(_pattern, _pathSize);
+
+        for (std::size_t i = 0; i < _elementsCount; ++i) {
+            const Element& e = _elements[i];
+            switch (e.type) {
+            case eElementText:
+                ret.append(_pattern + e.begin, e.size);
+                break;
+            case eElementFrameNumber: {
+                std::string frameNumberStr = std::to_string(frameNumber);
+                if ( (int)frameNumberStr.size() < e.digitsCount ) {
+                    ret.append(e.digitsCount - frameNumberStr.size(), '0');
+                }
+                ret.append(frameNumberStr);
+                break;
+            }
+            case eElementShortView:
+                if ( (viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
+                    ret.push_back( (char)std::toupper(viewNames[viewNumber][0]) );
+                }
+                break;
+            case eElementLongView:
+                if ( (viewNumber >= 0) && ( viewNumber < (int)viewNames.size() ) ) {
+                    ret.append(viewNames[viewNumber]);
+                } else {
+                    ret.append("%V");
+                }
+                break;
+            }
+        }
+        if (_bodyEnd < N - 1) {
+            ret.append(_pattern + _bodyEnd, N - 1 - _bodyEnd);
+        }
+
+        return ret;
+    }
+
+private:
+
+    static constexpr bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static constexpr bool startsWith(const char* str,
+                                     std::size_t pos,
+                                     std::size_t size,
+                                     const char* prefix,
+                                     std::size_t prefixSize)
+    {
+        if (size - pos < prefixSize) {
+            return false;
+        }
+        for (std::size_t i = 0; i < prefixSize; ++i) {
+            if (str[pos + i] != prefix[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    constexpr void addElement(ElementType type,
+                              std::size_t begin,
+                              std::size_t size,
+                              int digitsCount)
+    {
+        _elements[_elementsCount].type = type;
+        _elements[_elementsCount].begin = begin;
+        _elements[_elementsCount].size = size;
+        _elements[_elementsCount].digitsCount = digitsCount;
+        ++_elementsCount;
+    }
+
+    char _pattern[N];
+    Element _elements[N];
+    std::size_t _elementsCount;
+    std::size_t _pathSize; //< the path with its trailing separator
+    std::size_t _bodyEnd; //< position of the extension '.', or N - 1 without extension
+    std::size_t _extensionBegin;
+    bool _valid;
+};
+
+///Declares a constexpr StaticPattern called 'name' and checks its validity at compile-time.
+#define SEQUENCEPARSING_STATIC_PATTERN(name, pattern) \
+    constexpr ::SequenceParsing::StaticPattern<sizeof(pattern)> name(pattern); \
+    static_assert(name.isValid(), "Invalid static pattern: " pattern)
+#endif // __cplusplus >= 201402L
+
+///Inclusive frame ranges, sorted and disjoint, e.g: [1,10] [15,15] [20,30]
+typedef std::vector<std::pair<int, int> > FrameRanges;
+
+///What the file-system reported about a file
+struct FileInfo
+{
+    unsigned long long size; //< in bytes
+    long long modificationTime; //< in nanoseconds since the epoch, the resolution depends on the platform
+
+    FileInfo()
+        : size(0)
+        , modificationTime(0)
+    {
+    }
+
+    bool operator==(const FileInfo& other) const
+    {
+        return size == other.size && modificationTime == other.modificationTime;
+    }
+
+    bool operator!=(const FileInfo& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief The content of a sequence at the time it was scanned, with the frames of each view
+ * stored as ranges so that it can be kept and compared cheaply.
+ **/
+struct SequenceSnapshot
+{
+    ///For each view index, the frames that exist
+    std::map<int, FrameRanges> viewsFrames;
+
+    ///For each view index, the info of the file of each frame. Empty if they were not collected.
+    std::map<int, std::map<int, FileInfo> > viewsFileInfos;
+};
+
+/**
+ * @brief Makes a snapshot of the sequence.
+ * @param collectFileInfos If true, the size and modification time of each file is read from the file-system.
+ * Files that cannot be read are left without info.
+ **/
+void makeSequenceSnapshot(const SequenceFromPattern& sequence, bool collectFileInfos, SequenceSnapshot* snapshot);
+
+///Same as above, with the files info collected by filesListFromPattern_slow.
+void makeSequenceSnapshot(const SequenceFromPattern& sequence, const SequenceFilesMetadata& metadata, SequenceSnapshot* snapshot);
+
+///The differences of a view between 2 snapshots
+struct SequenceSnapshotViewDiff
+{
+    FrameRanges added; //< frames only in the new snapshot
+    FrameRanges removed; //< frames only in the old snapshot
+    FrameRanges changed; //< frames in both snapshots whose file info differ. Only filled if both snapshots have the info.
+};
+
+/**
+ * @brief Computes the differences between 2 snapshots of the same sequence, for each view index.
+ * Views without differences are not present in the result.
+ * Added and removed frames are computed in a time proportional to the number of ranges, changed frames
+ * in a time proportional to the number of frames having info.
+ **/
+void diffSequenceSnapshots(const SequenceSnapshot& oldSnapshot,
+                           const SequenceSnapshot& newSnapshot,
+                           std::map<int, SequenceSnapshotViewDiff>* diff);
+
+/**
+ * @brief Returns a 64-bit hash of the pattern and of the frames of each view of the snapshot, and of the files info if
+ * they were collected. It is stable across runs and platforms so it can be stored to know if a sequence changed.
+ * It is computed from the frame ranges, not from the file names.
+ **/
+unsigned long long computeSequenceFingerprint(const std::string& pattern, const SequenceSnapshot& snapshot);
+
+///Same as above, without files info.
+unsigned long long computeSequenceFingerprint(const std::string& pattern, const SequenceFromPattern& sequence);
+
 /**
  * @struct Used to gather file together that seem to belong to the same sequence.
  * This is used for example in the sequence dialog. It aims to produce a pattern
  * out of a series of file.
+ * With C++11, the const member functions may be called concurrently from several threads, as long as
+ * no file is inserted meanwhile.
  **/
 struct SequenceFromFilesPrivate;
 class SequenceFromFiles
@@ -237,8 +1102,13 @@ public:
     bool tryInsertFile(const FileNameContent& file, bool checkPath = true);
 
     ///Returns true if this sequence contains the given file.
+    ///The lookup is made in an index of the file names built on the first call and kept up to date by the insertions.
     bool contains(const std::string& absoluteFileName) const;
 
+    ///Same as above for several files at once: 'ret' is resized to the number of files and each element tells
+    ///if the file at the same index is in the sequence.
+    void contains(const StringList& absoluteFileNames, std::vector<bool>* ret) const;
+
     ///is the sequence empty ?
     bool empty() const;
 
@@ -263,10 +1133,19 @@ public:
     ///all the frame indexes. Empty if this is not a sequence.
     const std::map<int, FileNameContent>& getFrameIndexes() const;
 
+    ///Returns the file of the given frame, or NULL if the frame is not in the sequence.
+    const FileNameContent* getFileForFrame(int frameNumber) const;
+
     ///Returns the total cumulated size of all files in the sequence.
     ///If enableSizeEstimation is false, it will return 0.
     unsigned long long getEstimatedTotalSize() const;
 
+    ///Returns the fingerprint of this sequence, @see computeSequenceFingerprint.
+    ///It is the same as the fingerprint of a snapshot of the files found by generateValidSequencePattern(),
+    ///with files info if enableSizeEstimation is true.
+    ///The frames and files info are accumulated when files are inserted.
+    unsigned long long getFingerprint() const;
+
     ///Generates a pattern from this sequence.
     ///Normally calling filesListFromPattern on the result of this function
     ///should find the exact same files as getFilesList() would return.
@@ -282,6 +1161,363 @@ public:
 private:
     auto_ptr<SequenceFromFilesPrivate> _imp; // PImpl
 };
+
+/**
+ * @brief A sequence whose files differ by a view name, e.g: shot_l.####.exr and shot_r.####.exr
+ * gathered under the single pattern shot_%v.####.exr.
+ **/
+struct MultiViewSequence
+{
+    ///The absolute pattern, with a %v variable if the views were named 'l'/'r' or
+    ///a %V variable if they were named 'left'/'right'. 'viewN' names are accepted by both.
+    std::string pattern;
+
+    ///The files of the sequence, exactly as filesListFromPattern_slow would find them with 'pattern'.
+    SequenceFromPattern sequence;
+};
+
+/**
+ * @brief Groups the given absolute file names into sequences, the same way the file dialog does when calling
+ * SequenceFromFiles::tryInsertFile on each file.
+ * @param multiViewSequences If not NULL, sequences whose pattern only differ by a view name (the same names
+ * as the ones recognized by the %v and %V variables, @see filesListFromPattern_slow) are merged into a single
+ * multi-view sequence which is appended to this list instead of 'sequences'. At least 2 different views
+ * must be found for sequences to be merged.
+ * No other file-system access than the optional size estimation is made.
+ **/
+void groupFilesIntoSequences(const StringList& absoluteFileNames,
+                             std::vector<SequenceFromFiles>* sequences,
+                             std::vector<MultiViewSequence>* multiViewSequences = 0,
+                             bool enableSizeEstimation = false);
+
+/**
+ * @brief Same as above for the files of a single directory listing.
+ * @param path The directory containing the files, ending with a separator.
+ * @param fileNames The file names, without any path.
+ * @param extensions If not empty, only the files with one of these extensions (without the dot, case-sensitive)
+ * are grouped. The others are rejected before any processing.
+ **/
+void groupFilesIntoSequences(const std::string& path,
+                             const StringList& fileNames,
+                             const StringList& extensions,
+                             std::vector<SequenceFromFiles>* sequences,
+                             std::vector<MultiViewSequence>* multiViewSequences = 0,
+                             bool enableSizeEstimation = false);
+
+///The total size of the files of a sequence, estimated from the sizes of some of its files
+struct SequenceSizeEstimate
+{
+    unsigned long long estimatedSize; //< in bytes, the mean size of the files sized times the number of files
+    unsigned long long lowerBound; //< the bounds of the confidence interval of the estimate, the upper bound is
+    unsigned long long upperBound; //< the maximum value while less than 2 sizes are known
+    std::size_t filesCount; //< the number of files of the sequence
+    std::size_t sizedFilesCount; //< the number of files whose size was read (or that could not be read)
+    bool exact; //< true if all the files were sized, the bounds are then equal to the estimate
+
+    SequenceSizeEstimate();
+};
+
+/**
+ * @brief Estimates the total size of the files of a sequence by reading the size of samplesCount files only, spread
+ * across the sequence. The confidence interval accounts for the fraction of the files sampled (finite population
+ * correction): it is exact when all the files are sampled.
+ * This is much cheaper than enabling the size estimation of SequenceFromFiles, which sizes every file.
+ * @param confidence The probability that the total size is in the interval, e.g: 0.95.
+ **/
+void estimateSequenceSize(const SequenceFromPattern& sequence,
+                          std::size_t samplesCount,
+                          SequenceSizeEstimate* estimate,
+                          double confidence = 0.95);
+
+void estimateSequenceSize(const SequenceFromFiles& sequence,
+                          std::size_t samplesCount,
+                          SequenceSizeEstimate* estimate,
+                          double confidence = 0.95);
+
+#if __cplusplus >= 201103L
+///Called with each sequence found by a SequenceStreamGrouper
+typedef std::function<void (const SequenceFromFiles& sequence)> SequenceGroupedCallback;
+
+/**
+ * @brief Groups files into sequences like groupFilesIntoSequences (without the multi-view merging), for file names
+ * given in increasing order (e.g: sorted with std::sort). Each sequence is passed to the callback as soon as a file
+ * name shows that no later one can extend it, i.e: when a name no longer starts with the text preceding the frame
+ * number of the sequence. Only these open sequences are kept in memory, not all the files of the listing.
+ * If the names are not sorted, the files of a sequence may be split in several sequences.
+ **/
+struct SequenceStreamGrouperPrivate;
+class SequenceStreamGrouper
+{
+public:
+
+    explicit SequenceStreamGrouper(const SequenceGroupedCallback& callback,
+                                   bool enableSizeEstimation = false);
+
+    ///The sequences still open are dropped, call finish() to get them.
+    ~SequenceStreamGrouper();
+
+    void addFile(const std::string& absoluteFileName);
+
+    ///Same as above for a file of a directory listing, the path must end with a separator.
+    void addFile(const std::string& path, const std::string& filename);
+
+    ///Passes all the open sequences to the callback, in the order they were started.
+    void finish();
+
+    std::size_t getOpenSequencesCount() const;
+
+private:
+    SequenceStreamGrouper(const SequenceStreamGrouper& other);
+    void operator=(const SequenceStreamGrouper& other);
+
+    auto_ptr<SequenceStreamGrouperPrivate> _imp; // PImpl
+};
+
+/**
+ * @brief Warms up the cache of the files a player is about to read. Each time the player moves to a frame, the files
+ * of all the views of the next frames of the sequence (in the playback direction) are requested on a small pool of
+ * threads owned by the prefetcher. Requests that are not started yet are dropped when the player seeks.
+ * The sequence is referenced: it must outlive the prefetcher and not be modified while it is used.
+ **/
+struct SequencePrefetcherPrivate;
+class SequencePrefetcher
+{
+public:
+
+    enum PrefetchModeEnum
+    {
+        ///Asks the kernel to read the file in the background with posix_fadvise(POSIX_FADV_WILLNEED).
+        ///Falls back to eModeRead where it is not available.
+        eModeAdvise = 0,
+
+        ///Reads the whole file and discards the data, which works with any file-system and cache.
+        eModeRead
+    };
+
+    /**
+     * @param windowSize The number of frames to prefetch ahead of the current one.
+     * @param threadsCount The number of threads reading files.
+     **/
+    explicit SequencePrefetcher(const SequenceFromPattern& sequence,
+                                int windowSize = 8,
+                                int threadsCount = 2,
+                                PrefetchModeEnum mode = eModeAdvise);
+
+    ///Drops the pending requests and waits for the ones being processed.
+    ~SequencePrefetcher();
+
+    /**
+     * @brief To be called when the player moves to a frame, with direction 1 when playing forward or -1 when playing backward.
+     * If the frame is not the next one in the previous direction (or within the window of the previous frame), this is a
+     * seek: pending requests are dropped before the new window is requested.
+     **/
+    void setCurrentFrame(int frame, int direction = 1);
+
+    ///Drops the pending requests. The next call to setCurrentFrame requests a full window again.
+    void cancel();
+
+    ///The number of files requested that are not prefetched yet.
+    std::size_t getPendingRequestsCount() const;
+
+    ///The number of files prefetched since the creation of the prefetcher.
+    std::size_t getPrefetchedFilesCount() const;
+
+private:
+    SequencePrefetcher(const SequencePrefetcher& other);
+    void operator=(const SequencePrefetcher& other);
+
+    auto_ptr<SequencePrefetcherPrivate> _imp; // PImpl
+};
+
+///Called by copySequence after each file, with the number of files done (copied, skipped or failed) and the bytes copied so far.
+typedef std::function<void (std::size_t filesDone, std::size_t filesCount, unsigned long long bytesCopied)> SequenceCopyProgressCallback;
+
+struct SequenceCopyOptions
+{
+    ///Added to the frame numbers to generate the destination names
+    int frameOffset;
+
+    ///The number of files copied concurrently
+    int threadsCount;
+
+    ///The maximum number of bytes of the files being copied at the same time, a bigger file is copied alone
+    unsigned long long maxInFlightBytes;
+
+    ///Skips the files whose destination has the same size and modification time (to the second): copies preserve the
+    ///modification time so that an interrupted copy can be resumed by copying the sequence again.
+    bool resume;
+
+    ///Removes the source files once copied, files are renamed instead when the destination is on the same volume.
+    ///Like copies, moves overwrite the existing destination files.
+    bool move;
+
+    ///Called from the copying threads, one call at a time
+    SequenceCopyProgressCallback progressCallback;
+
+    SequenceCopyOptions();
+};
+
+/**
+ * @brief Copies (or moves) the files of a sequence to the names generated by destinationPattern, the views keep their
+ * index, viewNames are used to generate the names like in generateFileNameFromPattern. Files are copied concurrently,
+ * with copy_file_range on Linux so that the data does not go through user space (and can be cloned by the file-system),
+ * or with a buffered copy where it is not supported. Existing destination files are overwritten.
+ * @param failedFiles If not NULL, the source files that could not be copied. The other files are still copied.
+ * @returns False if a file could not be copied, or if a destination name is the name of another file of the sequence
+ * in which case nothing is copied: use planSequenceRename to renumber a sequence in place.
+ **/
+bool copySequence(const SequenceFromPattern& sequence,
+                  const std::string& destinationPattern,
+                  const std::vector<std::string>& viewNames,
+                  const SequenceCopyOptions& options = SequenceCopyOptions(),
+                  std::vector<std::string>* failedFiles = 0);
+
+///Called by a SequenceSizeEstimator from its thread as the estimate is refined
+typedef std::function<void (const SequenceSizeEstimate& estimate)> SequenceSizeEstimateCallback;
+
+/**
+ * @brief Estimates the size of a sequence like estimateSequenceSize, then refines the estimate by sizing the other
+ * files on a thread owned by the estimator, until it is exact. The files are sized in an order that keeps them spread
+ * across the sequence so that the estimate and its interval stay meaningful while they are refined.
+ * The file names are copied: the sequence may be destroyed once the estimator is created.
+ **/
+struct SequenceSizeEstimatorPrivate;
+class SequenceSizeEstimator
+{
+public:
+
+    ///The sampling is done by the constructor, the first estimate is available when it returns.
+    ///@param callback If set, called every few hundred files sized by the refinement and when the estimate is exact.
+    explicit SequenceSizeEstimator(const SequenceFromPattern& sequence,
+                                   std::size_t samplesCount = 64,
+                                   double confidence = 0.95,
+                                   const SequenceSizeEstimateCallback& callback = SequenceSizeEstimateCallback());
+
+    explicit SequenceSizeEstimator(const SequenceFromFiles& sequence,
+                                   std::size_t samplesCount = 64,
+                                   double confidence = 0.95,
+                                   const SequenceSizeEstimateCallback& callback = SequenceSizeEstimateCallback());
+
+    ///Cancels the refinement and waits for the file being sized
+    ~SequenceSizeEstimator();
+
+    void getEstimate(SequenceSizeEstimate* estimate) const;
+
+    ///Stops the refinement, the estimate stays the one of the files sized so far
+    void cancel();
+
+    ///Waits until the refinement is finished or cancelled
+    void wait();
+
+private:
+    SequenceSizeEstimator(const SequenceSizeEstimator& other);
+    void operator=(const SequenceSizeEstimator& other);
+
+    auto_ptr<SequenceSizeEstimatorPrivate> _imp; // PImpl
+};
+#endif // __cplusplus >= 201103L
+
+/**
+ * @brief Appends to 'data' a compact binary encoding of the sequence, meant to be sent to other processes
+ * instead of the list of its file names. The pattern is stored once, the frames of each view as
+ * variable-length delta encoded ranges: a sequence without gaps takes a few bytes whatever its length.
+ * File names that cannot be generated from the pattern (e.g: a frame with more digits than the padding
+ * of a %d pattern) are stored verbatim.
+ * @param metadata If not NULL, the sizes, modification times and inodes of the files are stored too. Columns
+ * which are 0 for every file are left out.
+ **/
+void serializeSequence(const std::string& pattern,
+                       const SequenceFromPattern& sequence,
+                       const SequenceFilesMetadata* metadata,
+                       std::string* data);
+
+/**
+ * @brief Decodes data encoded by serializeSequence. The data is read in place, without being copied.
+ * @param metadata If not NULL, it is filled with the metadata stored in the data (if any), ordered by view then frame.
+ * @returns False if the data is truncated, corrupted, encoded by a newer version of the format or describes
+ * more than 16777216 files (SEQUENCEPARSING_WIRE_MAX_FILES_COUNT), so that untrusted data cannot exhaust the memory.
+ **/
+bool deserializeSequence(const char* data,
+                         std::size_t size,
+                         std::string* pattern,
+                         SequenceFromPattern* sequence,
+                         SequenceFilesMetadata* metadata = 0);
+
+///Same as above but only the frame ranges of each view are decoded, no file name is generated.
+bool deserializeSequenceFrames(const char* data,
+                               std::size_t size,
+                               std::string* pattern,
+                               std::map<int, FrameRanges>* viewsFrames);
+
+///Same as serializeSequence for a SequenceFromFiles, with the pattern returned by generateValidSequencePattern().
+void serializeSequence(const SequenceFromFiles& sequence, std::string* data);
+
+///Decodes a SequenceFromFiles encoded by serializeSequence into 'sequence' which must be empty.
+bool deserializeSequence(const char* data,
+                         std::size_t size,
+                         SequenceFromFiles* sequence);
+
+#if __cplusplus >= 201703L
+/**
+ * @brief A newline-delimited list of absolute file names (e.g: an inventory export), memory-mapped
+ * and split by directory without copying: all the names returned reference the mapping and are
+ * only valid until the manifest is closed or destroyed. Empty lines and trailing '\r' are ignored.
+ **/
+struct FileManifestPrivate;
+class FileManifest
+{
+public:
+
+    FileManifest();
+
+    ~FileManifest();
+
+    ///Maps the given file, closing any previous one. Returns false if it could not be opened or mapped.
+    bool open(const std::string& filename);
+
+    void close();
+
+    ///The number of distinct directories in the manifest, in order of first appearance
+    std::size_t getDirectoriesCount() const;
+
+    ///The directory, ending with a separator (empty for names without path)
+    std::string_view getDirectory(std::size_t index) const;
+
+    ///The absolute file names in this directory, in the manifest order. The file name without path
+    ///is what follows the first getDirectory(index).size() characters.
+    const std::vector<std::string_view>& getFiles(std::size_t index) const;
+
+    ///Returns the index of the directory, or -1 if the manifest has no file in it
+    int findDirectory(std::string_view path) const;
+
+private:
+    FileManifest(const FileManifest& other);
+    void operator=(const FileManifest& other);
+
+    auto_ptr<FileManifestPrivate> _imp; // PImpl
+};
+
+///Same as SequenceFromPattern, except that the file names reference the memory of a FileManifest.
+typedef std::map<int, std::map<int, std::string_view> > SequenceViewFromPattern;
+
+/**
+ * @brief Same as filesListFromPattern_fast for the files of the manifest in the directory of the pattern.
+ * The absolute file names of the result reference the manifest mapping.
+ **/
+bool filesListFromPattern_fast(const std::string& pattern,
+                               const FileManifest& manifest,
+                               SequenceViewFromPattern* sequence);
+
+/**
+ * @brief Same as groupFilesIntoSequences, directory by directory over the manifest. Only the names passing
+ * the extension filter are copied out of the mapping.
+ **/
+void groupFilesIntoSequences(const FileManifest& manifest,
+                             const StringList& extensions,
+                             std::vector<SequenceFromFiles>* sequences,
+                             std::vector<MultiViewSequence>* multiViewSequences = 0,
+                             bool enableSizeEstimation = false);
+#endif // if __cplusplus >= 201703L
 } //namespace SequenceParsing
 
 #endif /* defined(__IO__SequenceParser__) */
@@ -0,0 +1,699 @@
+/*
+   Measures the file-system entry points of the library on generated directory trees of 1k to 2M entries.
+
+   For each tree size and each entry point, it reports the wall time, the file-system calls counted by the library
+   (IOStatistics) and the peak resident memory of the run, once with a warm page cache and, when the benchmark may
+   drop the caches (i.e: it runs as root on Linux), once with a cold one.
+
+   This program is Linux only: it reads /proc to reset and measure the peak resident memory and to drop the caches.
+   Build it with the library, e.g:
+   g++ -std=c++17 -O2 -I.. FileSystemBenchmark.cpp ../SequenceParsing.cpp -lpthread -o FileSystemBenchmark
+
+   Usage: FileSystemBenchmark [--root <dir>] [--sizes 1000,10000,100000,1000000,2000000] [--repeat <n>] [--keep]
+   --root    Where the trees are generated. A tree already generated there is reused. Defaults to a new directory
+             in $TMPDIR, removed at the end unless --keep is given.
+   --sizes   The numbers of entries of the trees, in thousands when suffixed with k and in millions with M.
+   --repeat  The number of warm runs of each entry point, the fastest one is reported. Defaults to 3.
+   --keep    Keeps the generated trees.
+
+   The files are sparse: a 2M entries tree takes 2M inodes but almost no disk space.
+ */
+
+#include "SequenceParsing.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#if __cplusplus < 201103L
+#error "The benchmark must be compiled in C++11 or later"
+#endif
+
+using namespace SequenceParsing;
+
+namespace {
+
+///The maximum number of frames of each sequence of a tree, and of each batch of noise files
+#define BENCHMARK_SEQUENCE_FRAMES_COUNT 1000
+
+///The number of samples of estimateSequenceSize
+#define BENCHMARK_SIZE_SAMPLES_COUNT 64
+
+struct Options
+{
+    std::string root;
+    std::vector<std::size_t> sizes;
+    int repeat;
+    bool keep;
+
+    Options()
+        : root()
+        , sizes()
+        , repeat(3)
+        , keep(false)
+    {
+    }
+};
+
+///What a benchmark run measured
+struct Measure
+{
+    double milliseconds;
+    IOStatistics io;
+    long peakResidentKiloBytes; //< -1 if it could not be read
+    std::size_t filesFound;
+};
+
+///The patterns the entry points are run on for a tree
+struct TreePatterns
+{
+    std::string flatDirectory; //< with a trailing separator
+    std::string monoPattern; //< the first mono sequence of the flat directory
+    std::string stereoPattern; //< the first stereo sequence of the flat directory
+    std::string nestedPattern; //< the sequence split in one directory per view of the nested tree
+};
+
+bool
+parseSize(const std::string& text,
+          std::size_t* size)
+{
+    char* end = 0;
+    const double value = std::strtod(text.c_str(), &end);
+
+    if ( (end == text.c_str()) || (value <= 0) ) {
+        return false;
+    }
+    double multiplier = 1.;
+    if (*end == 'k') {
+        multiplier = 1000.;
+        ++end;
+    } else if (*end == 'M') {
+        multiplier = 1000000.;
+        ++end;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *size = (std::size_t)(value * multiplier);
+
+    return true;
+}
+
+bool
+parseOptions(int argc,
+             char** argv,
+             Options* options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ( (arg == "--root") && (i + 1 < argc) ) {
+            options->root = argv[++i];
+        } else if ( (arg == "--sizes") && (i + 1 < argc) ) {
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while ( std::getline(ss, item, ',') ) {
+                std::size_t size;
+                if ( !parseSize(item, &size) ) {
+                    return false;
+                }
+                options->sizes.push_back(size);
+            }
+        } else if ( (arg == "--repeat") && (i + 1 < argc) ) {
+            options->repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--keep") {
+            options->keep = true;
+        } else {
+            return false;
+        }
+    }
+    if ( options->sizes.empty() ) {
+        const std::size_t defaultSizes[] = { 1000, 10000, 100000, 1000000, 2000000 };
+        options->sizes.assign( defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]) );
+    }
+
+    return true;
+}
+
+bool
+fileExists(const std::string& path)
+{
+    struct stat st;
+
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+bool
+makeDirectory(const std::string& path)
+{
+    return (::mkdir(path.c_str(), 0755) == 0) || (errno == EEXIST);
+}
+
+///Creates a sparse file of the given size
+bool
+createFile(const std::string& path,
+           off_t size)
+{
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::ftruncate(fd, size) == 0;
+    ::close(fd);
+
+    return ok;
+}
+
+///A size of a few MB varying from frame to frame, with a few truncated frames as in real renders
+off_t
+frameSize(std::size_t seed)
+{
+    seed = seed * 2654435761u;
+    if (seed % 97 == 0) {
+        return 1024;
+    }
+
+    return 4 * 1024 * 1024 + (off_t)(seed % (1024 * 1024));
+}
+
+std::string
+formatFrame(std::size_t frame)
+{
+    char buf[32];
+
+    std::snprintf(buf, sizeof(buf), "%04u", (unsigned)frame);
+
+    return buf;
+}
+
+/**
+ * @brief Fills the directory with entriesCount files: mono sequences, stereo sequences with left and right views,
+ * sequences with a numeric extension (e.g: render.log.12) and unrelated files (sidecars, thumbnails, hidden files).
+ * Sequences have BENCHMARK_SEQUENCE_FRAMES_COUNT frames, or a quarter of the entries in small trees so that every
+ * kind of file is present. The last batch may be shorter.
+ **/
+bool
+generateFlatDirectory(const std::string& directory,
+                      std::size_t entriesCount)
+{
+    if ( !makeDirectory(directory) ) {
+        return false;
+    }
+    const std::size_t batchSize = std::max( (std::size_t)1, std::min( (std::size_t)BENCHMARK_SEQUENCE_FRAMES_COUNT, entriesCount / 4 ) );
+    std::size_t created = 0;
+    for (std::size_t batch = 0; created < entriesCount; ++batch) {
+        const std::size_t framesCount = std::min(batchSize, entriesCount - created);
+        std::stringstream ss;
+        ss << "shot" << batch;
+        const std::string prefix = directory + ss.str();
+        switch (batch % 4) {
+        case 0:
+        case 1:
+            for (std::size_t i = 0; i < framesCount; ++i) {
+                if ( !createFile(prefix + "_beauty." + formatFrame(i + 1) + ".exr", frameSize(created + i)) ) {
+                    return false;
+                }
+            }
+            created += framesCount;
+            break;
+        case 2: {
+            // As many files as a mono sequence: half of the frames, in 2 views
+            const std::size_t stereoFramesCount = std::max( (std::size_t)1, framesCount / 2 );
+            const char* views[] = { "left", "right" };
+            for (std::size_t i = 0; (i < stereoFramesCount) && (created < entriesCount); ++i) {
+                for (int v = 0; (v < 2) && (created < entriesCount); ++v) {
+                    if ( !createFile(prefix + "_" + views[v] + "." + formatFrame(i + 1) + ".exr", frameSize(created) ) ) {
+                        return false;
+                    }
+                    ++created;
+                }
+            }
+            break;
+        }
+        default:
+            for (std::size_t i = 0; i < framesCount; ++i) {
+                std::stringstream name;
+                switch (i % 4) {
+                case 0:
+                    name << ss.str() << "_render.log." << i;
+                    break;
+                case 1:
+                    name << ss.str() << "_beauty." << formatFrame(i) << ".exr.xml";
+                    break;
+                case 2:
+                    name << ss.str() << "_thumb_" << std::hex << (i * 2654435761u) << ".jpg";
+                    break;
+                default:
+                    name << "." << ss.str() << "_" << i << ".lock";
+                    break;
+                }
+                if ( !createFile(directory + name.str(), 512) ) {
+                    return false;
+                }
+            }
+            created += framesCount;
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Fills the directory with a sequence split in one directory per view, tree/left/shot.####.exr and
+ * tree/right/shot.####.exr, along with directories and files unrelated to the sequence, entriesCount entries in total.
+ **/
+bool
+generateNestedTree(const std::string& directory,
+                   std::size_t entriesCount)
+{
+    if ( !makeDirectory(directory) ) {
+        return false;
+    }
+    const char* views[] = { "left", "right" };
+    const std::size_t framesCount = std::max( (std::size_t)1, entriesCount / 4 );
+    std::size_t created = 0;
+    for (int v = 0; v < 2; ++v) {
+        const std::string viewDirectory = directory + views[v] + "/";
+        if ( !makeDirectory(viewDirectory) ) {
+            return false;
+        }
+        ++created;
+        for (std::size_t i = 0; (i < framesCount) && (created < entriesCount); ++i, ++created) {
+            if ( !createFile(viewDirectory + "shot." + formatFrame(i + 1) + ".exr", frameSize(created) ) ) {
+                return false;
+            }
+        }
+    }
+    // Unrelated directories, each holding a batch of files
+    for (std::size_t batch = 0; created < entriesCount; ++batch) {
+        std::stringstream batchDirectory;
+        batchDirectory << directory << "cache" << batch << "/";
+        if ( !makeDirectory( batchDirectory.str() ) ) {
+            return false;
+        }
+        ++created;
+        for (std::size_t i = 0; (i < BENCHMARK_SEQUENCE_FRAMES_COUNT) && (created < entriesCount); ++i, ++created) {
+            if ( !createFile(batchDirectory.str() + "sim." + formatFrame(i + 1) + ".bgeo", 512) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+///Generates the trees of the given size in the root, unless they were generated completely by a previous run
+bool
+generateTrees(const std::string& root,
+              std::size_t entriesCount,
+              TreePatterns* patterns)
+{
+    std::stringstream ss;
+
+    ss << root << "/" << entriesCount << "/";
+    const std::string treeRoot = ss.str();
+    patterns->flatDirectory = treeRoot + "flat/";
+    patterns->monoPattern = patterns->flatDirectory + "shot0_beauty.####.exr";
+    patterns->stereoPattern = patterns->flatDirectory + "shot2_%V.####.exr";
+    patterns->nestedPattern = treeRoot + "nested/%V/shot.####.exr";
+
+    const std::string completeMarker = treeRoot + "complete";
+    if ( fileExists(completeMarker) ) {
+        return true;
+    }
+    if ( !makeDirectory(treeRoot) ||
+         !generateFlatDirectory(patterns->flatDirectory, entriesCount) ||
+         !generateNestedTree(treeRoot + "nested/", entriesCount) ) {
+        return false;
+    }
+
+    return createFile(completeMarker, 0);
+}
+
+///Removes the directory and everything it contains
+bool
+removeTree(const std::string& path)
+{
+    DIR* dir = ::opendir( path.c_str() );
+
+    if (!dir) {
+        return false;
+    }
+    bool ok = true;
+    while (struct dirent* entry = ::readdir(dir)) {
+        if ( !std::strcmp(entry->d_name, ".") || !std::strcmp(entry->d_name, "..") ) {
+            continue;
+        }
+        const std::string child = path + "/" + entry->d_name;
+        struct stat st;
+        if (::lstat(child.c_str(), &st) != 0) {
+            ok = false;
+        } else if ( S_ISDIR(st.st_mode) ) {
+            ok = removeTree(child) && ok;
+        } else {
+            ok = (::unlink( child.c_str() ) == 0) && ok;
+        }
+    }
+    ::closedir(dir);
+
+    return (::rmdir( path.c_str() ) == 0) && ok;
+}
+
+///Writes the dirty pages and drops the page, dentry and inode caches. Returns false if the process may not.
+bool
+dropCaches()
+{
+    ::sync();
+    std::ofstream file("/proc/sys/vm/drop_caches");
+    if (!file) {
+        return false;
+    }
+    file << "3" << std::endl;
+
+    return file.good();
+}
+
+/**
+ * @brief Resets the peak resident memory of the process to its current resident memory, returns false if not supported.
+ * The memory freed by the previous runs is first given back to the system, otherwise it would still count.
+ **/
+bool
+resetPeakResidentMemory()
+{
+#ifdef __GLIBC__
+    ::malloc_trim(0);
+#endif
+    std::ofstream file("/proc/self/clear_refs");
+    if (!file) {
+        return false;
+    }
+    file << "5" << std::endl;
+
+    return file.good();
+}
+
+long
+getPeakResidentKiloBytes()
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+
+    while ( std::getline(file, line) ) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atol( line.c_str() + 6 );
+        }
+    }
+
+    return -1;
+}
+
+unsigned long long
+totalCalls(const IOStatistics& io)
+{
+    return io.directoriesOpened + io.filesStatted + io.filesOpened + io.filesRenamed + io.filesRemoved +
+           io.fileTimesSet + io.readCalls + io.writeCalls + io.copyCalls;
+}
+
+///Runs the function once and measures it. The function returns the number of files it found.
+Measure
+measure(const std::function<std::size_t()>& function)
+{
+    Measure ret;
+
+    resetPeakResidentMemory();
+    resetIOStatistics();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ret.filesFound = function();
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    getIOStatistics(&ret.io);
+    ret.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    ret.peakResidentKiloBytes = getPeakResidentKiloBytes();
+
+    return ret;
+}
+
+void
+printHeader()
+{
+    std::printf("%9s  %-28s %-4s %11s %8s %10s %8s %8s %8s %10s %9s %10s\n",
+                "entries", "entry point", "run", "wall (ms)", "opendir", "dirents", "stat", "open", "read",
+                "total I/O", "files", "peak RSS");
+}
+
+void
+printMeasure(std::size_t entriesCount,
+             const char* name,
+             const char* run,
+             const Measure& m)
+{
+    std::printf("%9zu  %-28s %-4s %11.2f %8llu %10llu %8llu %8llu %8llu %10llu %9zu %7ld KB\n",
+                entriesCount, name, run, m.milliseconds, m.io.directoriesOpened, m.io.directoryEntriesRead,
+                m.io.filesStatted, m.io.filesOpened, m.io.readCalls, totalCalls(m.io), m.filesFound,
+                m.peakResidentKiloBytes);
+    std::fflush(stdout);
+}
+
+///Runs the function cold if the caches can be dropped, then warm, repeat times, and prints the fastest warm run
+void
+runBenchmark(std::size_t entriesCount,
+             const char* name,
+             const Options& options,
+             bool canDropCaches,
+             const std::function<std::size_t()>& function)
+{
+    if (canDropCaches) {
+        dropCaches();
+        printMeasure( entriesCount, name, "cold", measure(function) );
+    } else {
+        // Warms the caches up so that the first measured run is not slower than the next ones
+        function();
+    }
+    Measure best;
+    for (int i = 0; i < options.repeat; ++i) {
+        const Measure m = measure(function);
+        if ( (i == 0) || (m.milliseconds < best.milliseconds) ) {
+            best = m;
+        }
+    }
+    printMeasure(entriesCount, name, "warm", best);
+}
+
+std::size_t
+filesCount(const SequenceFromPattern& sequence)
+{
+    std::size_t count = 0;
+
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        count += it->second.size();
+    }
+
+    return count;
+}
+
+std::size_t
+filesCount(const std::vector<SequenceFromFiles>& sequences,
+           const std::vector<MultiViewSequence>& multiViewSequences)
+{
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < sequences.size(); ++i) {
+        count += sequences[i].count();
+    }
+    for (std::size_t i = 0; i < multiViewSequences.size(); ++i) {
+        count += filesCount(multiViewSequences[i].sequence);
+    }
+
+    return count;
+}
+
+StringList
+listDirectory(const std::string& directory)
+{
+    FileTable table;
+
+    table.appendDirectory(directory);
+    StringList ret;
+    ret.reserve( table.size() );
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        ret.push_back( table.getNameString(i) );
+    }
+
+    return ret;
+}
+
+void
+runBenchmarks(std::size_t entriesCount,
+              const TreePatterns& patterns,
+              const Options& options,
+              bool canDropCaches)
+{
+    runBenchmark(entriesCount, "filesListFromPattern_slow", options, canDropCaches, [&]() {
+        SequenceFromPattern sequence;
+        filesListFromPattern_slow(patterns.stereoPattern, &sequence);
+
+        return filesCount(sequence);
+    });
+
+    runBenchmark(entriesCount, "slow with metadata", options, canDropCaches, [&]() {
+        SequenceFromPattern sequence;
+        SequenceFilesMetadata metadata;
+        filesListFromPattern_slow(patterns.monoPattern, &sequence, &metadata);
+
+        return filesCount(sequence);
+    });
+
+    runBenchmark(entriesCount, "FileTable + fast", options, canDropCaches, [&]() {
+        FileTable table;
+        table.appendDirectory(patterns.flatDirectory);
+        SequenceFromPattern sequence;
+        filesListFromPattern_fast(patterns.stereoPattern, table, &sequence);
+
+        return filesCount(sequence);
+    });
+
+    runBenchmark(entriesCount, "filtered FileTable + fast", options, canDropCaches, [&]() {
+        DirectoryListingFilter filter;
+        getDirectoryListingFilterFromPattern(patterns.stereoPattern, &filter);
+        FileTable table;
+        table.appendDirectory(patterns.flatDirectory, filter);
+        SequenceFromPattern sequence;
+        filesListFromPattern_fast(patterns.stereoPattern, table, &sequence);
+
+        return filesCount(sequence);
+    });
+
+    runBenchmark(entriesCount, "filesListFromPattern_async", options, canDropCaches, [&]() {
+        AsyncScanHandle handle = filesListFromPattern_async(patterns.stereoPattern);
+        handle.wait();
+
+        return filesCount( handle.getResult() );
+    });
+
+    runBenchmark(entriesCount, "filesListFromPattern_nested", options, canDropCaches, [&]() {
+        SequenceFromPattern sequence;
+        filesListFromPattern_nested(patterns.nestedPattern, &sequence);
+
+        return filesCount(sequence);
+    });
+
+    runBenchmark(entriesCount, "groupFilesIntoSequences", options, canDropCaches, [&]() {
+        std::vector<SequenceFromFiles> sequences;
+        std::vector<MultiViewSequence> multiViewSequences;
+        groupFilesIntoSequences(patterns.flatDirectory, listDirectory(patterns.flatDirectory), StringList(),
+                                &sequences, &multiViewSequences);
+
+        return filesCount(sequences, multiViewSequences);
+    });
+
+    runBenchmark(entriesCount, "group with size estimation", options, canDropCaches, [&]() {
+        std::vector<SequenceFromFiles> sequences;
+        std::vector<MultiViewSequence> multiViewSequences;
+        groupFilesIntoSequences(patterns.flatDirectory, listDirectory(patterns.flatDirectory), StringList(),
+                                &sequences, &multiViewSequences, true);
+
+        return filesCount(sequences, multiViewSequences);
+    });
+
+    runBenchmark(entriesCount, "SequenceStreamGrouper", options, canDropCaches, [&]() {
+        StringList names = listDirectory(patterns.flatDirectory);
+        std::sort( names.begin(), names.end() );
+        std::size_t count = 0;
+        SequenceStreamGrouper grouper([&count](const SequenceFromFiles& sequence) {
+            count += sequence.count();
+        });
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            grouper.addFile(patterns.flatDirectory, names[i]);
+        }
+        grouper.finish();
+
+        return count;
+    });
+
+    // The sequence is listed once outside of the measure: only the sizing is measured
+    SequenceFromPattern monoSequence;
+    filesListFromPattern_slow(patterns.monoPattern, &monoSequence);
+    runBenchmark(entriesCount, "estimateSequenceSize", options, canDropCaches, [&]() {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(monoSequence, BENCHMARK_SIZE_SAMPLES_COUNT, &estimate);
+
+        return estimate.sizedFilesCount;
+    });
+}
+} // anon
+
+int
+main(int argc,
+     char** argv)
+{
+    Options options;
+
+    if ( !parseOptions(argc, argv, &options) ) {
+        std::cerr << "Usage: " << argv[0] << " [--root <dir>] [--sizes 1k,10k,100k,1M,2M] [--repeat <n>] [--keep]" << std::endl;
+
+        return 1;
+    }
+
+    bool createdRoot = false;
+    if ( options.root.empty() ) {
+        const char* tmp = std::getenv("TMPDIR");
+        std::string rootTemplate = std::string(tmp ? tmp : "/tmp") + "/SequenceParsingBenchmark.XXXXXX";
+        std::vector<char> buf( rootTemplate.begin(), rootTemplate.end() );
+        buf.push_back('\0');
+        if ( !::mkdtemp(&buf[0]) ) {
+            std::cerr << "Could not create a directory in " << (tmp ? tmp : "/tmp") << std::endl;
+
+            return 1;
+        }
+        options.root = &buf[0];
+        createdRoot = true;
+    } else if ( !makeDirectory(options.root) ) {
+        std::cerr << "Could not create " << options.root << std::endl;
+
+        return 1;
+    }
+
+    const bool canDropCaches = dropCaches();
+    if (!canDropCaches) {
+        std::cout << "The page cache cannot be dropped (run as root to enable them): cold runs are skipped." << std::endl;
+    }
+    if ( !resetPeakResidentMemory() ) {
+        std::cout << "The peak resident memory cannot be reset: it is the peak of the whole process." << std::endl;
+    }
+    std::cout << "Trees generated in " << options.root << std::endl << std::endl;
+    printHeader();
+
+    int ret = 0;
+    for (std::size_t i = 0; i < options.sizes.size(); ++i) {
+        TreePatterns patterns;
+        if ( !generateTrees(options.root, options.sizes[i], &patterns) ) {
+            std::cerr << "Could not generate the tree of " << options.sizes[i] << " entries in " << options.root << std::endl;
+            ret = 1;
+            break;
+        }
+        runBenchmarks(options.sizes[i], patterns, options, canDropCaches);
+    }
+
+    if (createdRoot && !options.keep) {
+        removeTree(options.root);
+    }
+
+    return ret;
+} // main
@@ -0,0 +1,88 @@
+/*
+   Checks filesListFromPattern_async on files created in a temporary directory.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <chrono>
+#include <thread>
+#endif
+
+using namespace SequenceParsing;
+using SequenceParsingTests::writeFile;
+
+namespace {
+#if __cplusplus >= 201103L
+///The scan finds the same files as filesListFromPattern_slow, with the same file-system calls
+void
+testSameAsSlow(const std::string& root)
+{
+    for (int i = 1; i <= 100; ++i) {
+        std::stringstream ss;
+        ss << root << "shot_left." << 1000 + i << ".exr";
+        SEQUENCEPARSING_CHECK( writeFile(ss.str(), "l") );
+        ss.str("");
+        ss << root << "shot_right." << 1000 + i << ".exr";
+        SEQUENCEPARSING_CHECK( writeFile(ss.str(), "r") );
+        ss.str("");
+        ss << root << "other_" << i << ".txt";
+        SEQUENCEPARSING_CHECK( writeFile(ss.str(), "o") );
+    }
+    SEQUENCEPARSING_CHECK( SequenceParsingTests::makeDirectories(root + "shot_left.9999.exr/") );
+
+    const std::string pattern = root + "shot_%V.####.exr";
+    SequenceFromPattern slowSequence;
+    resetIOStatistics();
+    SEQUENCEPARSING_CHECK( filesListFromPattern_slow(pattern, &slowSequence) );
+    IOStatistics slowStatistics;
+    getIOStatistics(&slowStatistics);
+
+    std::atomic<int> callbacksCount(0);
+    resetIOStatistics();
+    AsyncScanHandle handle = filesListFromPattern_async(pattern, -1, [&callbacksCount](AsyncScanHandle::Status, const SequenceFromPattern&) {
+        ++callbacksCount;
+    });
+    SEQUENCEPARSING_CHECK_EQUAL(handle.wait(), AsyncScanHandle::eStatusFinished);
+    IOStatistics asyncStatistics;
+    getIOStatistics(&asyncStatistics);
+
+    const SequenceFromPattern asyncSequence = handle.getResult();
+    SEQUENCEPARSING_CHECK_EQUAL(asyncSequence.size(), 100u);
+    SEQUENCEPARSING_CHECK(asyncSequence == slowSequence);
+    ///The callback runs after the waiters are released
+    for (int i = 0; (i < 1000) && (callbacksCount.load() == 0); ++i) {
+        std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+    SEQUENCEPARSING_CHECK_EQUAL(callbacksCount.load(), 1);
+    SEQUENCEPARSING_CHECK_EQUAL(asyncStatistics.directoriesOpened, slowStatistics.directoriesOpened);
+    SEQUENCEPARSING_CHECK_EQUAL(asyncStatistics.directoryEntriesRead, slowStatistics.directoryEntriesRead);
+    SEQUENCEPARSING_CHECK_EQUAL(asyncStatistics.filesStatted, slowStatistics.filesStatted);
+}
+
+void
+testFailures(const std::string& root)
+{
+    SEQUENCEPARSING_CHECK_EQUAL(filesListFromPattern_async("").wait(), AsyncScanHandle::eStatusFailed);
+    SEQUENCEPARSING_CHECK_EQUAL(filesListFromPattern_async(root + "missing/a.####.exr").wait(), AsyncScanHandle::eStatusFailed);
+}
+#endif // __cplusplus >= 201103L
+} // namespace {
+
+int
+main()
+{
+#if __cplusplus >= 201103L
+    SequenceParsingTests::TemporaryDirectory directory;
+
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testSameAsSlow( directory.path() );
+        testFailures( directory.path() );
+    }
+#endif
+
+    return SequenceParsingTests::testsResult("AsyncScanTests");
+}
@@ -0,0 +1,395 @@
+/*
+   Checks copySequence on files created in temporary directories.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+using namespace SequenceParsing;
+using SequenceParsingTests::fileExists;
+using SequenceParsingTests::readFile;
+using SequenceParsingTests::writeFile;
+
+namespace {
+#if __cplusplus >= 201103L
+///The content of a file of the sequence, with a size depending on the frame
+std::string
+getContent(int frameNumber,
+           int viewNumber)
+{
+    std::stringstream ss;
+
+    ss << "frame " << frameNumber << " view " << viewNumber << '\n';
+
+    return ss.str() + std::string(frameNumber * 1000 + viewNumber * 10, 'x');
+}
+
+SequenceFromPattern
+writeSequence(const std::string& pattern,
+              const std::vector<std::string>& viewNames,
+              int first,
+              int last)
+{
+    SequenceFromPattern sequence;
+    const int viewsCount = viewNames.empty() ? 1 : (int)viewNames.size();
+
+    for (int frame = first; frame <= last; ++frame) {
+        for (int view = 0; view < viewsCount; ++view) {
+            const std::string filename = generateFileNameFromPattern(pattern, viewNames, frame, view);
+            SEQUENCEPARSING_CHECK( writeFile( filename, getContent(frame, view) ) );
+            sequence[frame][view] = filename;
+        }
+    }
+
+    return sequence;
+}
+
+///In nanoseconds, or -1 if the file does not exist
+long long
+getModificationTime(const std::string& filename)
+{
+    struct stat st;
+
+    if (::stat(filename.c_str(), &st) != 0) {
+        return -1;
+    }
+
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+void
+setModificationTime(const std::string& filename,
+                    long long modificationTime)
+{
+    struct timespec times[2];
+
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = (time_t)(modificationTime / 1000000000LL);
+    times[1].tv_nsec = (long)(modificationTime % 1000000000LL);
+    SEQUENCEPARSING_CHECK(::utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+}
+
+std::size_t
+countFiles(const std::string& directory)
+{
+    FileTable table;
+
+    table.appendDirectory(directory);
+
+    return table.size();
+}
+
+/*
+   Checks that each file of the sequence was copied (or moved if sourcesRemoved) to destinationPattern with frameOffset,
+   with the content and modification time of the source.
+ */
+void
+checkCopies(const SequenceFromPattern& sequence,
+            const std::string& destinationPattern,
+            const std::vector<std::string>& viewNames,
+            int frameOffset,
+            const std::map<std::string, long long>& modificationTimes,
+            bool sourcesRemoved)
+{
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (std::map<int, std::string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            const std::string to = generateFileNameFromPattern(destinationPattern, viewNames, it->first + frameOffset, it2->first);
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(readFile(to) == getContent(it->first, it2->first), true, to);
+            std::map<std::string, long long>::const_iterator found = modificationTimes.find(it2->second);
+            if ( found != modificationTimes.end() ) {
+                SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(getModificationTime(to), found->second, to);
+            }
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(fileExists(it2->second), !sourcesRemoved, it2->second);
+        }
+    }
+}
+
+std::map<std::string, long long>
+getModificationTimes(const SequenceFromPattern& sequence)
+{
+    std::map<std::string, long long> ret;
+
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (std::map<int, std::string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            ret[it2->second] = getModificationTime(it2->second);
+        }
+    }
+
+    return ret;
+}
+
+unsigned long long
+getSequenceBytes(const SequenceFromPattern& sequence)
+{
+    unsigned long long ret = 0;
+
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        for (std::map<int, std::string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            ret += getContent(it->first, it2->first).size();
+        }
+    }
+
+    return ret;
+}
+
+///The progress reported by copySequence
+struct CopyProgress
+{
+    std::size_t callsCount;
+    std::size_t filesDone;
+    std::size_t filesCount;
+    unsigned long long bytesCopied;
+
+    CopyProgress()
+        : callsCount(0)
+        , filesDone(0)
+        , filesCount(0)
+        , bytesCopied(0)
+    {
+    }
+};
+
+SequenceCopyOptions
+makeOptions(CopyProgress* progress)
+{
+    SequenceCopyOptions options;
+
+    options.progressCallback = [progress] (std::size_t filesDone, std::size_t filesCount, unsigned long long bytesCopied) {
+        ++progress->callsCount;
+        progress->filesDone = filesDone;
+        progress->filesCount = filesCount;
+        progress->bytesCopied = bytesCopied;
+    };
+
+    return options;
+}
+
+std::vector<std::string>
+getStereoViews()
+{
+    std::vector<std::string> viewNames;
+
+    viewNames.push_back("left");
+    viewNames.push_back("right");
+
+    return viewNames;
+}
+
+///A copy preserves the content and modification time, and resuming it skips the files already copied
+void
+testCopyAndResume(const std::string& root)
+{
+    const std::vector<std::string> viewNames = getStereoViews();
+    const SequenceFromPattern sequence = writeSequence(root + "src/shot_%V.####.exr", viewNames, 1, 5);
+    const std::string destination = root + "dst/copy.%v.####.exr";
+    ///an older file is overwritten
+    const std::string skipped = generateFileNameFromPattern(destination, viewNames, 11, 0);
+    SEQUENCEPARSING_CHECK( writeFile(skipped, "old") );
+
+    CopyProgress progress;
+    SequenceCopyOptions options = makeOptions(&progress);
+    options.frameOffset = 10;
+    std::vector<std::string> failedFiles;
+    SEQUENCEPARSING_CHECK( copySequence(sequence, destination, viewNames, options, &failedFiles) );
+    SEQUENCEPARSING_CHECK( failedFiles.empty() );
+    checkCopies(sequence, destination, viewNames, 10, getModificationTimes(sequence), false);
+    SEQUENCEPARSING_CHECK_EQUAL(progress.callsCount, 10u);
+    SEQUENCEPARSING_CHECK_EQUAL(progress.filesDone, 10u);
+    SEQUENCEPARSING_CHECK_EQUAL(progress.filesCount, 10u);
+    SEQUENCEPARSING_CHECK_EQUAL( progress.bytesCopied, getSequenceBytes(sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(root + "dst/"), 10u);
+
+    ///Same size and modification time to the second: skipped, even though the content differs
+    const long long sourceTime = getModificationTime(sequence.at(1).at(0));
+    const std::string tampered( getContent(1, 0).size(), 't' );
+    SEQUENCEPARSING_CHECK( writeFile(skipped, tampered) );
+    setModificationTime(skipped, sourceTime / 1000000000LL * 1000000000LL + 999999999LL);
+    ///a different modification time, size or a missing file is copied again
+    const std::string older = generateFileNameFromPattern(destination, viewNames, 12, 0);
+    const std::string smaller = generateFileNameFromPattern(destination, viewNames, 13, 1);
+    const std::string missing = generateFileNameFromPattern(destination, viewNames, 14, 1);
+    SEQUENCEPARSING_CHECK( writeFile( older, std::string(getContent(2, 0).size(), 't') ) );
+    setModificationTime(older, sourceTime - 2000000000LL);
+    SEQUENCEPARSING_CHECK( writeFile(smaller, "t") );
+    SEQUENCEPARSING_CHECK( ::unlink( missing.c_str() ) == 0 );
+
+    progress = CopyProgress();
+    SEQUENCEPARSING_CHECK( copySequence(sequence, destination, viewNames, options) );
+    SEQUENCEPARSING_CHECK_EQUAL(readFile(skipped), tampered);
+    SEQUENCEPARSING_CHECK( readFile(older) == getContent(2, 0) );
+    SEQUENCEPARSING_CHECK( readFile(smaller) == getContent(3, 1) );
+    SEQUENCEPARSING_CHECK( readFile(missing) == getContent(4, 1) );
+    SEQUENCEPARSING_CHECK_EQUAL(progress.filesDone, 10u);
+    SEQUENCEPARSING_CHECK_EQUAL( progress.bytesCopied, (unsigned long long)( getContent(2, 0).size() + getContent(3, 1).size() +
+                                                                             getContent(4, 1).size() ) );
+
+    ///without resume everything is copied
+    options.resume = false;
+    progress = CopyProgress();
+    SEQUENCEPARSING_CHECK( copySequence(sequence, destination, viewNames, options) );
+    checkCopies(sequence, destination, viewNames, 10, getModificationTimes(sequence), false);
+    SEQUENCEPARSING_CHECK_EQUAL( progress.bytesCopied, getSequenceBytes(sequence) );
+}
+
+///A move renames the files on the same volume, replacing the existing destinations
+void
+testMove(const std::string& root)
+{
+    const std::vector<std::string> viewNames = getStereoViews();
+    const SequenceFromPattern sequence = writeSequence(root + "move/shot_%V.####.exr", viewNames, 1, 5);
+    const std::map<std::string, long long> modificationTimes = getModificationTimes(sequence);
+    const std::string destination = root + "moved/shot_%V.####.exr";
+    SEQUENCEPARSING_CHECK( writeFile(root + "moved/shot_left.0001.exr", "stale") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "moved/shot_right.0005.exr", "stale") );
+
+    CopyProgress progress;
+    SequenceCopyOptions options = makeOptions(&progress);
+    options.move = true;
+    resetIOStatistics();
+    SEQUENCEPARSING_CHECK( copySequence(sequence, destination, viewNames, options) );
+    IOStatistics stats;
+    getIOStatistics(&stats);
+    checkCopies(sequence, destination, viewNames, 0, modificationTimes, true);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.filesRenamed, 10ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.copyCalls, 0ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.writeCalls, 0ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(progress.bytesCopied, 0ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(root + "move/"), 0u);
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(root + "moved/"), 10u);
+
+    ///resuming a move removes the sources that were already copied
+    const SequenceFromPattern copied = writeSequence(root + "move/shot_%V.####.exr", viewNames, 1, 5);
+    const std::map<std::string, long long> copiedModificationTimes = getModificationTimes(copied);
+    const std::string resumed = root + "resumed/shot_%V.####.exr";
+    SEQUENCEPARSING_CHECK( SequenceParsingTests::makeDirectories(root + "resumed/") );
+    options.move = false;
+    SEQUENCEPARSING_CHECK( copySequence(copied, resumed, viewNames, options) );
+    options.move = true;
+    resetIOStatistics();
+    SEQUENCEPARSING_CHECK( copySequence(copied, resumed, viewNames, options) );
+    getIOStatistics(&stats);
+    checkCopies(copied, resumed, viewNames, 0, copiedModificationTimes, true);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.filesRenamed, 0ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.filesRemoved, 10ULL);
+}
+
+///A move to another volume fails to rename (EXDEV) and falls back to a copy and a removal of the source
+void
+testMoveAcrossVolumes(const std::string& root)
+{
+    struct stat rootStat;
+    struct stat otherStat;
+    const char* otherVolume = "/dev/shm";
+
+    if ( (::stat(root.c_str(), &rootStat) != 0) || (::stat(otherVolume, &otherStat) != 0) || (rootStat.st_dev == otherStat.st_dev) ) {
+        std::cout << "testMoveAcrossVolumes: skipped, " << otherVolume << " is not another volume" << std::endl;
+
+        return;
+    }
+    SequenceParsingTests::TemporaryDirectory other(otherVolume);
+    SEQUENCEPARSING_CHECK( !other.path().empty() );
+    if ( other.path().empty() ) {
+        return;
+    }
+
+    const std::vector<std::string> viewNames = getStereoViews();
+    const SequenceFromPattern sequence = writeSequence(root + "volume/shot_%V.####.exr", viewNames, 1, 5);
+    const std::map<std::string, long long> modificationTimes = getModificationTimes(sequence);
+    const std::string destination = other.path() + "shot_%V.####.exr";
+    SEQUENCEPARSING_CHECK( writeFile(other.path() + "shot_left.0003.exr", "stale") );
+
+    CopyProgress progress;
+    SequenceCopyOptions options = makeOptions(&progress);
+    options.move = true;
+    resetIOStatistics();
+    SEQUENCEPARSING_CHECK( copySequence(sequence, destination, viewNames, options) );
+    IOStatistics stats;
+    getIOStatistics(&stats);
+    checkCopies(sequence, destination, viewNames, 0, modificationTimes, true);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.filesRenamed, 10ULL);
+    SEQUENCEPARSING_CHECK_EQUAL(stats.filesRemoved, 10ULL);
+    SEQUENCEPARSING_CHECK_EQUAL( progress.bytesCopied, getSequenceBytes(sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(root + "volume/"), 0u);
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles( other.path() ), 10u);
+}
+
+///Budgets smaller than the files copy them one at a time without blocking
+void
+testInFlightBudget(const std::string& root)
+{
+    const std::vector<std::string> viewNames;
+    const SequenceFromPattern sequence = writeSequence(root + "budget/shot.####.exr", viewNames, 1, 40);
+    const unsigned long long budgets[] = { 0, 1, 5000, 60000, 1ULL << 40 };
+
+    for (std::size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); ++i) {
+        std::stringstream ss;
+        ss << root << "budget" << i << '/';
+        SEQUENCEPARSING_CHECK( SequenceParsingTests::makeDirectories( ss.str() ) );
+        ss << "shot.####.exr";
+        CopyProgress progress;
+        SequenceCopyOptions options = makeOptions(&progress);
+        options.threadsCount = 8;
+        options.maxInFlightBytes = budgets[i];
+        SEQUENCEPARSING_CHECK( copySequence(sequence, ss.str(), viewNames, options) );
+        checkCopies(sequence, ss.str(), viewNames, 0, getModificationTimes(sequence), false);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( progress.bytesCopied, getSequenceBytes(sequence), ss.str() );
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(progress.filesDone, 40u, ss.str());
+    }
+}
+
+///Destinations that are other files of the sequence are rejected before anything is copied
+void
+testCollisions(const std::string& root)
+{
+    const std::vector<std::string> viewNames = getStereoViews();
+    const std::string pattern = root + "collisions/shot_%V.####.exr";
+    const SequenceFromPattern sequence = writeSequence(pattern, viewNames, 1, 5);
+    const std::map<std::string, long long> modificationTimes = getModificationTimes(sequence);
+    CopyProgress progress;
+    SequenceCopyOptions options = makeOptions(&progress);
+
+    ///frame 2 would overwrite frame 3
+    options.frameOffset = 1;
+    SEQUENCEPARSING_CHECK( !copySequence(sequence, pattern, viewNames, options) );
+    options.move = true;
+    SEQUENCEPARSING_CHECK( !copySequence(sequence, pattern, viewNames, options) );
+    ///the views of a frame would be copied to the same file
+    options.frameOffset = 100;
+    SEQUENCEPARSING_CHECK( !copySequence(sequence, root + "collisions/shot.####.exr", viewNames, options) );
+    ///the left view of a frame would overwrite the right one
+    options.frameOffset = 0;
+    std::vector<std::string> swappedViews;
+    swappedViews.push_back("right");
+    swappedViews.push_back("left");
+    SEQUENCEPARSING_CHECK( !copySequence(sequence, pattern, swappedViews, options) );
+    SEQUENCEPARSING_CHECK_EQUAL(progress.callsCount, 0u);
+    checkCopies(sequence, pattern, viewNames, 0, modificationTimes, false);
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(root + "collisions/"), 10u);
+
+    ///files copied onto themselves are left alone
+    SEQUENCEPARSING_CHECK( copySequence(sequence, pattern, viewNames, options) );
+    checkCopies(sequence, pattern, viewNames, 0, modificationTimes, false);
+    SEQUENCEPARSING_CHECK_EQUAL(progress.callsCount, 0u);
+}
+#endif // __cplusplus >= 201103L
+} // namespace {
+
+int
+main()
+{
+#if __cplusplus >= 201103L
+    SequenceParsingTests::TemporaryDirectory directory;
+
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testCopyAndResume( directory.path() );
+        testMove( directory.path() );
+        testMoveAcrossVolumes( directory.path() );
+        testInFlightBudget( directory.path() );
+        testCollisions( directory.path() );
+    }
+#endif
+
+    return SequenceParsingTests::testsResult("CopyTests");
+}
@@ -0,0 +1,242 @@
+/*
+   Checks the grouping of file names into sequences.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace SequenceParsing;
+
+namespace {
+void
+groupFiles(const char* const* fileNames,
+           size_t count,
+           std::vector<SequenceFromFiles>* sequences)
+{
+    groupFilesIntoSequences(StringList(fileNames, fileNames + count), sequences, NULL);
+}
+
+///Numbers after the last '.' may be the frame number: they must not split the files in one sequence per frame
+void
+testNumericExtensions()
+{
+    const char* const paddedFiles[] = { "/p/a.0001", "/p/a.0002", "/p/a.0003" };
+    std::vector<SequenceFromFiles> sequences;
+
+    groupFiles(paddedFiles, 3, &sequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 1u);
+    if (sequences.size() == 1) {
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[0].count(), 3);
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[0].generateValidSequencePattern(), std::string("/p/a.####") );
+    }
+
+    const char* const logFiles[] = { "/p/log.1", "/p/log.2", "/p/log.10", "/p/other.1" };
+    sequences.clear();
+    groupFiles(logFiles, 4, &sequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 2u);
+    if (sequences.size() == 2) {
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[0].count(), 3);
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[0].getFirstFrame(), 1);
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[0].getLastFrame(), 10);
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[1].count(), 1);
+    }
+
+    FileNameContent first("/p/log.1");
+    FileNameContent second("/p/log.2");
+    int frameNumberIndex;
+    SEQUENCEPARSING_CHECK_EQUAL( first.getSignature(), second.getSignature() );
+    SEQUENCEPARSING_CHECK( second.matchesPattern(first, &frameNumberIndex) );
+
+#if __cplusplus >= 201103L
+    std::vector<SequenceFromFiles> streamed;
+    SequenceStreamGrouper grouper([&streamed](const SequenceFromFiles& sequence) {
+        streamed.push_back(sequence);
+    });
+    for (size_t i = 0; i < 3; ++i) {
+        grouper.addFile(paddedFiles[i]);
+    }
+    grouper.finish();
+    SEQUENCEPARSING_CHECK_EQUAL(streamed.size(), 1u);
+    if (streamed.size() == 1) {
+        SEQUENCEPARSING_CHECK_EQUAL(streamed[0].count(), 3);
+    }
+#endif
+}
+
+///Text extensions still separate the sequences
+void
+testTextExtensions()
+{
+    const char* const files[] = { "/p/a.0001.exr", "/p/a.0002.exr", "/p/a.0001.dpx", "/p/a.0002.dpx" };
+    std::vector<SequenceFromFiles> sequences;
+
+    groupFiles(files, 4, &sequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 2u);
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        SEQUENCEPARSING_CHECK_EQUAL(sequences[i].count(), 2);
+    }
+    SEQUENCEPARSING_CHECK( FileNameContent("/p/a.0001.exr").getSignature() != FileNameContent("/p/a.0001.dpx").getSignature() );
+}
+
+///Groups the files with the multi-view merging and checks that every file is in exactly one of the outputs
+void
+groupMultiViewFiles(const StringList& fileNames,
+                    std::vector<SequenceFromFiles>* sequences,
+                    std::vector<MultiViewSequence>* multiViewSequences,
+                    const std::string& context)
+{
+    groupFilesIntoSequences(fileNames, sequences, multiViewSequences);
+
+    std::map<std::string, int> outputsCount;
+    for (size_t i = 0; i < sequences->size(); ++i) {
+        const std::map<int, FileNameContent>& frames = (*sequences)[i].getFrameIndexes();
+        for (std::map<int, FileNameContent>::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+            ++outputsCount[it->second.absoluteFileName()];
+        }
+    }
+    for (size_t i = 0; i < multiViewSequences->size(); ++i) {
+        const SequenceFromPattern& sequence = (*multiViewSequences)[i].sequence;
+        for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+            for (std::map<int, std::string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+                ++outputsCount[it2->second];
+            }
+        }
+    }
+    std::set<std::string> inputs( fileNames.begin(), fileNames.end() );
+    for (std::set<std::string>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(outputsCount[*it], 1, context + ": " + *it);
+    }
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( outputsCount.size(), inputs.size(), context );
+}
+
+void
+groupMultiViewFiles(const char* const* fileNames,
+                    size_t count,
+                    std::vector<SequenceFromFiles>* sequences,
+                    std::vector<MultiViewSequence>* multiViewSequences)
+{
+    const StringList files(fileNames, fileNames + count);
+    std::string context;
+
+    for (size_t i = 0; i < count; ++i) {
+        context += (i ? " " : "") + files[i];
+    }
+    groupMultiViewFiles(files, sequences, multiViewSequences, context);
+}
+
+///l/r, left/right and viewN names are merged in a single multi-view sequence
+void
+testMultiView()
+{
+    const char* const shortViews[] = { "/p/a_l.0001.exr", "/p/a_l.0002.exr", "/p/a_r.0001.exr", "/p/a_r.0002.exr" };
+    std::vector<SequenceFromFiles> sequences;
+    std::vector<MultiViewSequence> multiViewSequences;
+
+    groupMultiViewFiles(shortViews, 4, &sequences, &multiViewSequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 0u);
+    SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences.size(), 1u);
+    if (multiViewSequences.size() == 1) {
+        SEQUENCEPARSING_CHECK_EQUAL( multiViewSequences[0].pattern, std::string("/p/a_%v.####.exr") );
+        SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences[0].sequence.size(), 2u);
+    }
+
+    const char* const longViews[] = {
+        "/p/a_left.0001.exr", "/p/a_right.0001.exr", "/p/a_left.0002.exr", "/p/b.0001.exr", "/p/a_right.0002.exr"
+    };
+    sequences.clear();
+    multiViewSequences.clear();
+    groupMultiViewFiles(longViews, 5, &sequences, &multiViewSequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 1u);
+    SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences.size(), 1u);
+    if (multiViewSequences.size() == 1) {
+        SEQUENCEPARSING_CHECK_EQUAL( multiViewSequences[0].pattern, std::string("/p/a_%V.####.exr") );
+    }
+
+    const char* const numberedViews[] = { "/p/a_view0.0001.exr", "/p/a_view1.0001.exr", "/p/a_view0.0002.exr", "/p/a_view1.0002.exr" };
+    sequences.clear();
+    multiViewSequences.clear();
+    groupMultiViewFiles(numberedViews, 4, &sequences, &multiViewSequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 0u);
+    SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences.size(), 1u);
+    if (multiViewSequences.size() == 1) {
+        SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences[0].sequence.size(), 2u);
+        if ( !multiViewSequences[0].sequence.empty() ) {
+            SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences[0].sequence.begin()->second.size(), 2u);
+        }
+    }
+
+    ///A single view is not merged
+    const char* const singleView[] = { "/p/a_left.0001.exr", "/p/a_left.0002.exr" };
+    sequences.clear();
+    multiViewSequences.clear();
+    groupMultiViewFiles(singleView, 2, &sequences, &multiViewSequences);
+    SEQUENCEPARSING_CHECK_EQUAL(sequences.size(), 1u);
+    SEQUENCEPARSING_CHECK_EQUAL(multiViewSequences.size(), 0u);
+
+    ///Names without frame numbers
+    const char* const framelessViews[] = { "/p/a_left.exr", "/p/a_right.exr", "/p/notes.txt", "/p/a_view0.exr", "/p/a_view1.exr" };
+    sequences.clear();
+    multiViewSequences.clear();
+    groupMultiViewFiles(framelessViews, 5, &sequences, &multiViewSequences);
+}
+
+///viewN and view0N names give the same view number: no file may be lost
+void
+testMultiViewCollisions()
+{
+    const char* const collidingViews[] = { "/p/a_view1.0001.exr", "/p/a_view01.0001.exr", "/p/a_view0.0001.exr" };
+    std::vector<SequenceFromFiles> sequences;
+    std::vector<MultiViewSequence> multiViewSequences;
+
+    groupMultiViewFiles(collidingViews, 3, &sequences, &multiViewSequences);
+
+    ///The leftover viewN file used to join a sequence already merged and vanish from both outputs
+    const char* const mergedLeftover[] = {
+        "/p/a_right.0001.exr", "/p/a_view0.0002.exr", "/p/a_view1.0001.exr", "/p/a_view2.0002.exr", "/p/a_view00.0002.exr"
+    };
+    sequences.clear();
+    multiViewSequences.clear();
+    groupMultiViewFiles(mergedLeftover, 5, &sequences, &multiViewSequences);
+
+    ///Random mixes of colliding view names, frames and unrelated files
+    const char* const viewNames[] = { "l", "r", "left", "right", "view0", "view1", "view2", "view00", "view01", "view001", "view10" };
+    const char* const prefixes[] = { "/p/a_", "/p/b_", "/p/a.", "/q/a_" };
+    const char* const suffixes[] = { ".0001.exr", ".0002.exr", ".0003.exr", ".exr", "_0001.exr", ".0002.dpx" };
+    unsigned int seed = 12345;
+    for (int run = 0; run < 200; ++run) {
+        std::set<std::string> names;
+        const int count = 1 + run % 24;
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            const unsigned int r = seed >> 8;
+            names.insert( std::string(prefixes[r % 4]) + viewNames[(r / 4) % 11] + suffixes[(r / 44) % 6] );
+        }
+        StringList files( names.begin(), names.end() );
+        // The order of the names matters to the grouping: shuffle them
+        for (size_t i = files.size(); i > 1; --i) {
+            seed = seed * 1103515245u + 12345u;
+            std::swap( files[i - 1], files[(seed >> 8) % i] );
+        }
+        std::stringstream context;
+        context << "run " << run;
+        sequences.clear();
+        multiViewSequences.clear();
+        groupMultiViewFiles(files, &sequences, &multiViewSequences, context.str() );
+    }
+}
+} // namespace {
+
+int
+main()
+{
+    testNumericExtensions();
+    testTextExtensions();
+    testMultiView();
+    testMultiViewCollisions();
+
+    return SequenceParsingTests::testsResult("GroupingTests");
+}
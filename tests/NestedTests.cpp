@@ -0,0 +1,119 @@
+/*
+   Checks filesListFromPattern_nested on files created in a temporary directory.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+using namespace SequenceParsing;
+using SequenceParsingTests::writeFile;
+
+namespace {
+///Returns the file of the frame and view, or an empty string
+std::string
+getFile(const SequenceFromPattern& sequence,
+        int frameNumber,
+        int viewNumber)
+{
+    SequenceFromPattern::const_iterator found = sequence.find(frameNumber);
+
+    if ( found == sequence.end() ) {
+        return std::string();
+    }
+    std::map<int, std::string>::const_iterator foundView = found->second.find(viewNumber);
+
+    return foundView == found->second.end() ? std::string() : foundView->second;
+}
+
+///A directory name with a '.' is matched whole: its frame number is not taken for an extension
+void
+testDottedDirectory(const std::string& root)
+{
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/shot.0001/a.exr", "1") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/shot.0002/a.exr", "2") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/shot.0002/b.exr", "b") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/shot.extra/a.exr", "e") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/s_0001/a.exr", "1") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "x/s_0003/a.exr", "3") );
+
+    SequenceFromPattern sequence;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_nested(root + "x/shot.####/a.exr", &sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(sequence.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 1, 0), root + "x/shot.0001/a.exr" );
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 2, 0), root + "x/shot.0002/a.exr" );
+
+    sequence.clear();
+    SEQUENCEPARSING_CHECK( filesListFromPattern_nested(root + "x/s_####/a.exr", &sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(sequence.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 3, 0), root + "x/s_0003/a.exr" );
+}
+
+///The frame number must be the same in all the components where it appears
+void
+testFrameConsistency(const std::string& root)
+{
+    SEQUENCEPARSING_CHECK( writeFile(root + "renders/0001/shot.0001.exr", "1") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "renders/0001/shot.0002.exr", "wrong") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "renders/0002/shot.0002.exr", "2") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "renders/0003/shot.0001.exr", "wrong") );
+
+    SequenceFromPattern sequence;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_nested(root + "renders/####/shot.####.exr", &sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(sequence.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 1, 0), root + "renders/0001/shot.0001.exr" );
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 2, 0), root + "renders/0002/shot.0002.exr" );
+    SEQUENCEPARSING_CHECK( getFile(sequence, 3, 0).empty() );
+
+    ///Literal directories after a variable one
+    SEQUENCEPARSING_CHECK( writeFile(root + "cache/0005/beauty/a.0005.exr", "5") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "cache/0006/other/a.0006.exr", "6") );
+    sequence.clear();
+    SEQUENCEPARSING_CHECK( filesListFromPattern_nested(root + "cache/####/beauty/a.####.exr", &sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(sequence.size(), 1u);
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 5, 0), root + "cache/0005/beauty/a.0005.exr" );
+}
+
+///The view must be the same in all the components where it appears
+void
+testViews(const std::string& root)
+{
+    SEQUENCEPARSING_CHECK( writeFile(root + "views/left/shot_left.0001.exr", "l") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "views/right/shot_right.0001.exr", "r") );
+    SEQUENCEPARSING_CHECK( writeFile(root + "views/right/shot_left.0001.exr", "wrong") );
+
+    SequenceFromPattern sequence;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_nested(root + "views/%V/shot_%V.####.exr", &sequence) );
+    SEQUENCEPARSING_CHECK_EQUAL(sequence.size(), 1u);
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 1, 0), root + "views/left/shot_left.0001.exr" );
+    SEQUENCEPARSING_CHECK_EQUAL( getFile(sequence, 1, 1), root + "views/right/shot_right.0001.exr" );
+    if ( !sequence.empty() ) {
+        SEQUENCEPARSING_CHECK_EQUAL(sequence.begin()->second.size(), 2u);
+    }
+}
+
+void
+testMissingDirectory(const std::string& root)
+{
+    SequenceFromPattern sequence;
+
+    SEQUENCEPARSING_CHECK( !filesListFromPattern_nested(root + "missing/####/a.exr", &sequence) );
+    SEQUENCEPARSING_CHECK( !filesListFromPattern_nested("", &sequence) );
+    SEQUENCEPARSING_CHECK( sequence.empty() );
+}
+} // namespace {
+
+int
+main()
+{
+    SequenceParsingTests::TemporaryDirectory directory;
+
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testDottedDirectory( directory.path() );
+        testFrameConsistency( directory.path() );
+        testViews( directory.path() );
+        testMissingDirectory( directory.path() );
+    }
+
+    return SequenceParsingTests::testsResult("NestedTests");
+}
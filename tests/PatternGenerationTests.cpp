@@ -0,0 +1,343 @@
+/*
+   Checks the generation of patterns from file names, the cache of FileNameContent::getFilePattern shared by concurrent
+   readers, and that the cost of the generation stays linear in the length of the names on an adversarial corpus:
+   names with hundreds of numbers, names of 4 KB, and paths repeating the same fragment.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <cstdio>
+#include <ctime>
+#if __cplusplus >= 201103L
+#include <thread>
+#endif
+
+using namespace SequenceParsing;
+
+namespace {
+///The largest names of the corpus are this many times longer than the smallest ones
+#define PATTERN_GENERATION_SCALE_FACTOR 16
+
+///The cost of the largest names must be at most this many times the cost of the smallest ones. Linear growth gives
+///at most PATTERN_GENERATION_SCALE_FACTOR, less when a fixed cost dominates the smallest names, while the quadratic
+///pattern generation this test was written for exceeded it by half.
+#define PATTERN_GENERATION_MAX_COST_RATIO (1.25 * PATTERN_GENERATION_SCALE_FACTOR)
+
+///The minimum CPU time spent on each corpus entry, so that the measure is not dominated by the clock resolution
+#define PATTERN_GENERATION_MIN_SECONDS 0.1
+
+std::string
+formatNumber(int number,
+             int width)
+{
+    char buf[32];
+
+    std::snprintf(buf, sizeof(buf), "%0*d", width, number);
+
+    return buf;
+}
+
+///e.g: /shots/take_001_002_..._<runsCount>.<frame>.exr
+std::string
+makeDigitRunsName(int runsCount,
+                  int frame)
+{
+    std::string ret = "/shots/take";
+
+    for (int i = 0; i < runsCount; ++i) {
+        ret += "_" + formatNumber(i % 1000, 3);
+    }
+
+    return ret + "." + formatNumber(frame, 4) + ".exr";
+}
+
+///e.g: /shots/aaaa...aaaa.<frame>.exr with charactersCount letters
+std::string
+makeLongName(int charactersCount,
+             int frame)
+{
+    return "/shots/" + std::string(charactersCount, 'a') + "." + formatNumber(frame, 4) + ".exr";
+}
+
+///e.g: /shot_010/shot_010/.../shot_010_v2.<frame>.exr with fragmentsCount directories
+std::string
+makeRepeatedPathName(int fragmentsCount,
+                     int frame)
+{
+    std::string ret;
+
+    for (int i = 0; i < fragmentsCount; ++i) {
+        ret += "/shot_010";
+    }
+
+    return ret + "/shot_010_v2." + formatNumber(frame, 4) + ".exr";
+}
+
+///e.g: /shots/12345678901x12345678901x...<frame>.exr with numbers too large to be frame numbers
+std::string
+makeLongDigitRunsName(int runsCount,
+                      int frame)
+{
+    std::string ret = "/shots/";
+
+    for (int i = 0; i < runsCount; ++i) {
+        ret += "12345678901x";
+    }
+
+    return ret + formatNumber(frame, 4) + ".exr";
+}
+
+typedef std::string (*CorpusGenerator)(int scale, int frame);
+
+struct CorpusEntry
+{
+    const char* name;
+    CorpusGenerator generator;
+    int smallScale; //< the largest scale is PATTERN_GENERATION_SCALE_FACTOR times this one
+};
+
+const CorpusEntry corpus[] = {
+    { "hundreds of digit runs", makeDigitRunsName, 50 }, // 800 numbers, 4 KB
+    { "4 KB name", makeLongName, 256 },
+    { "repeated path fragments", makeRepeatedPathName, 28 }, // 4 KB of path
+    { "long digit runs", makeLongDigitRunsName, 21 } // 4 KB
+};
+
+///The objects the operations of a name are measured on, built once
+struct NameFixture
+{
+    std::string fileName;
+    std::string nextFrameFileName;
+    FileNameContent content;
+    FileNameContent nextFrame;
+    int lastIndex; //< the index of the frame number
+    int frameNumber;
+    std::string pattern; //< the absolute pattern with the last number as frame number
+
+    NameFixture(const CorpusEntry& entry,
+                int scale)
+        : fileName( entry.generator(scale, 41) )
+        , nextFrameFileName( entry.generator(scale, 42) )
+        , content(fileName)
+        , nextFrame(nextFrameFileName)
+        , lastIndex(content.getPotentialFrameNumbersCount() - 1)
+        , frameNumber(41)
+        , pattern()
+    {
+        content.generatePatternWithFrameNumberAtIndex(lastIndex, 4, &pattern);
+    }
+};
+
+///The operations a file dialog runs on a name, each returns a value depending on its result
+typedef std::size_t (*NameOperation)(const NameFixture& fixture);
+
+std::size_t
+tokenize(const NameFixture& fixture)
+{
+    return FileNameContent(fixture.fileName).getPotentialFrameNumbersCount();
+}
+
+std::size_t
+generatePattern(const NameFixture& fixture)
+{
+    std::string pattern;
+
+    fixture.content.generatePatternWithFrameNumberAtIndex(fixture.lastIndex, 4, &pattern);
+
+    return pattern.size();
+}
+
+std::size_t
+generateFileName(const NameFixture& fixture)
+{
+    return generateFileNameFromPattern(fixture.pattern, std::vector<std::string>(), fixture.frameNumber, 0).size();
+}
+
+std::size_t
+matchPattern(const NameFixture& fixture)
+{
+    int numberIndexToVary = -1;
+
+    return fixture.nextFrame.matchesPattern(fixture.content, &numberIndexToVary) ? numberIndexToVary + 1 : 0;
+}
+
+std::size_t
+listFiles(const NameFixture& fixture)
+{
+    StringList files;
+
+    files.push_back( fixture.content.fileName() );
+    files.push_back( fixture.nextFrame.fileName() );
+    SequenceFromPattern sequence;
+    filesListFromPattern_fast(fixture.pattern, files, &sequence);
+
+    return sequence.size();
+}
+
+struct NamedOperation
+{
+    const char* name;
+    NameOperation operation;
+};
+
+const NamedOperation operations[] = {
+    { "tokenizing", tokenize },
+    { "pattern generation", generatePattern },
+    { "file name generation", generateFileName },
+    { "matching", matchPattern },
+    { "listing", listFiles }
+};
+
+///Returns the CPU time in seconds of a call to the operation
+double
+measureCost(NameOperation operation,
+            const NameFixture& fixture)
+{
+    std::size_t result = 0;
+    int callsCount = 0;
+    const std::clock_t start = std::clock();
+    double seconds = 0.;
+
+    do {
+        result += operation(fixture);
+        ++callsCount;
+        seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    } while (seconds < PATTERN_GENERATION_MIN_SECONDS);
+    // Uses the results so that the calls are not optimized out
+    SEQUENCEPARSING_CHECK(result > 0);
+
+    return seconds / callsCount;
+}
+
+///Keeping a number other than the last one used to garble the pattern
+void
+testFrameNumberIndex()
+{
+    FileNameContent content("/a/b/file001_0002.exr");
+    std::string pattern;
+
+    content.generatePatternWithFrameNumberAtIndex(0, 1, &pattern);
+    SEQUENCEPARSING_CHECK_EQUAL( pattern, std::string("/a/b/file#_0002.exr") );
+    content.generatePatternWithFrameNumberAtIndex(0, 3, &pattern);
+    SEQUENCEPARSING_CHECK_EQUAL( pattern, std::string("/a/b/file###_0002.exr") );
+    content.generatePatternWithFrameNumberAtIndex(1, 4, &pattern);
+    SEQUENCEPARSING_CHECK_EQUAL( pattern, std::string("/a/b/file001_####.exr") );
+}
+
+///The indexes of the numbers of the pattern have several digits from the tenth number on
+void
+testManyNumbers()
+{
+    std::string fileName = "/d/";
+
+    for (int i = 0; i < 12; ++i) {
+        fileName += "x" + formatNumber(i * 7, 2);
+    }
+    fileName += ".exr";
+    FileNameContent content(fileName);
+    SEQUENCEPARSING_CHECK_EQUAL(content.getPotentialFrameNumbersCount(), 12);
+    for (int i = 0; i < 12; ++i) {
+        std::string pattern;
+        content.generatePatternWithFrameNumberAtIndex(i, 2, &pattern);
+        std::string expected = "/d/";
+        for (int j = 0; j < 12; ++j) {
+            expected += "x" + ( (j == i) ? std::string("##") : formatNumber(j * 7, 2) );
+        }
+        expected += ".exr";
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(pattern, expected, fileName);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(generateFileNameFromPattern(pattern, std::vector<std::string>(), i * 7, 0),
+                                            fileName, pattern);
+    }
+}
+
+///Each number of hashes has its own cached pattern
+void
+testFilePatternCache()
+{
+    FileNameContent content("/a/b/file001_0002.exr");
+    const std::string& onePattern = content.getFilePattern(1);
+    const std::string& fourPattern = content.getFilePattern(4);
+
+    SEQUENCEPARSING_CHECK_EQUAL( onePattern, std::string("file#0_#1.exr") );
+    SEQUENCEPARSING_CHECK_EQUAL( fourPattern, std::string("file####0_####1.exr") );
+    SEQUENCEPARSING_CHECK_EQUAL( content.getFilePattern(-1), std::string("file0_1.exr") );
+    SEQUENCEPARSING_CHECK( &content.getFilePattern(1) == &onePattern );
+    SEQUENCEPARSING_CHECK( &content.getFilePattern(0) == &content.getFilePattern(-1) );
+
+    FileNameContent copy("/c/other.exr");
+    copy = content;
+    SEQUENCEPARSING_CHECK_EQUAL( copy.getFilePattern(4), fourPattern );
+    SEQUENCEPARSING_CHECK_EQUAL( copy.getFilePattern(2), std::string("file##0_##1.exr") );
+
+#if __cplusplus >= 201103L
+    // Readers share an object whose patterns are generated concurrently
+    FileNameContent shared("/a/b/file001_0002.exr");
+    std::vector<std::thread> threads;
+    std::vector<int> mismatchesCount(8, 0);
+    for (int t = 0; t < 8; ++t) {
+        threads.push_back( std::thread([&shared, &mismatchesCount, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                const int numHashes = (i + t) % 16;
+                const std::string expected = "file" + std::string(numHashes, '#') + "0_" + std::string(numHashes, '#') + "1.exr";
+                if (shared.getFilePattern(numHashes) != expected) {
+                    ++mismatchesCount[t];
+                }
+            }
+        }) );
+    }
+    for (std::size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+        SEQUENCEPARSING_CHECK_EQUAL(mismatchesCount[t], 0);
+    }
+#endif
+}
+
+///The largest names of the corpus are processed correctly
+void
+testCorpusResults()
+{
+    for (std::size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); ++i) {
+        const NameFixture fixture(corpus[i], corpus[i].smallScale * PATTERN_GENERATION_SCALE_FACTOR);
+        std::string expectedPattern = fixture.fileName;
+        expectedPattern.replace(expectedPattern.size() - 8, 4, "####");
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(fixture.pattern, expectedPattern, corpus[i].name);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(generateFileNameFromPattern(fixture.pattern, std::vector<std::string>(),
+                                                                        fixture.frameNumber, 0),
+                                            fixture.fileName, corpus[i].name);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(matchPattern(fixture), (std::size_t)fixture.lastIndex + 1, corpus[i].name);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(listFiles(fixture), 2u, corpus[i].name);
+    }
+}
+
+///The cost of each operation on a name grows linearly with the length of the name
+void
+testCorpusScaling()
+{
+    for (std::size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); ++i) {
+        const NameFixture smallFixture(corpus[i], corpus[i].smallScale);
+        const NameFixture largeFixture(corpus[i], corpus[i].smallScale * PATTERN_GENERATION_SCALE_FACTOR);
+        for (std::size_t j = 0; j < sizeof(operations) / sizeof(operations[0]); ++j) {
+            const double smallCost = measureCost(operations[j].operation, smallFixture);
+            const double largeCost = measureCost(operations[j].operation, largeFixture);
+            const double ratio = largeCost / smallCost;
+            const std::string context = std::string(corpus[i].name) + ", " + operations[j].name;
+            std::cout << context << ": " << smallCost * 1e6 << " us, " << PATTERN_GENERATION_SCALE_FACTOR
+                      << " times longer: " << largeCost * 1e6 << " us (x" << ratio << ")" << std::endl;
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(ratio < PATTERN_GENERATION_MAX_COST_RATIO, true, context);
+        }
+    }
+}
+} // anon
+
+int
+main()
+{
+    testFrameNumberIndex();
+    testManyNumbers();
+    testFilePatternCache();
+    testCorpusResults();
+    testCorpusScaling();
+
+    return SequenceParsingTests::testsResult("PatternGenerationTests");
+}
@@ -0,0 +1,288 @@
+/*
+   Checks planSequenceRename and executeSequenceRename on files created in a temporary directory: after the renames,
+   every file must have the content of the file it was renamed from, and no file may be left behind.
+ */
+
+#include <algorithm>
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+using namespace SequenceParsing;
+using SequenceParsingTests::fileExists;
+using SequenceParsingTests::readFile;
+using SequenceParsingTests::writeFile;
+
+namespace {
+///The length of the chains of renames in the library, SEQUENCEPARSING_MAX_RENAME_CHAIN_LENGTH
+const std::size_t maxChainLength = 256;
+
+std::string
+getContent(int frameNumber,
+           int viewNumber)
+{
+    std::stringstream ss;
+
+    ss << "frame " << frameNumber << " view " << viewNumber;
+
+    return ss.str();
+}
+
+/*
+   Writes the frames [first, last] of the views of the pattern, each file containing its frame and view numbers,
+   and returns their sequence.
+ */
+SequenceFromPattern
+writeSequence(const std::string& pattern,
+              const std::vector<std::string>& viewNames,
+              int first,
+              int last)
+{
+    SequenceFromPattern sequence;
+    const int viewsCount = viewNames.empty() ? 1 : (int)viewNames.size();
+
+    for (int frame = first; frame <= last; ++frame) {
+        for (int view = 0; view < viewsCount; ++view) {
+            const std::string filename = generateFileNameFromPattern(pattern, viewNames, frame, view);
+            SEQUENCEPARSING_CHECK( writeFile( filename, getContent(frame, view) ) );
+            sequence[frame][view] = filename;
+        }
+    }
+
+    return sequence;
+}
+
+std::size_t
+countFiles(const std::string& directory)
+{
+    FileTable table;
+
+    SEQUENCEPARSING_CHECK( table.appendDirectory(directory) );
+
+    return table.size();
+}
+
+/*
+   Executes the plan and checks that the file of each frame of the sequence was moved to its new frame number
+   (frameMapping, or frameOffset for the frames not in it), and that the directory holds filesCount files.
+ */
+void
+checkRename(const SequenceRenamePlan& plan,
+            const SequenceFromPattern& sequence,
+            const std::string& newPattern,
+            const std::vector<std::string>& viewNames,
+            const std::map<int, int>& frameMapping,
+            int frameOffset,
+            int threadsCount,
+            const std::string& directory,
+            std::size_t filesCount)
+{
+    std::vector<FileRename> failedRenames;
+
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(executeSequenceRename(plan, threadsCount, &failedRenames), true, plan.toString());
+    SEQUENCEPARSING_CHECK( failedRenames.empty() );
+    for (SequenceFromPattern::const_iterator it = sequence.begin(); it != sequence.end(); ++it) {
+        std::map<int, int>::const_iterator found = frameMapping.find(it->first);
+        const int newFrame = found != frameMapping.end() ? found->second : it->first + frameOffset;
+        for (std::map<int, std::string>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            const std::string filename = generateFileNameFromPattern(newPattern, viewNames, newFrame, it2->first);
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( readFile(filename), getContent(it->first, it2->first), filename );
+        }
+    }
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(directory), filesCount);
+}
+
+std::size_t
+getLongestChainLength(const SequenceRenamePlan& plan)
+{
+    std::size_t ret = 0;
+
+    for (std::size_t i = 0; i < plan.chains.size(); ++i) {
+        ret = std::max( ret, plan.chains[i].size() );
+    }
+
+    return ret;
+}
+
+///Swapping frames and rotating 3 frames need temporary names
+void
+testCycles(const std::string& root)
+{
+    const std::string directory = root + "cycles/";
+    const std::string pattern = directory + "shot.####.exr";
+    const std::vector<std::string> viewNames;
+    const SequenceFromPattern sequence = writeSequence(pattern, viewNames, 1, 6);
+
+    std::map<int, int> frameMapping;
+    frameMapping[1] = 2;
+    frameMapping[2] = 1;
+    frameMapping[3] = 4;
+    frameMapping[4] = 5;
+    frameMapping[5] = 3;
+    SequenceRenamePlan plan;
+    SEQUENCEPARSING_CHECK( planSequenceRename(sequence, pattern, viewNames, frameMapping, &plan) );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.toTemporary.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.fromTemporary.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.getRenamesCount(), 5u + 2u);
+    ///frame 6 keeps its name
+    checkRename(plan, sequence, pattern, viewNames, frameMapping, 0, 4, directory, 6);
+    SEQUENCEPARSING_CHECK_EQUAL( readFile(directory + "shot.0006.exr"), getContent(6, 0) );
+
+    ///A file already has the first temporary name
+    const std::string stranger = directory + "shot.0001.exr.renaming";
+    SEQUENCEPARSING_CHECK( writeFile(stranger, "stranger") );
+    const SequenceFromPattern swapped = writeSequence(pattern, viewNames, 1, 2);
+    frameMapping.clear();
+    frameMapping[1] = 2;
+    frameMapping[2] = 1;
+    SEQUENCEPARSING_CHECK( planSequenceRename(swapped, pattern, viewNames, frameMapping, &plan) );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.toTemporary.size(), 1u);
+    checkRename(plan, swapped, pattern, viewNames, frameMapping, 0, 1, directory, 7);
+    SEQUENCEPARSING_CHECK_EQUAL( readFile(stranger), std::string("stranger") );
+}
+
+///Offsets of +1 and -1: each file takes the name of its neighbour, in both views
+void
+testOverlappingOffsets(const std::string& root)
+{
+    const std::string directory = root + "offsets/";
+    const std::string pattern = directory + "shot_%V.####.exr";
+    std::vector<std::string> viewNames;
+    viewNames.push_back("left");
+    viewNames.push_back("right");
+    const SequenceFromPattern sequence = writeSequence(pattern, viewNames, 1, 10);
+    const std::map<int, int> noMapping;
+
+    SequenceRenamePlan plan;
+    SEQUENCEPARSING_CHECK( planSequenceRename(sequence, pattern, viewNames, 1, &plan) );
+    SEQUENCEPARSING_CHECK( plan.toTemporary.empty() );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.chains.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.getRenamesCount(), 20u);
+    checkRename(plan, sequence, pattern, viewNames, noMapping, 1, 4, directory, 20);
+    SEQUENCEPARSING_CHECK( !fileExists(directory + "shot_left.0001.exr") );
+
+    ///and back
+    SequenceFromPattern moved;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_slow(pattern, &moved) );
+    SEQUENCEPARSING_CHECK_EQUAL(moved.size(), 10u);
+    SEQUENCEPARSING_CHECK( planSequenceRename(moved, pattern, viewNames, -1, &plan) );
+    SEQUENCEPARSING_CHECK( plan.toTemporary.empty() );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.getRenamesCount(), 20u);
+    SEQUENCEPARSING_CHECK( executeSequenceRename(plan, 1) );
+    for (int frame = 1; frame <= 10; ++frame) {
+        for (int view = 0; view < 2; ++view) {
+            const std::string filename = generateFileNameFromPattern(pattern, viewNames, frame, view);
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( readFile(filename), getContent(frame, view), filename );
+        }
+    }
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(directory), 20u);
+
+    ///to a new pattern, in another directory
+    const std::string newPattern = root + "offsets_renamed/s.%04d.%v.exr";
+    SEQUENCEPARSING_CHECK( SequenceParsingTests::makeDirectories(root + "offsets_renamed/") );
+    SEQUENCEPARSING_CHECK( planSequenceRename(sequence, newPattern, viewNames, 1, &plan) );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.getRenamesCount(), 20u);
+    checkRename(plan, sequence, newPattern, viewNames, noMapping, 1, 4, root + "offsets_renamed/", 20);
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(directory), 0u);
+}
+
+///Renumbering a long sequence by one frame splits the chain every maxChainLength renames
+void
+testLongChains(const std::string& root)
+{
+    const std::string directory = root + "chains/";
+    const std::string pattern = directory + "shot.####.exr";
+    const std::vector<std::string> viewNames;
+    const std::map<int, int> noMapping;
+    const int framesCount = 2 * (int)maxChainLength + 88;
+    const SequenceFromPattern sequence = writeSequence(pattern, viewNames, 1, framesCount);
+
+    SequenceRenamePlan plan;
+    SEQUENCEPARSING_CHECK( planSequenceRename(sequence, pattern, viewNames, 1, &plan) );
+    SEQUENCEPARSING_CHECK_EQUAL(getLongestChainLength(plan), maxChainLength);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.toTemporary.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.chains.size(), 3u);
+    SEQUENCEPARSING_CHECK_EQUAL(plan.getRenamesCount(), (std::size_t)framesCount + 2);
+    checkRename(plan, sequence, pattern, viewNames, noMapping, 1, 4, directory, framesCount);
+
+    ///a chain of exactly maxChainLength renames is not split
+    const std::string exactDirectory = root + "exact_chain/";
+    const std::string exactPattern = exactDirectory + "shot.####.exr";
+    const SequenceFromPattern exact = writeSequence(exactPattern, viewNames, 1, (int)maxChainLength);
+    SEQUENCEPARSING_CHECK( planSequenceRename(exact, exactPattern, viewNames, -1, &plan) );
+    SEQUENCEPARSING_CHECK( plan.toTemporary.empty() );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.chains.size(), 1u);
+    checkRename(plan, exact, exactPattern, viewNames, noMapping, -1, 1, exactDirectory, maxChainLength);
+
+    ///the cycle of a long rotation is split too
+    std::map<int, int> rotation;
+    for (int frame = 0; frame < framesCount; ++frame) {
+        rotation[frame + 2] = frame == framesCount - 1 ? 2 : frame + 3;
+    }
+    SequenceFromPattern moved;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_slow(pattern, &moved) );
+    SEQUENCEPARSING_CHECK( planSequenceRename(moved, pattern, viewNames, rotation, &plan) );
+    SEQUENCEPARSING_CHECK( getLongestChainLength(plan) <= maxChainLength );
+    SEQUENCEPARSING_CHECK_EQUAL(plan.toTemporary.size(), 3u);
+    SEQUENCEPARSING_CHECK( executeSequenceRename(plan, 4) );
+    for (int frame = 0; frame < framesCount; ++frame) {
+        const std::string filename = generateFileNameFromPattern(pattern, viewNames, rotation[frame + 2], 0);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( readFile(filename), getContent(frame + 1, 0), filename );
+    }
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(directory), (std::size_t)framesCount);
+}
+
+///The plans overwriting a file are rejected, and nothing is renamed
+void
+testRejectedTargets(const std::string& root)
+{
+    const std::string directory = root + "rejected/";
+    const std::string pattern = directory + "shot.####.exr";
+    const std::vector<std::string> viewNames;
+    const SequenceFromPattern sequence = writeSequence(pattern, viewNames, 1, 10);
+    SEQUENCEPARSING_CHECK( writeFile(directory + "shot.0011.exr", "stranger") );
+    SequenceRenamePlan plan;
+
+    ///taken by a file which is not part of the sequence
+    SEQUENCEPARSING_CHECK( !planSequenceRename(sequence, pattern, viewNames, 1, &plan) );
+
+    ///taken by a file of the sequence which keeps its name
+    std::map<int, int> frameMapping;
+    frameMapping[1] = 2;
+    SEQUENCEPARSING_CHECK( !planSequenceRename(sequence, pattern, viewNames, frameMapping, &plan) );
+
+    ///two files renamed to the same name
+    frameMapping[2] = 12;
+    frameMapping[3] = 12;
+    SEQUENCEPARSING_CHECK( !planSequenceRename(sequence, pattern, viewNames, frameMapping, &plan) );
+
+    ///in a directory that cannot be listed
+    SEQUENCEPARSING_CHECK( !planSequenceRename(sequence, root + "missing/shot.####.exr", viewNames, 0, &plan) );
+
+    ///but a free name is accepted
+    SEQUENCEPARSING_CHECK( planSequenceRename(sequence, pattern, viewNames, -1, &plan) );
+
+    for (int frame = 1; frame <= 10; ++frame) {
+        const std::string filename = generateFileNameFromPattern(pattern, viewNames, frame, 0);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( readFile(filename), getContent(frame, 0), filename );
+    }
+    SEQUENCEPARSING_CHECK_EQUAL( readFile(directory + "shot.0011.exr"), std::string("stranger") );
+    SEQUENCEPARSING_CHECK_EQUAL(countFiles(directory), 11u);
+}
+} // namespace {
+
+int
+main()
+{
+    SequenceParsingTests::TemporaryDirectory directory;
+
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testCycles( directory.path() );
+        testOverlappingOffsets( directory.path() );
+        testLongChains( directory.path() );
+        testRejectedTargets( directory.path() );
+    }
+
+    return SequenceParsingTests::testsResult("RenameTests");
+}
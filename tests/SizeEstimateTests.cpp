@@ -0,0 +1,345 @@
+/*
+   Checks estimateSequenceSize and SequenceSizeEstimator on files of known sizes created in a temporary directory.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <cmath>
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <chrono>
+#include <thread>
+#endif
+
+using namespace SequenceParsing;
+using SequenceParsingTests::writeFile;
+
+namespace {
+///The z-score of a 95% two-sided confidence interval
+const double kZScore95 = 1.959964;
+
+/*
+   Writes the frames 1 to sizes.size() of directory/shot.####.exr with the sizes, a negative size being a file of
+   the sequence that does not exist.
+ */
+SequenceFromPattern
+writeSizedSequence(const std::string& directory,
+                   const std::vector<long long>& sizes)
+{
+    SequenceFromPattern sequence;
+    const std::string pattern = directory + "shot.####.exr";
+
+    SEQUENCEPARSING_CHECK( SequenceParsingTests::makeDirectories(directory) );
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        const std::string filename = generateFileNameFromPattern(pattern, std::vector<std::string>(), (int)i + 1, 0);
+        if (sizes[i] >= 0) {
+            SEQUENCEPARSING_CHECK( writeFile( filename, std::string( (std::size_t)sizes[i], 'x' ) ) );
+        }
+        sequence[(int)i + 1][0] = filename;
+    }
+
+    return sequence;
+}
+
+unsigned long long
+getTotalSize(const std::vector<long long>& sizes)
+{
+    unsigned long long ret = 0;
+
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        ret += sizes[i] > 0 ? (unsigned long long)sizes[i] : 0;
+    }
+
+    return ret;
+}
+
+/*
+   Checks the estimate against the mean of the sizes of the files at sampledIndexes, extrapolated to all the files,
+   with its confidence interval reduced by the finite population correction.
+ */
+void
+checkEstimate(const SequenceSizeEstimate& estimate,
+              const std::vector<long long>& sizes,
+              const std::vector<std::size_t>& sampledIndexes,
+              const std::string& context)
+{
+    double sum = 0;
+    double squaresSum = 0;
+    std::size_t readCount = 0;
+
+    for (std::size_t i = 0; i < sampledIndexes.size(); ++i) {
+        const long long size = sizes[sampledIndexes[i]];
+        if (size >= 0) {
+            sum += (double)size;
+            squaresSum += (double)size * (double)size;
+            ++readCount;
+        }
+    }
+    const double filesCount = (double)sizes.size();
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.filesCount, sizes.size(), context);
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.sizedFilesCount, sampledIndexes.size(), context);
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.exact, false, context);
+    if (readCount == 0) {
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.estimatedSize, 0ULL, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.upperBound, ~0ULL, context);
+
+        return;
+    }
+    const double mean = sum / (double)readCount;
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( estimate.estimatedSize, (unsigned long long)(mean * filesCount + 0.5), context );
+    if (readCount < 2) {
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.upperBound, ~0ULL, context);
+
+        return;
+    }
+    const double variance = (squaresSum - sum * mean) / ( (double)readCount - 1. );
+    const double correction = 1. - (double)sampledIndexes.size() / filesCount;
+    const double margin = kZScore95 * filesCount * std::sqrt(variance / (double)readCount * correction);
+    const double tolerance = margin * 1e-3 + 1.;
+    const double lowerBound = std::max(sum, mean * filesCount - margin);
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(std::fabs( (double)estimate.lowerBound - lowerBound ) <= tolerance, true, context);
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(std::fabs( (double)estimate.upperBound - (mean * filesCount + margin) ) <= tolerance, true, context);
+}
+
+std::vector<std::size_t>
+makeIndexes(const std::size_t* indexes,
+            std::size_t count)
+{
+    return std::vector<std::size_t>(indexes, indexes + count);
+}
+
+std::string
+getContext(const char* name,
+           std::size_t samplesCount)
+{
+    std::stringstream ss;
+
+    ss << name << " with " << samplesCount << " samples";
+
+    return ss.str();
+}
+
+///The files are sampled in the van der Corput order of their indexes: 0, 8, 4, 12, 2, 10... for 16 files
+void
+testSpreadOrder(const std::string& root)
+{
+    ///sizes that are distinct powers of 2, so that the estimate tells which files were sampled
+    std::vector<long long> sizes;
+    for (int i = 0; i < 16; ++i) {
+        sizes.push_back(1LL << i);
+    }
+    const SequenceFromPattern sequence = writeSizedSequence(root + "order16/", sizes);
+    const std::size_t order16[] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+    for (std::size_t samplesCount = 1; samplesCount < 16; ++samplesCount) {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(sequence, samplesCount, &estimate);
+        checkEstimate( estimate, sizes, makeIndexes(order16, samplesCount), getContext("16 files", samplesCount) );
+    }
+
+    ///indexes past the end are skipped
+    sizes.resize(12);
+    const SequenceFromPattern sequence12 = writeSizedSequence(root + "order12/", sizes);
+    const std::size_t order12[] = { 0, 8, 4, 2, 10, 6, 1, 9, 5, 3, 11, 7 };
+    for (std::size_t samplesCount = 1; samplesCount < 12; ++samplesCount) {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(sequence12, samplesCount, &estimate);
+        checkEstimate( estimate, sizes, makeIndexes(order12, samplesCount), getContext("12 files", samplesCount) );
+    }
+}
+
+///When every file is sampled the estimate is the exact total, with no interval
+void
+testExact(const std::string& root)
+{
+    std::vector<long long> sizes;
+    for (int i = 0; i < 20; ++i) {
+        sizes.push_back( 100 + (i * 37) % 11 * 50 );
+    }
+    const SequenceFromPattern sequence = writeSizedSequence(root + "exact/", sizes);
+    const std::size_t samplesCounts[] = { 20, 21, 1000 };
+
+    for (std::size_t i = 0; i < sizeof(samplesCounts) / sizeof(samplesCounts[0]); ++i) {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(sequence, samplesCounts[i], &estimate);
+        const std::string context = getContext("exact", samplesCounts[i]);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.exact, true, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.sizedFilesCount, 20u, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.estimatedSize, getTotalSize(sizes), context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.lowerBound, estimate.estimatedSize, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.upperBound, estimate.estimatedSize, context);
+    }
+
+    ///an empty sequence
+    SequenceSizeEstimate estimate;
+    estimateSequenceSize(SequenceFromPattern(), 64, &estimate);
+    SEQUENCEPARSING_CHECK(estimate.exact);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.filesCount, 0u);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.estimatedSize, 0ULL);
+}
+
+///Missing files count as sized but not in the mean extrapolated to all the files
+void
+testMissingFiles(const std::string& root)
+{
+    ///the odd indexes are missing, which 8 samples of 16 files do not see
+    std::vector<long long> sizes;
+    for (int i = 0; i < 16; ++i) {
+        sizes.push_back(i % 2 ? -1 : 1000 + i * 10);
+    }
+    const SequenceFromPattern sequence = writeSizedSequence(root + "missing_odd/", sizes);
+    const std::size_t order16[] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+    const std::size_t samplesCounts[] = { 1, 2, 8, 9, 12, 15 };
+    for (std::size_t i = 0; i < sizeof(samplesCounts) / sizeof(samplesCounts[0]); ++i) {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(sequence, samplesCounts[i], &estimate);
+        checkEstimate( estimate, sizes, makeIndexes(order16, samplesCounts[i]), getContext("missing odd", samplesCounts[i]) );
+    }
+    SequenceSizeEstimate estimate;
+    estimateSequenceSize(sequence, 16, &estimate);
+    SEQUENCEPARSING_CHECK(estimate.exact);
+    SEQUENCEPARSING_CHECK_EQUAL( estimate.estimatedSize, getTotalSize(sizes) );
+
+    ///the samples are all missing
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        sizes[i] = i % 2 ? 1000 : -1;
+    }
+    const SequenceFromPattern evenMissing = writeSizedSequence(root + "missing_even/", sizes);
+    estimateSequenceSize(evenMissing, 8, &estimate);
+    checkEstimate( estimate, sizes, makeIndexes(order16, 8), getContext("missing even", 8) );
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.lowerBound, 0ULL);
+}
+
+///Sizes growing along the sequence: the spread samples keep the total in the interval
+std::vector<long long>
+makeTrendSizes(std::size_t count)
+{
+    std::vector<long long> sizes;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        sizes.push_back( 1000 + (long long)i * 3 + (long long)( (i * 7919) % 13 ) * 20 );
+    }
+
+    return sizes;
+}
+
+void
+testTotalInInterval(const std::string& root)
+{
+    const std::vector<long long> sizes = makeTrendSizes(1000);
+    const SequenceFromPattern sequence = writeSizedSequence(root + "trend/", sizes);
+    const unsigned long long total = getTotalSize(sizes);
+    const std::size_t samplesCounts[] = { 2, 5, 16, 64, 300, 999 };
+
+    for (std::size_t i = 0; i < sizeof(samplesCounts) / sizeof(samplesCounts[0]); ++i) {
+        SequenceSizeEstimate estimate;
+        estimateSequenceSize(sequence, samplesCounts[i], &estimate);
+        const std::string context = getContext("trend", samplesCounts[i]);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.lowerBound <= total && total <= estimate.upperBound, true, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimate.lowerBound <= estimate.estimatedSize &&
+                                            estimate.estimatedSize <= estimate.upperBound, true, context);
+    }
+}
+
+#if __cplusplus >= 201103L
+///The refinement keeps the total in the interval until the estimate is exact
+void
+testEstimatorRefinement(const std::string& root)
+{
+    const std::vector<long long> sizes = makeTrendSizes(1000);
+    const SequenceFromPattern sequence = writeSizedSequence(root + "refine/", sizes);
+    const unsigned long long total = getTotalSize(sizes);
+    std::vector<SequenceSizeEstimate> estimates;
+
+    SequenceSizeEstimator estimator(sequence, 16, 0.95, [&estimates] (const SequenceSizeEstimate& estimate) {
+        estimates.push_back(estimate);
+    });
+    estimator.wait();
+    SequenceSizeEstimate estimate;
+    estimator.getEstimate(&estimate);
+    SEQUENCEPARSING_CHECK(estimate.exact);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.estimatedSize, total);
+
+    ///a call every 256 files sized after the 16 samples, and a last one when exact
+    SEQUENCEPARSING_CHECK_EQUAL(estimates.size(), 4u);
+    for (std::size_t i = 0; i < estimates.size(); ++i) {
+        std::stringstream context;
+        context << "estimate " << i << " of " << estimates[i].sizedFilesCount << " files";
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(estimates[i].lowerBound <= total && total <= estimates[i].upperBound, true, context.str());
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( estimates[i].sizedFilesCount, i + 1 < estimates.size() ? 16 + 256 * (i + 1) : 1000, context.str() );
+    }
+    if ( !estimates.empty() ) {
+        SEQUENCEPARSING_CHECK(estimates.back().exact);
+    }
+
+    ///no refinement when the sample has every file
+    SequenceSizeEstimator sampledOnly(sequence, 1000);
+    sampledOnly.wait();
+    sampledOnly.getEstimate(&estimate);
+    SEQUENCEPARSING_CHECK(estimate.exact);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.estimatedSize, total);
+}
+
+///wait() returns once the refinement is cancelled, with the estimate of the files sized so far
+void
+testEstimatorCancel()
+{
+    ///missing files are sized quickly, enough of them to still be refining when cancelled
+    SequenceFromPattern sequence;
+    for (int i = 0; i < 100000; ++i) {
+        std::stringstream ss;
+        ss << "/nonexistent/SequenceParsingTests/shot." << i << ".exr";
+        sequence[i][0] = ss.str();
+    }
+    std::atomic<bool> inCallback(false);
+    std::atomic<bool> cancelled(false);
+
+    SequenceSizeEstimator estimator(sequence, 64, 0.95, [&] (const SequenceSizeEstimate&) {
+        ///blocks the refinement at the first callback until it is cancelled
+        inCallback = true;
+        while (!cancelled) {
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+        }
+    });
+    while (!inCallback) {
+        std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+    estimator.cancel();
+    cancelled = true;
+    estimator.wait();
+    SequenceSizeEstimate estimate;
+    estimator.getEstimate(&estimate);
+    SEQUENCEPARSING_CHECK(!estimate.exact);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.sizedFilesCount, 64u + 256u);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.filesCount, 100000u);
+    SEQUENCEPARSING_CHECK_EQUAL(estimate.upperBound, ~0ULL);
+
+    ///cancelling and waiting again, or destroying without waiting, do not block
+    estimator.cancel();
+    estimator.wait();
+    SequenceSizeEstimator destroyed(sequence, 64);
+    destroyed.cancel();
+}
+#endif // __cplusplus >= 201103L
+} // namespace {
+
+int
+main()
+{
+    SequenceParsingTests::TemporaryDirectory directory;
+
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testSpreadOrder( directory.path() );
+        testExact( directory.path() );
+        testMissingFiles( directory.path() );
+        testTotalInInterval( directory.path() );
+#if __cplusplus >= 201103L
+        testEstimatorRefinement( directory.path() );
+        testEstimatorCancel();
+#endif
+    }
+
+    return SequenceParsingTests::testsResult("SizeEstimateTests");
+}
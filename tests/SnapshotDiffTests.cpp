@@ -0,0 +1,372 @@
+/*
+   Checks diffSequenceSnapshots on hand-written snapshots, on random ones against a frame-by-frame computation, and on
+   snapshots of files created in a temporary directory.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <climits>
+
+using namespace SequenceParsing;
+using SequenceParsingTests::writeFile;
+
+namespace {
+std::string
+rangesToString(const FrameRanges& ranges)
+{
+    std::stringstream ss;
+
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        ss << (i ? " " : "") << ranges[i].first << '-' << ranges[i].second;
+    }
+
+    return ss.str();
+}
+
+///Builds ranges from the bounds of each range, e.g: { 1, 5, 8, 8 } is 1-5 8-8
+FrameRanges
+makeRanges(const int* bounds,
+           std::size_t boundsCount)
+{
+    FrameRanges ret;
+
+    for (std::size_t i = 0; i + 1 < boundsCount; i += 2) {
+        ret.push_back( std::make_pair(bounds[i], bounds[i + 1]) );
+    }
+
+    return ret;
+}
+
+/*
+   Checks the diff of a view, the expected ranges being written like rangesToString (an empty string for none).
+   A view without any difference must not be in the diff.
+ */
+void
+checkViewDiff(const std::map<int, SequenceSnapshotViewDiff>& diff,
+              int view,
+              const std::string& added,
+              const std::string& removed,
+              const std::string& changed,
+              const std::string& context)
+{
+    std::map<int, SequenceSnapshotViewDiff>::const_iterator found = diff.find(view);
+
+    if ( added.empty() && removed.empty() && changed.empty() ) {
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(found == diff.end(), true, context);
+
+        return;
+    }
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(found != diff.end(), true, context);
+    if ( found != diff.end() ) {
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(rangesToString(found->second.added), added, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(rangesToString(found->second.removed), removed, context);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(rangesToString(found->second.changed), changed, context);
+    }
+}
+
+///Diffs 2 snapshots of view 0 given as ranges, and checks the added and removed frames
+void
+checkRangesDiff(const int* oldBounds,
+                std::size_t oldBoundsCount,
+                const int* newBounds,
+                std::size_t newBoundsCount,
+                const std::string& added,
+                const std::string& removed)
+{
+    SequenceSnapshot oldSnapshot;
+    SequenceSnapshot newSnapshot;
+
+    oldSnapshot.viewsFrames[0] = makeRanges(oldBounds, oldBoundsCount);
+    newSnapshot.viewsFrames[0] = makeRanges(newBounds, newBoundsCount);
+    std::map<int, SequenceSnapshotViewDiff> diff;
+    diffSequenceSnapshots(oldSnapshot, newSnapshot, &diff);
+    const std::string context = rangesToString(oldSnapshot.viewsFrames[0]) + " -> " + rangesToString(newSnapshot.viewsFrames[0]);
+    checkViewDiff(diff, 0, added, removed, std::string(), context);
+}
+
+#define CHECK_RANGES_DIFF(oldBounds, newBounds, added, removed) \
+    checkRangesDiff( oldBounds, sizeof(oldBounds) / sizeof(int), newBounds, sizeof(newBounds) / sizeof(int), added, removed )
+
+///Ranges of the 2 snapshots that touch or overlap each other
+void
+testAdjacentAndOverlappingRanges()
+{
+    {
+        ///adjacent: 1-10 then 11-20
+        const int a[] = { 1, 10 };
+        const int b[] = { 11, 20 };
+        CHECK_RANGES_DIFF(a, b, "11-20", "1-10");
+        CHECK_RANGES_DIFF(b, a, "1-10", "11-20");
+    }
+    {
+        ///overlapping on one side
+        const int a[] = { 1, 10 };
+        const int b[] = { 5, 15 };
+        CHECK_RANGES_DIFF(a, b, "11-15", "1-4");
+        CHECK_RANGES_DIFF(b, a, "1-4", "11-15");
+    }
+    {
+        ///one range inside the other
+        const int a[] = { 1, 20 };
+        const int b[] = { 5, 8 };
+        CHECK_RANGES_DIFF(a, b, "", "1-4 9-20");
+        CHECK_RANGES_DIFF(b, a, "1-4 9-20", "");
+    }
+    {
+        ///a range of the old snapshot overlapping several ranges of the new one
+        const int a[] = { 3, 17 };
+        const int b[] = { 1, 4, 6, 6, 8, 10, 16, 20 };
+        CHECK_RANGES_DIFF(a, b, "1-2 18-20", "5-5 7-7 11-15");
+        CHECK_RANGES_DIFF(b, a, "5-5 7-7 11-15", "1-2 18-20");
+    }
+    {
+        ///ranges sharing only their first or last frame
+        const int a[] = { 1, 5, 10, 15 };
+        const int b[] = { 5, 10 };
+        CHECK_RANGES_DIFF(a, b, "6-9", "1-4 11-15");
+    }
+    {
+        ///single frames alternating between the snapshots
+        const int a[] = { 1, 1, 3, 3, 5, 5 };
+        const int b[] = { 2, 2, 4, 4, 6, 6 };
+        CHECK_RANGES_DIFF(a, b, "2-2 4-4 6-6", "1-1 3-3 5-5");
+    }
+    {
+        ///adjacent ranges within a snapshot, as they may be written by hand
+        const int a[] = { 1, 5, 6, 10 };
+        const int b[] = { 1, 10 };
+        CHECK_RANGES_DIFF(a, b, "", "");
+        CHECK_RANGES_DIFF(b, a, "", "");
+        const int c[] = { 4, 7 };
+        CHECK_RANGES_DIFF(a, c, "", "1-3 8-10");
+    }
+    {
+        ///identical snapshots, and the limits of int
+        const int a[] = { INT_MIN, INT_MIN + 2, INT_MAX - 2, INT_MAX };
+        const int b[] = { INT_MIN + 1, INT_MAX - 1 };
+        CHECK_RANGES_DIFF(a, a, "", "");
+        std::stringstream added;
+        added << INT_MIN + 3 << '-' << INT_MAX - 3;
+        std::stringstream removed;
+        removed << INT_MIN << '-' << INT_MIN << ' ' << INT_MAX << '-' << INT_MAX;
+        CHECK_RANGES_DIFF(a, b, added.str(), removed.str());
+    }
+}
+
+///Views in only one snapshot, and frames only in some views
+void
+testViews()
+{
+    SequenceFromPattern oldSequence;
+    SequenceFromPattern newSequence;
+
+    for (int frame = 1; frame <= 10; ++frame) {
+        oldSequence[frame][0] = "l";
+        oldSequence[frame][1] = "r";
+        newSequence[frame][0] = "l";
+        if (frame != 5) {
+            newSequence[frame][1] = "r";
+        }
+        oldSequence[frame][3] = "removed view";
+        newSequence[frame + 100][4] = "added view";
+    }
+    ///a frame of a single view
+    newSequence[11][0] = "l";
+    SequenceSnapshot oldSnapshot;
+    SequenceSnapshot newSnapshot;
+    makeSequenceSnapshot(oldSequence, false, &oldSnapshot);
+    makeSequenceSnapshot(newSequence, false, &newSnapshot);
+
+    std::map<int, SequenceSnapshotViewDiff> diff;
+    diffSequenceSnapshots(oldSnapshot, newSnapshot, &diff);
+    SEQUENCEPARSING_CHECK_EQUAL(diff.size(), 4u);
+    checkViewDiff(diff, 0, "11-11", "", "", "view 0");
+    checkViewDiff(diff, 1, "", "5-5", "", "view 1");
+    checkViewDiff(diff, 3, "", "1-10", "", "view 3");
+    checkViewDiff(diff, 4, "101-110", "", "", "view 4");
+
+    diffSequenceSnapshots(newSnapshot, newSnapshot, &diff);
+    SEQUENCEPARSING_CHECK( diff.empty() );
+    diffSequenceSnapshots(SequenceSnapshot(), newSnapshot, &diff);
+    SEQUENCEPARSING_CHECK_EQUAL(diff.size(), 3u);
+    checkViewDiff(diff, 0, "1-11", "", "", "from empty");
+}
+
+FileInfo
+makeFileInfo(unsigned long long size,
+             long long modificationTime)
+{
+    FileInfo info;
+
+    info.size = size;
+    info.modificationTime = modificationTime;
+
+    return info;
+}
+
+///Changed frames are only reported when both snapshots have the info of the frame
+void
+testChangedFrames()
+{
+    SequenceSnapshot oldSnapshot;
+    SequenceSnapshot newSnapshot;
+
+    oldSnapshot.viewsFrames[0] = newSnapshot.viewsFrames[0] = FrameRanges( 1, std::make_pair(1, 10) );
+    oldSnapshot.viewsFrames[1] = newSnapshot.viewsFrames[1] = FrameRanges( 1, std::make_pair(1, 10) );
+    for (int frame = 1; frame <= 10; ++frame) {
+        oldSnapshot.viewsFileInfos[0][frame] = makeFileInfo(100, frame);
+        newSnapshot.viewsFileInfos[0][frame] = makeFileInfo(frame == 3 ? 101 : 100, frame == 4 || frame == 5 || frame == 9 ? 0 : frame);
+        ///only the old snapshot has the info of view 1
+        oldSnapshot.viewsFileInfos[1][frame] = makeFileInfo(100, frame);
+    }
+    ///frame 7 has no info in the new snapshot
+    newSnapshot.viewsFileInfos[0].erase(7);
+    oldSnapshot.viewsFileInfos[0][7] = makeFileInfo(1, 1);
+
+    std::map<int, SequenceSnapshotViewDiff> diff;
+    diffSequenceSnapshots(oldSnapshot, newSnapshot, &diff);
+    checkViewDiff(diff, 0, "", "", "3-5 9-9", "changed");
+    checkViewDiff(diff, 1, "", "", "", "info in the old snapshot only");
+
+    ///in the other direction, only the new snapshot has the info of view 1
+    diffSequenceSnapshots(newSnapshot, oldSnapshot, &diff);
+    checkViewDiff(diff, 0, "", "", "3-5 9-9", "changed, reversed");
+    checkViewDiff(diff, 1, "", "", "", "info in the new snapshot only");
+
+    ///neither has info
+    newSnapshot.viewsFileInfos.clear();
+    diffSequenceSnapshots(oldSnapshot, newSnapshot, &diff);
+    SEQUENCEPARSING_CHECK( diff.empty() );
+
+    ///the frames added or removed are not changed frames
+    newSnapshot.viewsFrames[0] = FrameRanges( 1, std::make_pair(5, 12) );
+    for (int frame = 5; frame <= 12; ++frame) {
+        newSnapshot.viewsFileInfos[0][frame] = makeFileInfo(frame == 6 ? 5 : 100, frame);
+    }
+    diffSequenceSnapshots(oldSnapshot, newSnapshot, &diff);
+    checkViewDiff(diff, 0, "11-12", "1-4", "6-7", "added, removed and changed");
+}
+
+///The diff of random snapshots has the frames of a frame-by-frame comparison, in normalized ranges
+void
+testRandomSnapshots()
+{
+    unsigned int seed = 1234;
+
+    for (int run = 0; run < 500; ++run) {
+        std::stringstream context;
+        context << "random run " << run;
+        SequenceFromPattern sequences[2];
+        std::map<int, std::map<int, FileInfo> > infos[2];
+        for (int s = 0; s < 2; ++s) {
+            for (int frame = 0; frame < 60; ++frame) {
+                for (int view = 0; view < 3; ++view) {
+                    seed = seed * 1103515245u + 12345u;
+                    if ( (seed >> 16) % 3 ) {
+                        sequences[s][frame][view] = "file";
+                        if ( (seed >> 20) % 4 ) {
+                            infos[s][view][frame] = makeFileInfo( (seed >> 24) % 2, 0 );
+                        }
+                    }
+                }
+            }
+        }
+        SequenceSnapshot snapshots[2];
+        for (int s = 0; s < 2; ++s) {
+            makeSequenceSnapshot(sequences[s], false, &snapshots[s]);
+            snapshots[s].viewsFileInfos = infos[s];
+        }
+        std::map<int, SequenceSnapshotViewDiff> diff;
+        diffSequenceSnapshots(snapshots[0], snapshots[1], &diff);
+
+        for (int view = 0; view < 3; ++view) {
+            FrameRanges added, removed, changed;
+            for (int frame = 0; frame < 60; ++frame) {
+                const bool inOld = sequences[0].count(frame) && sequences[0][frame].count(view);
+                const bool inNew = sequences[1].count(frame) && sequences[1][frame].count(view);
+                FrameRanges* ranges = 0;
+                if (inNew && !inOld) {
+                    ranges = &added;
+                } else if (inOld && !inNew) {
+                    ranges = &removed;
+                } else if ( inOld && infos[0][view].count(frame) && infos[1][view].count(frame) &&
+                            infos[0][view][frame] != infos[1][view][frame] ) {
+                    ranges = &changed;
+                }
+                if (ranges) {
+                    if ( !ranges->empty() && (ranges->back().second + 1 == frame) ) {
+                        ranges->back().second = frame;
+                    } else {
+                        ranges->push_back( std::make_pair(frame, frame) );
+                    }
+                }
+            }
+            std::stringstream viewContext;
+            viewContext << context.str() << " view " << view;
+            checkViewDiff( diff, view, rangesToString(added), rangesToString(removed), rangesToString(changed), viewContext.str() );
+        }
+    }
+}
+
+#ifndef _WIN32
+///Snapshots of files on disk, with the infos read by makeSequenceSnapshot or filesListFromPattern_slow
+void
+testFiles(const std::string& root)
+{
+    const std::string pattern = root + "shot.####.exr";
+
+    for (int frame = 1; frame <= 10; ++frame) {
+        SEQUENCEPARSING_CHECK( writeFile(generateFileNameFromPattern(pattern, std::vector<std::string>(), frame, 0), "data") );
+    }
+    SequenceFromPattern sequence;
+    SequenceFilesMetadata metadata;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_slow(pattern, &sequence, &metadata) );
+    SequenceSnapshot withInfos;
+    makeSequenceSnapshot(sequence, true, &withInfos);
+    SequenceSnapshot withMetadata;
+    makeSequenceSnapshot(sequence, metadata, &withMetadata);
+    SequenceSnapshot withoutInfos;
+    makeSequenceSnapshot(sequence, false, &withoutInfos);
+
+    ///frame 4 grows, frame 10 is removed and frame 11 added
+    SEQUENCEPARSING_CHECK( writeFile(root + "shot.0004.exr", "more data") );
+    SEQUENCEPARSING_CHECK( ::unlink( (root + "shot.0010.exr").c_str() ) == 0 );
+    SEQUENCEPARSING_CHECK( writeFile(root + "shot.0011.exr", "data") );
+    SequenceFromPattern newSequence;
+    SEQUENCEPARSING_CHECK( filesListFromPattern_slow(pattern, &newSequence) );
+    SequenceSnapshot newWithInfos;
+    makeSequenceSnapshot(newSequence, true, &newWithInfos);
+    SequenceSnapshot newWithoutInfos;
+    makeSequenceSnapshot(newSequence, false, &newWithoutInfos);
+
+    std::map<int, SequenceSnapshotViewDiff> diff;
+    diffSequenceSnapshots(withInfos, newWithInfos, &diff);
+    checkViewDiff(diff, 0, "11-11", "10-10", "4-4", "infos");
+    diffSequenceSnapshots(withMetadata, newWithInfos, &diff);
+    checkViewDiff(diff, 0, "11-11", "10-10", "4-4", "metadata");
+    diffSequenceSnapshots(withoutInfos, newWithInfos, &diff);
+    checkViewDiff(diff, 0, "11-11", "10-10", "", "old without infos");
+    diffSequenceSnapshots(withInfos, newWithoutInfos, &diff);
+    checkViewDiff(diff, 0, "11-11", "10-10", "", "new without infos");
+}
+#endif // _WIN32
+} // namespace {
+
+int
+main()
+{
+    testAdjacentAndOverlappingRanges();
+    testViews();
+    testChangedFrames();
+    testRandomSnapshots();
+#ifndef _WIN32
+    SequenceParsingTests::TemporaryDirectory directory;
+    SEQUENCEPARSING_CHECK( !directory.path().empty() );
+    if ( !directory.path().empty() ) {
+        testFiles( directory.path() );
+    }
+#endif
+
+    return SequenceParsingTests::testsResult("SnapshotDiffTests");
+}
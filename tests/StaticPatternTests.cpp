@@ -0,0 +1,117 @@
+/*
+   Checks that StaticPattern matches and generates file names exactly like the run-time functions
+   (filesListFromPattern_fast and generateFileNameFromPattern), with the same inputs for both.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <climits>
+#include <cstring>
+
+using namespace SequenceParsing;
+
+namespace {
+///Matched against every pattern of main()
+const char* const kFileNames[] = {
+    "shot.0001.exr", "shot.001.exr", "shot.1.exr", "shot.12345.exr", "shot.00012.exr", "shot.0001.dpx",
+    "shot.0001", "shot.0001.exr.bak", "shot..exr", "shot.exr", "shot.-001.exr", "shot.2147483647.exr",
+    "shot_left.0010.exr", "shot_right.0010.exr", "shot_l.0010.exr", "shot_r.0010.exr", "shot_L.0010.exr",
+    "shot_view3.0010.exr", "shot_view.0010.exr", "shot_view03.0010.exr", "shot_.0010.exr",
+    "shot_left_left.0001.exr", "shot_left_right.0001.exr", "shot_l_l.0001.exr", "shot_right.exr",
+    "a_1_1.exr", "a_1_2.exr", "a_0001_0001.exr", "a_0001_001.exr", "0001.exr", "10.exr", "noframe.exr",
+};
+
+///The frame and view numbers used to generate file names from every pattern of main()
+const int kFrameNumbers[] = { 0, 1, 7, 42, 9999, 10000, 123456, -3 };
+const int kViewNumbers[] = { -1, 0, 1, 2, 5 };
+
+template <std::size_t N>
+void
+checkSameSemantics(const StaticPattern<N>& staticPattern,
+                   const char* pattern)
+{
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(staticPattern.isValid(), true, pattern);
+
+    for (size_t i = 0; i < sizeof(kFileNames) / sizeof(kFileNames[0]); ++i) {
+        const std::string fileName = kFileNames[i];
+        const std::string context = std::string(pattern) + " with " + fileName;
+        int staticFrame, staticView;
+        const bool staticMatch = staticPattern.matches(fileName, &staticFrame, &staticView);
+
+        SequenceFromPattern sequence;
+        filesListFromPattern_fast(pattern, StringList(1, fileName), &sequence);
+        SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(staticMatch, !sequence.empty(), context);
+        if ( staticMatch && !sequence.empty() ) {
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(staticFrame, sequence.begin()->first, context);
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(staticView, sequence.begin()->second.begin()->first, context);
+        }
+    }
+
+    std::vector<std::string> viewNames;
+    viewNames.push_back("left");
+    viewNames.push_back("right");
+    viewNames.push_back("view2");
+#if __cplusplus >= 201703L
+    ///a view of the pattern which is not null-terminated, followed by variables that must not be generated
+    const std::string padded = std::string(pattern) + "%04d_%V.####";
+    const std::string_view patternView( padded.data(), std::strlen(pattern) );
+#endif
+    for (size_t i = 0; i < sizeof(kFrameNumbers) / sizeof(kFrameNumbers[0]); ++i) {
+        for (size_t j = 0; j < sizeof(kViewNumbers) / sizeof(kViewNumbers[0]); ++j) {
+            std::stringstream context;
+            context << pattern << " with frame " << kFrameNumbers[i] << " and view " << kViewNumbers[j];
+            const std::string fileName = generateFileNameFromPattern(std::string(pattern), viewNames, kFrameNumbers[i], kViewNumbers[j]);
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( staticPattern.generateFileName(viewNames, kFrameNumbers[i], kViewNumbers[j]),
+                                                 fileName, context.str() );
+#if __cplusplus >= 201703L
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( generateFileNameFromPattern(patternView, viewNames, kFrameNumbers[i], kViewNumbers[j]),
+                                                 fileName, context.str() );
+            SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( generateFileNameFromPattern(pattern, viewNames, kFrameNumbers[i], kViewNumbers[j]),
+                                                 fileName, context.str() );
+#endif
+        }
+    }
+}
+} // namespace {
+
+///Declares the static pattern and checks it against the run-time functions with the same string
+#define CHECK_STATIC_PATTERN(pattern) \
+    { \
+        SEQUENCEPARSING_STATIC_PATTERN(staticPattern, pattern); \
+        checkSameSemantics(staticPattern, pattern); \
+    }
+
+int
+main()
+{
+    // #
+    CHECK_STATIC_PATTERN("shot.####.exr");
+    CHECK_STATIC_PATTERN("shot.#.exr");
+    CHECK_STATIC_PATTERN("/renders/shot.###.exr");
+    CHECK_STATIC_PATTERN("####.exr");
+    // %d and %0Nd
+    CHECK_STATIC_PATTERN("shot.%d.exr");
+    CHECK_STATIC_PATTERN("shot.%04d.exr");
+    CHECK_STATIC_PATTERN("shot.%01d.exr");
+    CHECK_STATIC_PATTERN("/renders/shot.%03d.exr");
+    // several frame numbers, which must be equal
+    CHECK_STATIC_PATTERN("a_%d_%d.exr");
+    CHECK_STATIC_PATTERN("a_%04d_####.exr");
+    // %v
+    CHECK_STATIC_PATTERN("shot_%v.####.exr");
+    CHECK_STATIC_PATTERN("shot_%v_%v.####.exr");
+    // %V
+    CHECK_STATIC_PATTERN("shot_%V.%04d.exr");
+    CHECK_STATIC_PATTERN("shot_%V_%V.####.exr");
+    CHECK_STATIC_PATTERN("shot_%V.exr");
+    // no variable
+    CHECK_STATIC_PATTERN("noframe.exr");
+
+    // invalid static patterns, accepted at run-time
+    SEQUENCEPARSING_CHECK( !StaticPattern<sizeof("/renders_%V/shot.####.exr")>("/renders_%V/shot.####.exr").isValid() );
+    SEQUENCEPARSING_CHECK( !StaticPattern<sizeof("shot.####.e%d")>("shot.####.e%d").isValid() );
+    SEQUENCEPARSING_CHECK( !StaticPattern<sizeof("shot.%x.exr")>("shot.%x.exr").isValid() );
+
+    return SequenceParsingTests::testsResult("StaticPatternTests");
+}
@@ -0,0 +1,198 @@
+#ifndef SEQUENCEPARSING_TESTUTILS_H
+#define SEQUENCEPARSING_TESTUTILS_H
+
+/*
+   Minimal checks shared by the test programs of this directory, and helpers to run tests on files in a temporary
+   directory (POSIX only).
+   Each test is a standalone program compiled with the library and returning non-zero if a check failed, e.g:
+   g++ -std=c++14 -I.. StaticPatternTests.cpp ../SequenceParsing.cpp -lpthread -o StaticPatternTests
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SequenceParsingTests {
+inline int&
+failuresCount()
+{
+    static int count = 0;
+
+    return count;
+}
+
+template <typename T, typename U>
+void
+checkEqual(const T& actual,
+           const U& expected,
+           const char* expression,
+           const char* file,
+           int line,
+           const std::string& context)
+{
+    if ( !(actual == expected) ) {
+        ++failuresCount();
+        std::cerr << file << ':' << line << ": " << expression << " is " << actual << ", expected " << expected;
+        if ( !context.empty() ) {
+            std::cerr << " (" << context << ')';
+        }
+        std::cerr << std::endl;
+    }
+}
+
+///Prints the number of failures and returns the exit code of the test program
+inline int
+testsResult(const char* testName)
+{
+    if ( failuresCount() ) {
+        std::cerr << testName << ": " << failuresCount() << " failure(s)" << std::endl;
+
+        return 1;
+    }
+    std::cout << testName << ": OK" << std::endl;
+
+    return 0;
+}
+
+#ifndef _WIN32
+///Creates the directories of the path that do not exist yet, the path ends with a separator
+inline bool
+makeDirectories(const std::string& path)
+{
+    for (std::size_t i = 1; i < path.size(); ++i) {
+        if (path[i] == '/') {
+            const std::string directory = path.substr(0, i);
+            if ( (::mkdir(directory.c_str(), 0755) != 0) && (errno != EEXIST) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+///Writes the content to the file, creating its directories, and returns false on failure
+inline bool
+writeFile(const std::string& path,
+          const std::string& content)
+{
+    if ( !makeDirectories( path.substr(0, path.find_last_of('/') + 1) ) ) {
+        return false;
+    }
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::write( fd, content.data(), content.size() ) == (ssize_t)content.size();
+    ::close(fd);
+
+    return ok;
+}
+
+///Returns the content of the file, or "<missing>" if it cannot be opened
+inline std::string
+readFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return "<missing>";
+    }
+    std::string ret;
+    char buf[4096];
+    ssize_t size;
+    while ( ( size = ::read( fd, buf, sizeof(buf) ) ) > 0 ) {
+        ret.append(buf, size);
+    }
+    ::close(fd);
+
+    return ret;
+}
+
+inline bool
+fileExists(const std::string& path)
+{
+    struct stat st;
+
+    return ::lstat(path.c_str(), &st) == 0;
+}
+
+///Removes the directory and everything it contains
+inline void
+removeTree(const std::string& path)
+{
+    if (DIR* dir = ::opendir( path.c_str() )) {
+        while (struct dirent* entry = ::readdir(dir)) {
+            if ( std::strcmp(entry->d_name, ".") && std::strcmp(entry->d_name, "..") ) {
+                const std::string child = path + "/" + entry->d_name;
+                struct stat st;
+                if ( (::lstat(child.c_str(), &st) == 0) && S_ISDIR(st.st_mode) ) {
+                    removeTree(child);
+                } else {
+                    ::unlink( child.c_str() );
+                }
+            }
+        }
+        ::closedir(dir);
+    }
+    ::rmdir( path.c_str() );
+}
+
+///A new directory in parent ($TMPDIR by default), removed with its content on destruction
+class TemporaryDirectory
+{
+public:
+
+    explicit TemporaryDirectory(const char* parent = 0)
+        : _path()
+    {
+        const char* tmp = parent ? parent : std::getenv("TMPDIR");
+        std::string pathTemplate = std::string(tmp ? tmp : "/tmp") + "/SequenceParsingTests.XXXXXX";
+        if ( ::mkdtemp(&pathTemplate[0]) ) {
+            _path = pathTemplate + "/";
+        }
+    }
+
+    ~TemporaryDirectory()
+    {
+        if ( !_path.empty() ) {
+            removeTree( _path.substr(0, _path.size() - 1) );
+        }
+    }
+
+    ///With a trailing separator, empty if the directory could not be created
+    const std::string& path() const
+    {
+        return _path;
+    }
+
+private:
+    TemporaryDirectory(const TemporaryDirectory&);
+    void operator=(const TemporaryDirectory&);
+
+    std::string _path;
+};
+#endif // _WIN32
+} // namespace SequenceParsingTests
+
+#define SEQUENCEPARSING_CHECK(condition) \
+    SequenceParsingTests::checkEqual( (bool)(condition), true, # condition, __FILE__, __LINE__, std::string() )
+
+///The context is printed on failure, e.g: the input of a table-driven test
+#define SEQUENCEPARSING_CHECK_EQUAL_CONTEXT(actual, expected, context) \
+    SequenceParsingTests::checkEqual( (actual), (expected), # actual, __FILE__, __LINE__, (context) )
+
+#define SEQUENCEPARSING_CHECK_EQUAL(actual, expected) \
+    SEQUENCEPARSING_CHECK_EQUAL_CONTEXT( actual, expected, std::string() )
+
+#endif // SEQUENCEPARSING_TESTUTILS_H
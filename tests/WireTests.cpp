@@ -0,0 +1,189 @@
+/*
+   Checks the binary encoding of sequences: round trips, and data that is truncated, corrupted or crafted
+   to make the decoder allocate or generate too much.
+ */
+
+#include "SequenceParsing.h"
+#include "TestUtils.h"
+
+#include <climits>
+
+using namespace SequenceParsing;
+
+namespace {
+void
+writeVarint(unsigned long long value,
+            std::string* data)
+{
+    while (value >= 0x80) {
+        data->push_back( (char)( (value & 0x7f) | 0x80 ) );
+        value >>= 7;
+    }
+    data->push_back( (char)value );
+}
+
+///The header of an encoded sequence of a single view, up to its frame ranges
+std::string
+makeHeader(const std::string& pattern,
+           unsigned long long rangesCount)
+{
+    std::string data("SQWF", 4);
+
+    writeVarint(1, &data); // version
+    writeVarint(0, &data); // flags
+    writeVarint(pattern.size(), &data);
+    data.append(pattern);
+    writeVarint(1, &data); // views count
+    writeVarint(0, &data); // view 0, zigzag encoded
+    writeVarint(0, &data); // empty view token
+    writeVarint(rangesCount, &data);
+
+    return data;
+}
+
+void
+makeSequence(SequenceFromPattern* sequence,
+             SequenceFilesMetadata* metadata)
+{
+    const int frames[] = { -5, 1, 2, 3, 4, 10, 11, 1000, 1001, 99999 };
+
+    for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); ++i) {
+        for (int view = 0; view < 2; ++view) {
+            std::string name = generateFileNameFromPattern(std::string("/renders/shot_%V.%04d.exr"),
+                                                           StringList(), frames[i], view);
+            if (frames[i] == 10) {
+                name = "/renders/other_name.exr"; // stored verbatim
+            }
+            (*sequence)[frames[i]][view] = name;
+            metadata->frames.push_back(frames[i]);
+            metadata->views.push_back(view);
+            metadata->sizes.push_back(1000000 + i * 3);
+            metadata->modificationTimes.push_back(1500000000000000000LL + (long long)i * 1000);
+            metadata->inodes.push_back(0);
+        }
+    }
+}
+
+void
+testRoundTrip()
+{
+    SequenceFromPattern sequence;
+    SequenceFilesMetadata metadata;
+
+    makeSequence(&sequence, &metadata);
+    std::string data;
+    serializeSequence("/renders/shot_%V.%04d.exr", sequence, &metadata, &data);
+
+    std::string pattern;
+    SequenceFromPattern decoded;
+    SequenceFilesMetadata decodedMetadata;
+    SEQUENCEPARSING_CHECK( deserializeSequence(data.data(), data.size(), &pattern, &decoded, &decodedMetadata) );
+    SEQUENCEPARSING_CHECK_EQUAL( pattern, std::string("/renders/shot_%V.%04d.exr") );
+    SEQUENCEPARSING_CHECK(decoded == sequence);
+    SEQUENCEPARSING_CHECK_EQUAL( decodedMetadata.size(), metadata.size() );
+    for (size_t i = 0; i < decodedMetadata.size() && i < metadata.size(); ++i) {
+        ///the decoded metadata is ordered by view then frame
+        size_t j = 0;
+        while ( j < metadata.size() && ( (metadata.frames[j] != decodedMetadata.frames[i]) || (metadata.views[j] != decodedMetadata.views[i]) ) ) {
+            ++j;
+        }
+        SEQUENCEPARSING_CHECK( j < metadata.size() );
+        if ( j < metadata.size() ) {
+            SEQUENCEPARSING_CHECK_EQUAL(decodedMetadata.sizes[i], metadata.sizes[j]);
+            SEQUENCEPARSING_CHECK_EQUAL(decodedMetadata.modificationTimes[i], metadata.modificationTimes[j]);
+            SEQUENCEPARSING_CHECK_EQUAL(decodedMetadata.inodes[i], 0u);
+        }
+    }
+
+    std::map<int, FrameRanges> viewsFrames;
+    SEQUENCEPARSING_CHECK( deserializeSequenceFrames(data.data(), data.size(), &pattern, &viewsFrames) );
+    SEQUENCEPARSING_CHECK_EQUAL(viewsFrames.size(), 2u);
+    SEQUENCEPARSING_CHECK_EQUAL(viewsFrames[0].size(), 5u);
+    SEQUENCEPARSING_CHECK_EQUAL(viewsFrames[1].size(), 5u);
+
+    ///An empty sequence
+    data.clear();
+    serializeSequence(std::string(), SequenceFromPattern(), NULL, &data);
+    decoded.clear();
+    SEQUENCEPARSING_CHECK( deserializeSequence(data.data(), data.size(), &pattern, &decoded) );
+    SEQUENCEPARSING_CHECK( decoded.empty() );
+}
+
+///Every prefix of a valid encoding and every single corrupted byte must be decoded without crashing
+void
+testTruncatedAndCorrupted()
+{
+    SequenceFromPattern sequence;
+    SequenceFilesMetadata metadata;
+
+    makeSequence(&sequence, &metadata);
+    std::string data;
+    serializeSequence("/renders/shot_%V.%04d.exr", sequence, &metadata, &data);
+
+    for (size_t size = 0; size < data.size(); ++size) {
+        std::string pattern;
+        SequenceFromPattern decoded;
+        SequenceFilesMetadata decodedMetadata;
+        SEQUENCEPARSING_CHECK( !deserializeSequence(data.data(), size, &pattern, &decoded, &decodedMetadata) );
+    }
+    for (size_t i = 0; i < data.size(); ++i) {
+        for (int bit = 0; bit < 8; ++bit) {
+            std::string corrupted = data;
+            corrupted[i] = (char)(corrupted[i] ^ (1 << bit));
+            std::string pattern;
+            SequenceFromPattern decoded;
+            SequenceFilesMetadata decodedMetadata;
+            std::map<int, FrameRanges> viewsFrames;
+            deserializeSequence(corrupted.data(), corrupted.size(), &pattern, &decoded, &decodedMetadata);
+            deserializeSequenceFrames(corrupted.data(), corrupted.size(), &pattern, &viewsFrames);
+        }
+    }
+}
+
+///A few bytes can describe billions of files: the decoder must refuse them instead of allocating
+void
+testHugeCounts()
+{
+    ///One range of 2^31 frames followed by as many exceptions, which are not in the data
+    std::string data = makeHeader("a#", 1);
+    writeVarint(0, &data); // first frame delta
+    writeVarint(INT_MAX, &data); // range length
+    std::string withExceptions = data;
+    writeVarint(INT_MAX, &withExceptions); // exceptions count
+
+    std::string pattern;
+    SequenceFromPattern decoded;
+    std::map<int, FrameRanges> viewsFrames;
+    SEQUENCEPARSING_CHECK( !deserializeSequenceFrames(withExceptions.data(), withExceptions.size(), &pattern, &viewsFrames) );
+    SEQUENCEPARSING_CHECK( !deserializeSequence(withExceptions.data(), withExceptions.size(), &pattern, &decoded) );
+
+    ///Without exceptions, the frame ranges alone are fine but generating 2^31 file names is not
+    writeVarint(0, &data); // exceptions count
+    viewsFrames.clear();
+    SEQUENCEPARSING_CHECK( deserializeSequenceFrames(data.data(), data.size(), &pattern, &viewsFrames) );
+    SEQUENCEPARSING_CHECK_EQUAL(viewsFrames[0].size(), 1u);
+    SEQUENCEPARSING_CHECK( !deserializeSequence(data.data(), data.size(), &pattern, &decoded) );
+    SequenceFilesMetadata metadata;
+    SEQUENCEPARSING_CHECK( !deserializeSequence(data.data(), data.size(), &pattern, &decoded, &metadata) );
+    SEQUENCEPARSING_CHECK( decoded.empty() );
+
+    ///Many small ranges add up too
+    data = makeHeader("a#", 64);
+    for (int i = 0; i < 64; ++i) {
+        writeVarint(i == 0 ? 0 : 4, &data); // zigzag encoded delta of 2 from the previous range end
+        writeVarint(1 << 20, &data);
+    }
+    writeVarint(0, &data);
+    SEQUENCEPARSING_CHECK( !deserializeSequence(data.data(), data.size(), &pattern, &decoded) );
+}
+} // namespace {
+
+int
+main()
+{
+    testRoundTrip();
+    testTruncatedAndCorrupted();
+    testHugeCounts();
+
+    return SequenceParsingTests::testsResult("WireTests");
+}